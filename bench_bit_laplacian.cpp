@@ -0,0 +1,93 @@
+// Benchmarks the local search of BitLaplacianView against round_local on the
+// dense node matrix, for a random Erdos-Renyi graph with some indices frozen,
+// and checks that both reach the same local maxima. Timing several values of
+// frozen for one N locates the crossover behind BIT_LAPLACIAN_CROSSOVER.
+//
+// Usage: bench_bit_laplacian [N] [frozen] [repetitions]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+#include "bit_laplacian.h"
+#include "freeze_map.h"
+#include "round.h"
+
+int main(int argc, char** argv) {
+  int N = argc > 1 ? std::atoi(argv[1]) : 300;
+  int frozen = argc > 2 ? std::atoi(argv[2]) : 0;
+  int repetitions = argc > 3 ? std::atoi(argv[3]) : 20;
+
+  // Laplacian of G(N, 1/2), as made by data_gen/erdos_renyi_laplacian.py
+  std::mt19937 generator(0);
+  std::bernoulli_distribution edge(0.5);
+  Eigen::MatrixXd L = Eigen::MatrixXd::Zero(N, N);
+  for (int i = 0; i < N; i++) {
+    for (int j = i + 1; j < N; j++) {
+      if (edge(generator)) {
+        L(i, j) = L(j, i) = -1;
+        L(i, i) += 1;
+        L(j, j) += 1;
+      }
+    }
+  }
+
+  // Freeze random pairs of keys, as branching does
+  FreezeMap freezes(N);
+  for (int f = 0; f < frozen && freezes.get_num_keys() > 1; f++) {
+    int M = freezes.get_num_keys();
+    int a = std::uniform_int_distribution<int>(0, M - 1)(generator);
+    int b = std::uniform_int_distribution<int>(0, M - 2)(generator);
+    if (b >= a) {
+      b++;
+    }
+    freezes.freeze(freezes.get_key(a),
+                   freezes.get_key(b),
+                   edge(generator) ? 1 : -1);
+  }
+  int M = freezes.get_num_keys();
+
+  Eigen::MatrixXd B = FreezeMap_transform_matrix(L, &freezes);
+  BitLaplacian laplacian(L);
+  BitLaplacianView view(&laplacian, &freezes);
+
+  std::bernoulli_distribution sign(0.5);
+  double dense_time = 0;
+  double bit_time = 0;
+  bool same = true;
+  for (int rep = 0; rep < repetitions; rep++) {
+    Eigen::VectorXd start(M);
+    for (int r = 0; r < M; r++) {
+      start(r) = sign(generator) ? 1.0 : -1.0;
+    }
+    Eigen::VectorXd dense = start;
+    Eigen::VectorXd bits = start;
+
+    std::chrono::steady_clock::time_point t0 =
+      std::chrono::steady_clock::now();
+    round_local(B, dense);
+    double dense_value = dense.dot(B * dense);
+    std::chrono::steady_clock::time_point t1 =
+      std::chrono::steady_clock::now();
+    double bit_value = view.local_search(bits);
+    std::chrono::steady_clock::time_point t2 =
+      std::chrono::steady_clock::now();
+
+    dense_time += std::chrono::duration<double>(t1 - t0).count();
+    bit_time += std::chrono::duration<double>(t2 - t1).count();
+    same = same && dense == bits && dense_value == bit_value;
+  }
+
+  printf("Local search on %d of %d variables (M^2 / N = %.1f)\n",
+         M,
+         N,
+         (double) M * M / N);
+  printf("round_local: %f seconds\n", dense_time / repetitions);
+  printf("BitLaplacianView: %f seconds\n", bit_time / repetitions);
+  printf("Speedup: %.1fx\n", dense_time / bit_time);
+  printf("Same local maxima: %s\n", same ? "yes" : "no");
+
+  return same ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+// Benchmarks choose_best_ineqs against the reference separation it replaced,
+// which allocated every candidate and kept them in a priority queue, and
+// checks that both choose the same inequalities.
+//
+// Usage: bench_separation [N] [M] [repetitions]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <queue>
+#include <random>
+#include <set>
+#include <vector>
+#include <Eigen/Dense>
+#include "cut.h"
+#include "freeze_map.h"
+#include "triangle_inequality.h"
+
+static void reference_choose_best_ineqs(
+    const Eigen::MatrixXd& X,
+    const FreezeMap& freezes,
+    const std::set<int>& avoid_ixs,
+    int M,
+    CutList& ineqs) {
+  int N = X.rows();
+
+  auto compare = [&X](const std::shared_ptr<Cut>& lhs,
+                      const std::shared_ptr<Cut>& rhs) {
+    return lhs->eval(X) < rhs->eval(X);
+  };
+
+  std::priority_queue<
+    std::shared_ptr<Cut>,
+    std::vector<std::shared_ptr<Cut>>,
+    decltype(compare)> ineq_queue(compare);
+
+  int sign_choices[4][3] = {
+    { +1, +1, +1 },
+    { +1, -1, -1 },
+    { -1, +1, -1 },
+    { -1, -1, +1 }};
+
+  for (int i = 0; i < N; i++) {
+    if (avoid_ixs.find(i) != avoid_ixs.end()) {
+      continue;
+    }
+    for (int j = i + 1; j < N; j++) {
+      if (avoid_ixs.find(j) != avoid_ixs.end()) {
+        continue;
+      }
+      for (int k = j + 1; k < N; k++) {
+        if (avoid_ixs.find(k) != avoid_ixs.end()) {
+          continue;
+        }
+        for (int l = 0; l < 4; l++) {
+          std::shared_ptr<Cut>
+            this_ineq(new Cut(Cut::triangle(i, j, k,
+                                            sign_choices[l][0],
+                                            sign_choices[l][1],
+                                            sign_choices[l][2])));
+          if ((int) ineq_queue.size() < M) {
+            ineq_queue.push(this_ineq);
+          } else if (this_ineq->eval(X) < ineq_queue.top()->eval(X)) {
+            ineq_queue.pop();
+            ineq_queue.push(this_ineq);
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<int> keys(freezes.get_keys(),
+                        freezes.get_keys() + freezes.get_num_keys());
+
+  ineqs.clear();
+  while (!ineq_queue.empty()) {
+    Cut translated;
+    ineq_queue.top()->transform(keys, NULL, translated);
+    ineqs.push_back(translated);
+    ineq_queue.pop();
+  }
+}
+
+static std::set<CutKey> to_keys(const CutList& ineqs) {
+  std::set<CutKey> keys;
+  for (const Cut& ineq : ineqs) {
+    keys.insert(ineq.get_key());
+  }
+  return keys;
+}
+
+int main(int argc, char** argv) {
+  int N = argc > 1 ? std::atoi(argv[1]) : 100;
+  int M = argc > 2 ? std::atoi(argv[2]) : 200;
+  int repetitions = argc > 3 ? std::atoi(argv[3]) : 5;
+
+  // A random Gram matrix of unit vectors of low rank, like an SDP solution
+  int rank = 1;
+  while (rank * (rank + 1) / 2 < N) {
+    rank++;
+  }
+  std::mt19937 generator(0);
+  std::normal_distribution<double> distribution;
+  Eigen::MatrixXd V(N, rank);
+  for (int i = 0; i < N; i++) {
+    for (int r = 0; r < rank; r++) {
+      V(i, r) = distribution(generator);
+    }
+    V.row(i).normalize();
+  }
+  Eigen::MatrixXd X = V * V.transpose();
+
+  FreezeMap freezes(N);
+  std::set<int> avoid_ixs = { 0, N / 2 };
+
+  CutList reference;
+  CutList ineqs;
+  double reference_time = 0;
+  double time = 0;
+  for (int rep = 0; rep < repetitions; rep++) {
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    reference_choose_best_ineqs(X, freezes, avoid_ixs, M, reference);
+    std::chrono::steady_clock::time_point middle =
+      std::chrono::steady_clock::now();
+    choose_best_ineqs(X, freezes, avoid_ixs, M, ineqs);
+    std::chrono::steady_clock::time_point end =
+      std::chrono::steady_clock::now();
+
+    reference_time += std::chrono::duration<double>(middle - start).count();
+    time += std::chrono::duration<double>(end - middle).count();
+  }
+
+  bool same = to_keys(reference) == to_keys(ineqs);
+
+  printf("Separating %d inequalities among %d variables\n", M, N);
+  printf("Reference: %f seconds\n", reference_time / repetitions);
+  printf("choose_best_ineqs: %f seconds\n", time / repetitions);
+  printf("Speedup: %.1fx\n", reference_time / time);
+  printf("Same inequalities: %s\n", same ? "yes" : "no");
+
+  return same ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+#include "bit_laplacian.h"
+#include "freeze_map.h"
+
+static int popcount(uint64_t word) {
+  return __builtin_popcountll(word);
+}
+
+bool is_unweighted_laplacian(const Eigen::MatrixXd& A) {
+  int N = A.rows();
+
+  for (int i = 0; i < N; i++) {
+    double degree = 0;
+    for (int j = 0; j < N; j++) {
+      if (j == i) {
+        continue;
+      }
+      double a = A(i, j);
+      if ((a != 0.0 && a != -1.0) || A(j, i) != a) {
+        return false;
+      }
+      degree -= a;
+    }
+    if (A(i, i) != degree) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+BitLaplacian::BitLaplacian(const Eigen::MatrixXd& L) {
+  N = L.rows();
+  num_words = (N + 63) / 64;
+  adjacency.assign((long) N * num_words, 0);
+  degrees.assign(N, 0);
+
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      if (j != i && L(i, j) != 0.0) {
+        adjacency[(long) i * num_words + j / 64] |= uint64_t(1) << (j % 64);
+        degrees[i]++;
+      }
+    }
+  }
+}
+
+std::shared_ptr<const BitLaplacian> make_bit_laplacian(
+    const Eigen::MatrixXd& A) {
+  if (!is_unweighted_laplacian(A)) {
+    return std::shared_ptr<const BitLaplacian>();
+  }
+  return std::shared_ptr<const BitLaplacian>(new BitLaplacian(A));
+}
+
+BitLaplacianView::BitLaplacianView(const BitLaplacian* laplacian,
+                                   const FreezeMap* f) {
+  this->laplacian = laplacian;
+  M = f->get_num_keys();
+  int N = f->get_num_indices();
+
+  int num_words = laplacian->get_num_words();
+  groups.resize(M);
+  group_of.resize(N);
+  group_masks.assign((long) M * num_words, 0);
+  negated_mask.assign(num_words, 0);
+  internal_balance.assign(M, 0);
+
+  // Each group lists its key first, then its frozen indices in order
+  std::vector<int> rep(N);
+  std::vector<int> signs(N);
+  f->resolve(rep.data(), signs.data());
+  std::vector<int> key_to_ix(N);
+  f->get_key_indices(key_to_ix.data());
+  for (int r = 0; r < M; r++) {
+    groups[r].push_back(f->get_key(r));
+  }
+  for (int j = 0; j < N; j++) {
+    int r = key_to_ix[rep[j]];
+    group_of[j] = r;
+    group_masks[(long) r * num_words + j / 64] |= uint64_t(1) << (j % 64);
+    if (rep[j] != j) {
+      groups[r].push_back(j);
+    }
+    if (signs[j] < 0) {
+      negated_mask[j / 64] |= uint64_t(1) << (j % 64);
+    }
+  }
+
+  for (int r = 0; r < M; r++) {
+    const uint64_t* group_mask = &group_masks[(long) r * num_words];
+
+    // Each internal edge is seen from both of its endpoints
+    int balance = 0;
+    for (int i : groups[r]) {
+      const uint64_t* row = laplacian->row(i);
+      uint64_t sign = ((negated_mask[i / 64] >> (i % 64)) & 1) ?
+        ~uint64_t(0) : 0;
+      for (int w = 0; w < num_words; w++) {
+        uint64_t internal = row[w] & group_mask[w];
+        balance += popcount(internal & ~(negated_mask[w] ^ sign));
+        balance -= popcount(internal & (negated_mask[w] ^ sign));
+      }
+    }
+    internal_balance[r] = balance / 2;
+  }
+}
+
+void BitLaplacianView::expand(const Eigen::VectorXd& z,
+                              std::vector<uint64_t>& mask) const {
+  int num_words = laplacian->get_num_words();
+
+  mask = negated_mask;
+  for (int r = 0; r < M; r++) {
+    if (z(r) < 0) {
+      const uint64_t* group_mask = &group_masks[(long) r * num_words];
+      for (int w = 0; w < num_words; w++) {
+        mask[w] ^= group_mask[w];
+      }
+    }
+  }
+}
+
+long BitLaplacianView::cut(const std::vector<uint64_t>& mask) const {
+  int N = laplacian->size();
+  int num_words = laplacian->get_num_words();
+
+  // Counts, for each vertex, its neighbors on the other side
+  long count = 0;
+  for (int i = 0; i < N; i++) {
+    const uint64_t* row = laplacian->row(i);
+    uint64_t side = ((mask[i / 64] >> (i % 64)) & 1) ? ~uint64_t(0) : 0;
+    for (int w = 0; w < num_words; w++) {
+      count += popcount(row[w] & (mask[w] ^ side));
+    }
+  }
+
+  return count / 2;
+}
+
+long BitLaplacianView::flip_gain(const std::vector<uint64_t>& mask,
+                                 int r) const {
+  int num_words = laplacian->get_num_words();
+
+  // Flipping the group turns each edge to the rest of the graph from uncut
+  // to cut or back, and leaves internal edges as they are
+  long gain = 0;
+  for (int i : groups[r]) {
+    const uint64_t* row = laplacian->row(i);
+    uint64_t side = ((mask[i / 64] >> (i % 64)) & 1) ? ~uint64_t(0) : 0;
+    int opposite = 0;
+    for (int w = 0; w < num_words; w++) {
+      opposite += popcount(row[w] & (mask[w] ^ side));
+    }
+    gain += laplacian->degree(i) - 2 * opposite;
+  }
+
+  return gain - 2 * internal_balance[r];
+}
+
+void BitLaplacianView::flip(int r,
+                            std::vector<uint64_t>& mask,
+                            std::vector<long>& gains) const {
+  int num_words = laplacian->get_num_words();
+  const uint64_t* group_mask = &group_masks[(long) r * num_words];
+
+  // Each edge from the group to another group turns from uncut to cut or
+  // back, which changes the other group's gain by -2 or +2
+  for (int i : groups[r]) {
+    const uint64_t* row = laplacian->row(i);
+    uint64_t side = ((mask[i / 64] >> (i % 64)) & 1) ? ~uint64_t(0) : 0;
+    for (int w = 0; w < num_words; w++) {
+      uint64_t outside = row[w] & ~group_mask[w];
+      uint64_t opposite = outside & (mask[w] ^ side);
+      uint64_t same = outside & ~opposite;
+      for (; same != 0; same &= same - 1) {
+        gains[group_of[w * 64 + __builtin_ctzll(same)]] -= 2;
+      }
+      for (; opposite != 0; opposite &= opposite - 1) {
+        gains[group_of[w * 64 + __builtin_ctzll(opposite)]] += 2;
+      }
+    }
+  }
+  gains[r] = -gains[r];
+
+  for (int w = 0; w < num_words; w++) {
+    mask[w] ^= group_mask[w];
+  }
+}
+
+double BitLaplacianView::value(const Eigen::VectorXd& z) const {
+  std::vector<uint64_t> mask;
+  expand(z, mask);
+  return 4.0 * cut(mask);
+}
+
+double BitLaplacianView::local_search(Eigen::VectorXd& z) const {
+  std::vector<uint64_t> mask;
+  expand(z, mask);
+  long value = cut(mask);
+
+  std::vector<long> gains(M);
+  for (int r = 0; r < M; r++) {
+    gains[r] = flip_gain(mask, r);
+  }
+
+  // Gains are integers, so take the best flip, the first among equals,
+  // until none improves the cut
+  while (M > 0) {
+    int best = std::max_element(gains.begin(), gains.end()) - gains.begin();
+    if (gains[best] <= 0) {
+      break;
+    }
+    value += gains[best];
+    z(best) = -z(best);
+    flip(best, mask, gains);
+  }
+
+  return 4.0 * value;
+}
@@ -0,0 +1,107 @@
+// Implements bit-packed kernels for instances whose matrix is the Laplacian
+// of an unweighted graph, as produced by data_gen/erdos_renyi_laplacian.py.
+// For such L and x in {+1, -1}^N,
+//
+//   x'Lx = \sum_{(i, j) \in E} (x_i - x_j)^2 = 4 cut(x),
+//
+// so objective values and the gains of sign flips reduce to counting edges
+// across the cut, which is done with AND/XOR and popcount on rows of the
+// adjacency matrix stored as bitsets.
+//
+// The matrices of nodes below the root are contractions of L (see
+// FreezeMap_transform_matrix) with integer entries, so the kernels work on
+// the original graph: each local variable of a node stands for a group of
+// original vertices with fixed relative signs.
+
+#ifndef __BIT_LAPLACIAN_H__
+#define __BIT_LAPLACIAN_H__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+#include "freeze_map.h"
+
+// A local search starts with O(N^2 / 64) popcounts, and each flip then
+// costs O(N) gain updates from the flipped group's adjacency words, against
+// an O(M^2) product and O(M) per flip for round_local on a dense node matrix
+// of size M. The kernels are used at nodes with
+// M^2 >= BIT_LAPLACIAN_CROSSOVER * N, the crossover measured by
+// bench_bit_laplacian on G(N, 1/2): round_local is faster for M^2 / N up to
+// about 360, and the kernels are 1.2x faster at the root for N = 500, 1.6x
+// for N = 1000 and 3x for N = 2000.
+const int BIT_LAPLACIAN_CROSSOVER = 400;
+
+// Returns whether A is the Laplacian of an unweighted graph, i.e. its
+// off-diagonal entries are 0 or -1 and it is symmetric with zero row sums.
+bool is_unweighted_laplacian(const Eigen::MatrixXd& A);
+
+class BitLaplacian
+{
+ private:
+  int N;
+  int num_words;
+  // Row i of the adjacency matrix occupies words
+  // [i * num_words, (i + 1) * num_words)
+  std::vector<uint64_t> adjacency;
+  std::vector<int> degrees;
+
+ public:
+  // Assumes is_unweighted_laplacian(L).
+  BitLaplacian(const Eigen::MatrixXd& L);
+
+  int size() const { return N; }
+  int get_num_words() const { return num_words; }
+  const uint64_t* row(int i) const { return &adjacency[(long) i * num_words]; }
+  int degree(int i) const { return degrees[i]; }
+};
+
+// Returns a BitLaplacian of A if A is the Laplacian of an unweighted graph,
+// and null otherwise.
+std::shared_ptr<const BitLaplacian> make_bit_laplacian(const Eigen::MatrixXd& A);
+
+// The Laplacian as seen from a node: evaluates z'Bz and searches over z for
+// the node matrix B = FreezeMap_transform_matrix(L, f), by expanding z to the
+// original vertices.
+class BitLaplacianView
+{
+ private:
+  const BitLaplacian* laplacian;
+  int M;
+  // Original vertices of each local variable, and the local variable of
+  // each original vertex
+  std::vector<std::vector<int>> groups;
+  std::vector<int> group_of;
+  // Bitset of each group, M x num_words
+  std::vector<uint64_t> group_masks;
+  // Vertices that are -1 when their representative is +1
+  std::vector<uint64_t> negated_mask;
+  // Number of edges within each group joining vertices of equal sign minus
+  // those joining vertices of opposite sign, which no flip changes
+  std::vector<int> internal_balance;
+
+  // Writes the bitset of vertices that are -1 in the expansion of z.
+  void expand(const Eigen::VectorXd& z, std::vector<uint64_t>& mask) const;
+
+  // Returns the number of edges across the cut given by mask.
+  long cut(const std::vector<uint64_t>& mask) const;
+
+  // Returns the change in the cut from flipping local variable r.
+  long flip_gain(const std::vector<uint64_t>& mask, int r) const;
+
+  // Flips local variable r in mask, and updates the flip gains of all local
+  // variables from the adjacency rows of r's group.
+  void flip(int r, std::vector<uint64_t>& mask, std::vector<long>& gains) const;
+
+ public:
+  BitLaplacianView(const BitLaplacian* laplacian, const FreezeMap* f);
+
+  // Returns z'Bz for a +/- 1 vector z.
+  double value(const Eigen::VectorXd& z) const;
+
+  // Does a greedy search for a local maximum of z'Bz, as round_local, and
+  // returns z'Bz at the maximum.
+  double local_search(Eigen::VectorXd& z) const;
+};
+
+#endif  // __BIT_LAPLACIAN_H__
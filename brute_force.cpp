@@ -1,35 +1,168 @@
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
 #include <Eigen/Dense>
+#include "brute_force.h"
 
 
-void brute_force(const Eigen::MatrixXd& A, Eigen::VectorXd& result) {
+// Enumerates the assignments of x_0, ..., x_{L-1} in Gray code order, with
+// the other entries of x held fixed, keeping Ax up to date so that each step
+// costs O(N). Writes the best assignment to best_x and its value to
+// best_value.
+static void gray_code_search(const Eigen::MatrixXd& A,
+                             int L,
+                             Eigen::VectorXd& x,
+                             double& best_value,
+                             Eigen::VectorXd& best_x) {
   int N = A.rows();
 
-  double best_value = -std::numeric_limits<double>::infinity();
-
-  // Enumerate candidates by binary expansion of numbers between 0 and 2^N - 1.
-  int two_pow_N = 1;
-  for (int i = 0; i < N; i++) {
-    two_pow_N *= 2;
-  }
-  for (int i = 0; i < two_pow_N; i++) {
-    // Set candidate to have +/- 1 entries according to binary expansion of i.
-    Eigen::VectorXd candidate(N);
-    candidate(N - 1) = +1;
-    int k = i / 2;
-    for (int j = 0; j < N - 1; j++) {
-      if (k % 2) {
-        candidate(j) = +1;
-      } else {
-        candidate(j) = -1;
-      }
+  Eigen::VectorXd Ax = A * x;
+  double value = x.dot(Ax);
+  best_value = value;
+  best_x = x;
+
+  const double* A_data = A.data();
+  double* Ax_data = Ax.data();
+  double* x_data = x.data();
 
-      k = k / 2;
+  long long num_steps = 1LL << L;
+  for (long long step = 1; step < num_steps; step++) {
+    // The entry flipped at each step is the lowest set bit of the step
+    int j = __builtin_ctzll(step);
+    double x_j = x_data[j];
+
+    // Flipping x_j changes x'Ax by -4 x_j ((Ax)_j - A_jj x_j)
+    value -= 4.0 * x_j * (Ax_data[j] - A_data[(long) j * N + j] * x_j);
+    x_data[j] = -x_j;
+
+    const double* A_col = A_data + (long) j * N;
+    for (int k = 0; k < N; k++) {
+      Ax_data[k] -= 2.0 * x_j * A_col[k];
     }
 
-    double value = candidate.dot(A * candidate);
     if (value > best_value) {
       best_value = value;
-      result = candidate;
+      best_x = x;
     }
   }
 }
+
+void brute_force(const Eigen::MatrixXd& A, Eigen::VectorXd& result) {
+  int N = A.rows();
+
+  if (N == 0) {
+    result.resize(0);
+    return;
+  }
+
+  // Fixing x_{N-1} = +1 by symmetry leaves N - 1 free entries, of which the
+  // last num_chunk_bits are fixed per chunk
+  int num_free = N - 1;
+  int num_chunk_bits =
+    num_free >= BRUTE_FORCE_PARALLEL_MIN ? BRUTE_FORCE_CHUNK_BITS : 0;
+  int L = num_free - num_chunk_bits;
+  int num_chunks = 1 << num_chunk_bits;
+
+  std::vector<double> chunk_values(num_chunks);
+  std::vector<Eigen::VectorXd> chunk_optimizers(num_chunks);
+
+#pragma omp parallel for schedule(dynamic) if (num_chunks > 1)
+  for (int chunk = 0; chunk < num_chunks; chunk++) {
+    Eigen::VectorXd x = Eigen::VectorXd::Ones(N);
+    for (int b = 0; b < num_chunk_bits; b++) {
+      if ((chunk >> b) & 1) {
+        x(L + b) = -1;
+      }
+    }
+    gray_code_search(A, L, x, chunk_values[chunk], chunk_optimizers[chunk]);
+  }
+
+  // Ties are broken by the lowest chunk, so that results do not depend on
+  // the number of threads
+  int best_chunk = 0;
+  for (int chunk = 1; chunk < num_chunks; chunk++) {
+    if (chunk_values[chunk] > chunk_values[best_chunk]) {
+      best_chunk = chunk;
+    }
+  }
+
+  result = chunk_optimizers[best_chunk];
+}
+
+// Work of brute force on M variables, in units of Gray code steps of O(M).
+static double brute_force_cost(int M) {
+  return std::ldexp((double) M, M - 1);
+}
+
+// Work of the SDP on M variables.
+static double sdp_cost(int M) {
+  return (double) M * M * M;
+}
+
+LeafSizeTuner::LeafSizeTuner(int leaf_size) {
+  this->adaptive = leaf_size == BRUTE_FORCE_LEAF_SIZE_AUTO;
+  this->leaf_size = adaptive ? BRUTE_FORCE_DEFAULT_LEAF_SIZE : leaf_size;
+  this->brute_force_seconds = 0;
+  this->brute_force_work = 0;
+  this->sdp_seconds = 0;
+  this->sdp_work = 0;
+
+  if (adaptive) {
+    // Calibrate on a random problem large enough to time reliably
+    int M = BRUTE_FORCE_PARALLEL_MIN;
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+    Eigen::MatrixXd A(M, M);
+    for (int i = 0; i < M; i++) {
+      for (int j = 0; j <= i; j++) {
+        A(i, j) = A(j, i) = distribution(generator);
+      }
+    }
+
+    Eigen::VectorXd x;
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    brute_force(A, x);
+    std::chrono::steady_clock::time_point end =
+      std::chrono::steady_clock::now();
+
+    record(M, true, std::chrono::duration<double>(end - start).count());
+  }
+}
+
+void LeafSizeTuner::record(int M, bool brute_forced, double seconds) {
+  if (!adaptive || M <= 0) {
+    return;
+  }
+
+  if (brute_forced) {
+    brute_force_seconds += seconds;
+    brute_force_work += brute_force_cost(M);
+  } else {
+    sdp_seconds += seconds;
+    sdp_work += sdp_cost(M);
+  }
+
+  update_leaf_size();
+}
+
+void LeafSizeTuner::update_leaf_size() {
+  if (brute_force_work == 0 || sdp_work == 0) {
+    return;
+  }
+
+  double brute_force_rate = brute_force_seconds / brute_force_work;
+  double sdp_rate = sdp_seconds / sdp_work;
+
+  // Brute force grows faster than the SDP, so take the largest size at which
+  // it is still cheaper
+  int M = BRUTE_FORCE_DEFAULT_LEAF_SIZE;
+  while (M < BRUTE_FORCE_MAX_LEAF_SIZE &&
+         brute_force_rate * brute_force_cost(M + 1) <=
+         BRUTE_FORCE_SDP_SOLVES * sdp_rate * sdp_cost(M + 1)) {
+    M++;
+  }
+  leaf_size = M;
+}
@@ -1,6 +1,65 @@
 // Implements brute force solution by enumeration of the +/- 1 quadratic
 // optimization problem. (Only tractable for small instances.)
 
+#ifndef __BRUTE_FORCE_H__
+#define __BRUTE_FORCE_H__
+
 #include <Eigen/Dense>
 
+// Number of free variables up to which nodes are solved by brute force
+// instead of by the SDP, unless set on the command line.
+const int BRUTE_FORCE_DEFAULT_LEAF_SIZE = 6;
+
+// Leaf size meaning that it is chosen adaptively by LeafSizeTuner.
+const int BRUTE_FORCE_LEAF_SIZE_AUTO = -1;
+
+// Upper limit on adaptively chosen leaf sizes.
+const int BRUTE_FORCE_MAX_LEAF_SIZE = 32;
+
+// Problems with at least this many variables are enumerated in parallel.
+const int BRUTE_FORCE_PARALLEL_MIN = 16;
+
+// Number of leading variables fixed per parallel chunk, giving 2^8 chunks.
+const int BRUTE_FORCE_CHUNK_BITS = 8;
+
+// Number of SDP solves of the same size that a brute force solve may cost
+// when the leaf size is chosen adaptively. A node that is not pruned costs
+// at least one solve and spawns two more.
+const double BRUTE_FORCE_SDP_SOLVES = 3.0;
+
+// Enumerates the 2^(N-1) sign vectors with x_{N-1} = +1 in Gray code order,
+// which changes one entry per step and so updates x'Ax in O(N), in parallel
+// with OpenMP. Writes the maximizer to result.
 void brute_force(const Eigen::MatrixXd& A, Eigen::VectorXd& result);
+
+// Chooses the number of free variables up to which nodes are solved by brute
+// force. A fixed leaf size is returned as is. In adaptive mode, the time per
+// unit of work of brute force (2^(M-1) M) and of the SDP (M^3) is measured
+// on the nodes a worker executes, and the leaf size is the largest M for
+// which brute force is predicted to cost at most BRUTE_FORCE_SDP_SOLVES SDP
+// solves.
+class LeafSizeTuner
+{
+ private:
+  int leaf_size;
+  bool adaptive;
+  double brute_force_seconds;
+  double brute_force_work;
+  double sdp_seconds;
+  double sdp_work;
+
+  void update_leaf_size();
+
+ public:
+  // Takes a leaf size, or BRUTE_FORCE_LEAF_SIZE_AUTO. In adaptive mode,
+  // brute force is calibrated on a small random problem.
+  LeafSizeTuner(int leaf_size);
+
+  int get_leaf_size() const { return leaf_size; }
+
+  // Records the time taken by one brute force solve or one SDP solve of a
+  // node with M free variables.
+  void record(int M, bool brute_forced, double seconds);
+};
+
+#endif  // __BRUTE_FORCE_H__
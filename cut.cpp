@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <Eigen/Dense>
+#ifndef MCBB_NO_MOSEK
+#include "fusion.h"
+#endif
+#include "cut.h"
+
+static_assert(sizeof(Cut) == CUT_RECORD_SIZE * sizeof(int),
+              "a Cut must be laid out as its record");
+static_assert(std::is_trivially_copyable<Cut>::value,
+              "a Cut must copy as plain memory");
+
+Cut::Cut() : type(-1), num_vertices(0), signs(0) {
+  std::fill(vertices, vertices + CUT_MAX_VERTICES, -1);
+}
+
+Cut Cut::triangle(int i, int j, int k, int sign_ij, int sign_ik, int sign_jk) {
+  // With b_i = 1, the point signs are b_j = sign_ij and b_k = sign_ik, and
+  // sign_jk = b_j b_k since the product of the signs is 1
+  int v[3] = { i, j, k };
+  int b[3] = { 1, sign_ij, sign_ik };
+  (void) sign_jk;
+  return hypermetric(3, v, b);
+}
+
+Cut Cut::hypermetric(int k, const int* v, const int* b) {
+  // Sort the points, and flip all signs (which leaves the inequality
+  // unchanged) so that the first is +1
+  std::pair<int, int> points[CUT_MAX_VERTICES];
+  for (int t = 0; t < k; t++) {
+    points[t] = std::make_pair(v[t], b[t]);
+  }
+  std::sort(points, points + k);
+  int flip = points[0].second;
+
+  Cut cut;
+  cut.type = CUT_HYPERMETRIC;
+  cut.num_vertices = k;
+  cut.signs = 0;
+  for (int t = 0; t < k; t++) {
+    cut.vertices[t] = points[t].first;
+    if (points[t].second * flip < 0) {
+      cut.signs |= 1 << t;
+    }
+  }
+  return cut;
+}
+
+Cut Cut::odd_cycle(int k, const int* v, const int* s) {
+  // Start the cycle at its least point, and traverse it towards the lesser
+  // of that point's neighbors
+  int start = std::min_element(v, v + k) - v;
+  bool reverse = v[(start + k - 1) % k] < v[(start + 1) % k];
+
+  Cut cut;
+  cut.type = CUT_ODD_CYCLE;
+  cut.num_vertices = k;
+  cut.signs = 0;
+  for (int t = 0; t < k; t++) {
+    int edge;
+    if (reverse) {
+      cut.vertices[t] = v[(start - t + k) % k];
+      edge = (start - t - 1 + 2 * k) % k;
+    } else {
+      cut.vertices[t] = v[(start + t) % k];
+      edge = (start + t) % k;
+    }
+    if (s[edge] < 0) {
+      cut.signs |= 1 << t;
+    }
+  }
+  return cut;
+}
+
+Cut::Cut(const int* buffer) {
+  // Copying raw memory into a trivially copyable object is valid, which the
+  // cast to void* tells GCC despite the user-provided constructor
+  std::memcpy(static_cast<void*>(this), buffer, sizeof(Cut));
+}
+
+void Cut::serialize(int* buffer) const {
+  std::memcpy(buffer, this, sizeof(Cut));
+}
+
+CutKey Cut::get_key() const {
+  CutKey key;
+  serialize(key.data());
+  return key;
+}
+
+int Cut::get_num_terms() const {
+  if (type == CUT_HYPERMETRIC) {
+    return num_vertices * (num_vertices - 1) / 2;
+  }
+  return num_vertices;
+}
+
+int Cut::get_terms(int* a, int* b, double* coef) const {
+  int num_terms = 0;
+  if (type == CUT_HYPERMETRIC) {
+    for (int s = 0; s < num_vertices; s++) {
+      for (int t = s + 1; t < num_vertices; t++) {
+        a[num_terms] = vertices[s];
+        b[num_terms] = vertices[t];
+        coef[num_terms] = get_sign(s) * get_sign(t);
+        num_terms++;
+      }
+    }
+  } else {
+    for (int t = 0; t < num_vertices; t++) {
+      a[num_terms] = vertices[t];
+      b[num_terms] = vertices[(t + 1) % num_vertices];
+      coef[num_terms] = get_sign(t);
+      num_terms++;
+    }
+  }
+  return num_terms;
+}
+
+double Cut::get_rhs() const {
+  if (type == CUT_HYPERMETRIC) {
+    return 0.5 * (1 - num_vertices);
+  }
+  return 2 - num_vertices;
+}
+
+double Cut::eval(const Eigen::MatrixXd& X) const {
+  int a[CUT_MAX_TERMS];
+  int b[CUT_MAX_TERMS];
+  double coef[CUT_MAX_TERMS];
+  int num_terms = get_terms(a, b, coef);
+
+  double lhs = 0;
+  for (int t = 0; t < num_terms; t++) {
+    lhs += coef[t] * X(a[t], b[t]);
+  }
+  return lhs - get_rhs();
+}
+
+bool Cut::transform(const std::vector<int>& map,
+                    const std::vector<int>* sign,
+                    Cut& out) const {
+  int v[CUT_MAX_VERTICES];
+  int s[CUT_MAX_VERTICES];
+  for (int t = 0; t < num_vertices; t++) {
+    v[t] = map[vertices[t]];
+    if (v[t] < 0) {
+      return false;
+    }
+    for (int u = 0; u < t; u++) {
+      if (v[u] == v[t]) {
+        return false;
+      }
+    }
+  }
+
+  for (int t = 0; t < num_vertices; t++) {
+    s[t] = get_sign(t);
+    if (sign == NULL) {
+      continue;
+    }
+    if (type == CUT_HYPERMETRIC) {
+      s[t] *= (*sign)[vertices[t]];
+    } else {
+      s[t] *= (*sign)[vertices[t]] *
+        (*sign)[vertices[(t + 1) % num_vertices]];
+    }
+  }
+
+  if (type == CUT_HYPERMETRIC) {
+    out = hypermetric(num_vertices, v, s);
+  } else {
+    out = odd_cycle(num_vertices, v, s);
+  }
+  return true;
+}
+
+#ifndef MCBB_NO_MOSEK
+static mosek::fusion::Expression::t cut_lhs(mosek::fusion::Variable::t X,
+                                            const Cut& cut) {
+  int a[CUT_MAX_TERMS];
+  int b[CUT_MAX_TERMS];
+  double coef[CUT_MAX_TERMS];
+  int num_terms = cut.get_terms(a, b, coef);
+
+  mosek::fusion::Expression::t expr_lhs =
+    mosek::fusion::Expr::mul(X->index(a[0], b[0]), coef[0]);
+  for (int t = 1; t < num_terms; t++) {
+    expr_lhs =
+      mosek::fusion::Expr::add(expr_lhs,
+                               mosek::fusion::Expr::mul(X->index(a[t], b[t]),
+                                                        coef[t]));
+  }
+
+  return expr_lhs;
+}
+
+mosek::fusion::Constraint::t Cut::add_to_model(
+    mosek::fusion::Model::t model,
+    mosek::fusion::Variable::t X) const {
+  return model->constraint(cut_lhs(X, *this),
+                           mosek::fusion::Domain::greaterThan(get_rhs()));
+}
+#endif
+
+#ifdef MCBB_MOSEK_PARAMETERS
+mosek::fusion::Constraint::t Cut::add_to_model(
+    mosek::fusion::Model::t model,
+    mosek::fusion::Variable::t X,
+    mosek::fusion::Parameter::t p) const {
+  mosek::fusion::Expression::t expr_lhs =
+    mosek::fusion::Expr::add(cut_lhs(X, *this), p);
+
+  return model->constraint(expr_lhs,
+                           mosek::fusion::Domain::greaterThan(get_rhs()));
+}
+#endif
+
+int CutList_int_size(int M) {
+  return 1 + CUT_RECORD_SIZE * M;
+}
+
+void CutList_serialize(const CutList& cuts, int* buffer) {
+  buffer[0] = cuts.size();
+  std::memcpy(buffer + 1, cuts.data(), cuts.size() * sizeof(Cut));
+}
+
+void CutList_deserialize(const int* buffer, CutList* cuts) {
+  cuts->resize(buffer[0]);
+  std::memcpy(static_cast<void*>(cuts->data()),
+              buffer + 1,
+              cuts->size() * sizeof(Cut));
+}
+
+bool CutList_transform(CutList* cuts,
+                       const std::vector<int>& map,
+                       const std::vector<int>* sign) {
+  bool ok = true;
+  for (Cut& cut : *cuts) {
+    ok = cut.transform(map, sign, cut) && ok;
+  }
+  return ok;
+}
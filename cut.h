@@ -0,0 +1,147 @@
+// Implements the valid inequalities for the cut polytope that are added to
+// the SDP, each of the form sum_t coef_t X_{a_t b_t} >= rhs. Two families
+// are supported:
+//
+// - Hypermetric inequalities on k points v_1, ..., v_k (k odd) with signs
+//   b_1, ..., b_k, sum_{s < t} b_s b_t X_{v_s v_t} >= (1 - k) / 2, which hold
+//   since |sum_t b_t x_{v_t}| >= 1 for x in {-1, +1}^N. Triangle
+//   inequalities are those with k = 3, and pentagonal ones those with k = 5.
+// - Odd-cycle inequalities on a cycle v_1, ..., v_k with edge signs
+//   s_1, ..., s_k, an odd number of which are +1, where edge t joins v_t and
+//   v_{t+1} (and edge k joins v_k and v_1):
+//   sum_t s_t X_{v_t v_{t+1}} >= 2 - k. They hold since an odd number of the
+//   terms s_t x_{v_t} x_{v_{t+1}} must be -1.
+//
+// Cuts are normalized on construction, so that equal inequalities have equal
+// keys. A Cut is laid out as its serialized record, so that lists of cuts are
+// contiguous and copy as plain memory.
+
+#ifndef __CUT_H__
+#define __CUT_H__
+
+#include <array>
+#include <vector>
+#include <Eigen/Dense>
+#ifndef MCBB_NO_MOSEK
+#include "fusion.h"
+#include "mosek.h"
+// Fusion parameters, which allow updating a model in place, are available
+// from MOSEK 9.2 on.
+#if MSK_VERSION_MAJOR > 9 || (MSK_VERSION_MAJOR == 9 && MSK_VERSION_MINOR >= 2)
+#define MCBB_MOSEK_PARAMETERS
+#endif
+#endif
+
+enum CutType {
+  CUT_HYPERMETRIC = 0,
+  CUT_ODD_CYCLE = 1,
+};
+
+// Maximum number of points of a cut, and of terms of its left hand side.
+const int CUT_MAX_VERTICES = 8;
+const int CUT_MAX_TERMS = CUT_MAX_VERTICES * (CUT_MAX_VERTICES - 1) / 2;
+
+// Length of a serialized cut: its type, number of points, signs and points,
+// the unused points being -1.
+const int CUT_RECORD_SIZE = 3 + CUT_MAX_VERTICES;
+
+// Identifies a cut by its serialized record.
+typedef std::array<int, CUT_RECORD_SIZE> CutKey;
+
+class Cut
+{
+ private:
+  int type;
+  int num_vertices;
+  // Bit t is set if the sign of point t (for hypermetric inequalities) or of
+  // edge t (for odd-cycle inequalities) is -1
+  int signs;
+  int vertices[CUT_MAX_VERTICES];
+
+ public:
+  // An empty cut, to be assigned to
+  Cut();
+
+  // The triangle inequality
+  // sign_ij X_ij + sign_ik X_ik + sign_jk X_jk >= -1,
+  // where sign_ij sign_ik sign_jk = 1.
+  static Cut triangle(int i, int j, int k, int sign_ij, int sign_ik,
+                      int sign_jk);
+
+  // The hypermetric inequality on the k distinct points v with signs b.
+  static Cut hypermetric(int k, const int* v, const int* b);
+
+  // The odd-cycle inequality on the cycle of k distinct points v with edge
+  // signs s, an odd number of which are +1.
+  static Cut odd_cycle(int k, const int* v, const int* s);
+
+  // Reads a cut from its record.
+  Cut(const int* buffer);
+
+  int get_type() const { return type; }
+  int get_num_vertices() const { return num_vertices; }
+  int get_vertex(int t) const { return vertices[t]; }
+  int get_sign(int t) const { return (signs >> t) & 1 ? -1 : 1; }
+
+  CutKey get_key() const;
+
+  int get_num_terms() const;
+
+  // Writes the terms of the left hand side to a, b and coef, which must have
+  // room for CUT_MAX_TERMS entries, and returns their number.
+  int get_terms(int* a, int* b, double* coef) const;
+
+  double get_rhs() const;
+
+  // Returns the slack of the inequality in X, which is negative if X
+  // violates it.
+  double eval(const Eigen::MatrixXd& X) const;
+
+  // Writes to out the inequality obtained by substituting
+  // x_v = sign[v] x_{map[v]} for each point v (or x_v = x_{map[v]} if sign is
+  // null). Returns false, leaving out unchanged, if a point maps to a
+  // negative index or two points map to the same index. out may be this
+  // cut.
+  bool transform(const std::vector<int>& map,
+                 const std::vector<int>* sign,
+                 Cut& out) const;
+
+#ifndef MCBB_NO_MOSEK
+  mosek::fusion::Constraint::t add_to_model(mosek::fusion::Model::t model,
+                                            mosek::fusion::Variable::t X) const;
+#endif
+#ifdef MCBB_MOSEK_PARAMETERS
+  // Adds the inequality relaxed by the scalar parameter p, as
+  // lhs + p >= rhs. Setting p = 0 enforces the inequality, and setting p
+  // above rhs + get_num_terms() makes it vacuous for any feasible X.
+  mosek::fusion::Constraint::t add_to_model(
+      mosek::fusion::Model::t model,
+      mosek::fusion::Variable::t X,
+      mosek::fusion::Parameter::t p) const;
+#endif
+
+  void serialize(int* buffer) const;
+};
+
+// A list of cuts, stored contiguously. Lists are passed by reference and
+// translated between index spaces in place, so that no cut is allocated on
+// its own.
+typedef std::vector<Cut> CutList;
+
+// Length of a buffer holding up to M cuts: the number of cuts followed by
+// their records.
+int CutList_int_size(int M);
+
+// Serializes cuts, which must have at most M entries, to a buffer of length
+// CutList_int_size(M) with a single copy of their records.
+void CutList_serialize(const CutList& cuts, int* buffer);
+
+void CutList_deserialize(const int* buffer, CutList* cuts);
+
+// Applies Cut::transform to every cut of cuts in place. Returns false if any
+// of them fails, in which case the failing cuts are left unchanged.
+bool CutList_transform(CutList* cuts,
+                       const std::vector<int>& map,
+                       const std::vector<int>* sign);
+
+#endif  // __CUT_H__
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "cut.h"
+#include "cut_pool.h"
+#include "freeze_map.h"
+#include "node.h"
+
+double CutPool::score(const Entry& entry) {
+  return (entry.tight + 1.0) / (entry.uses + 2.0) + 1e-3 * entry.violation;
+}
+
+void CutPool::evict() {
+  if ((int) cuts.size() <= CUT_POOL_MAX_SIZE) {
+    return;
+  }
+
+  std::vector<std::pair<double, CutKey>> scored;
+  scored.reserve(cuts.size());
+  for (const std::pair<const CutKey, Entry>& cut : cuts) {
+    scored.push_back(std::make_pair(score(cut.second), cut.first));
+  }
+
+  int num_evicted = cuts.size() - CUT_POOL_MAX_SIZE;
+  std::nth_element(scored.begin(),
+                   scored.begin() + num_evicted,
+                   scored.end());
+  for (int i = 0; i < num_evicted; i++) {
+    cuts.erase(scored[i].second);
+  }
+}
+
+void CutPool::update(const Node* node) {
+  const std::vector<CutKey>& sources =
+    node->get_inequality_sources();
+  const Eigen::VectorXd& slacks = node->get_inequality_slacks();
+
+  if ((int) sources.size() == slacks.size()) {
+    for (int i = 0; i < slacks.size(); i++) {
+      if (sources[i] == no_source() || std::isnan(slacks(i))) {
+        continue;
+      }
+      std::map<CutKey, Entry>::iterator it =
+        cuts.find(sources[i]);
+      if (it == cuts.end()) {
+        continue;
+      }
+
+      it->second.uses++;
+      if (slacks(i) <= CUT_POOL_TIGHT_TOLERANCE) {
+        it->second.tight++;
+        it->second.age = 0;
+      } else if (++it->second.age >= CUT_POOL_MAX_AGE) {
+        cuts.erase(it);
+      }
+    }
+  }
+
+  const Eigen::VectorXd& values = node->get_post_inequality_values();
+  int ineq_ix = 0;
+  for (const Cut& ineq :
+         node->get_post_inequalities()) {
+    if (ineq_ix < values.size() &&
+        values(ineq_ix) < -CUT_POOL_MIN_VIOLATION) {
+      std::pair<std::map<CutKey, Entry>::iterator, bool> ret =
+        cuts.insert(std::make_pair(ineq.get_key(), Entry()));
+      Entry& entry = ret.first->second;
+      if (ret.second) {
+        entry.violation = 0;
+        entry.uses = 0;
+        entry.tight = 0;
+        entry.age = 0;
+      }
+      entry.violation = std::max(entry.violation, -values(ineq_ix));
+    }
+    ineq_ix++;
+  }
+
+  evict();
+}
+
+void CutPool::attach(Node* node, int count) const {
+  int N = node->get_initial_A()->rows();
+  const FreezeMap* freezes = node->get_freeze_map();
+
+  std::vector<int> rep(N);
+  std::vector<int> sign(N);
+  freezes->resolve(rep.data(), sign.data());
+
+  CutList inequalities = node->get_inequalities();
+  std::vector<CutKey> sources(inequalities.size(), no_source());
+  std::set<CutKey> present;
+  for (const Cut& ineq : inequalities) {
+    present.insert(ineq.get_key());
+  }
+
+  // Best (score, pool key) of each translated key, as two pool inequalities
+  // may translate to the same one
+  std::map<CutKey, std::pair<double, CutKey>> best;
+  for (const std::pair<const CutKey, Entry>& cut : cuts) {
+    // A cut is degenerate at the node if two of its points share a
+    // representative
+    Cut translated;
+    if (!Cut(cut.first.data()).transform(rep, &sign, translated) ||
+        present.count(translated.get_key()) > 0) {
+      continue;
+    }
+    std::pair<double, CutKey> candidate(score(cut.second), cut.first);
+    std::pair<std::map<CutKey, std::pair<double, CutKey>>::iterator, bool>
+      ret = best.insert(std::make_pair(translated.get_key(), candidate));
+    if (!ret.second && ret.first->second.first < candidate.first) {
+      ret.first->second = candidate;
+    }
+  }
+
+  // (score, translated key, pool key) of the candidates
+  typedef std::tuple<double, CutKey, CutKey>
+    Candidate;
+  std::vector<Candidate> candidates;
+  candidates.reserve(best.size());
+  for (const std::pair<const CutKey, std::pair<double, CutKey>>& entry :
+         best) {
+    candidates.push_back(Candidate(entry.second.first,
+                                   entry.first,
+                                   entry.second.second));
+  }
+
+  int num_attached = std::min(count, (int) candidates.size());
+  std::partial_sort(candidates.begin(),
+                    candidates.begin() + num_attached,
+                    candidates.end(),
+                    [](const Candidate& lhs, const Candidate& rhs) {
+                      return std::get<0>(lhs) > std::get<0>(rhs);
+                    });
+
+  for (int i = 0; i < num_attached; i++) {
+    inequalities.push_back(Cut(std::get<1>(candidates[i]).data()));
+    sources.push_back(std::get<2>(candidates[i]));
+  }
+
+  node->set_inequalities(std::move(inequalities));
+  node->set_inequality_sources(sources);
+}
+
+CutKey CutPool::no_source() {
+  CutKey key;
+  key.fill(-1);
+  return key;
+}
@@ -0,0 +1,77 @@
+// Implements a pool of inequalities (see cut.h) kept by the root process, so
+// that inequalities found in one subtree can be used in the rest of the
+// search. Without it, inequalities only pass from a node to its children.
+//
+// Inequalities are kept in original indices. Such an inequality is valid for
+// every +/- 1 vector, so it also holds at any node, where it is translated to
+// the representatives of its indices: if x_i = s_i x_{r(i)} and likewise for
+// j, then X_ij = s_i s_j X_{r(i) r(j)} at the node.
+
+#ifndef __CUT_POOL_H__
+#define __CUT_POOL_H__
+
+#include <map>
+#include <vector>
+#include "node.h"
+#include "cut.h"
+
+// Maximum number of inequalities in the pool. Beyond this, those with the
+// lowest scores are evicted.
+const int CUT_POOL_MAX_SIZE = 10000;
+
+// Post inequalities of a node enter the pool if its SDP solution violates
+// them by more than this.
+const double CUT_POOL_MIN_VIOLATION = 1e-4;
+
+// An inequality with at most this slack in a node's SDP solution counts as
+// tight at that node.
+const double CUT_POOL_TIGHT_TOLERANCE = 1e-4;
+
+// An inequality is dropped from the pool after it is slack at this many
+// consecutive nodes that it was attached to.
+const int CUT_POOL_MAX_AGE = 8;
+
+class CutPool
+{
+ private:
+  struct Entry {
+    // Largest violation seen by a node that separated the inequality
+    double violation;
+    // Number of nodes whose SDP included the inequality, and at how many of
+    // them it was tight
+    int uses;
+    int tight;
+    // Number of consecutive nodes at which the inequality was slack
+    int age;
+  };
+
+  std::map<CutKey, Entry> cuts;
+
+  // Orders entries by the fraction of uses at which they were tight, with a
+  // prior of one tight use in two, and then by violation.
+  static double score(const Entry& entry);
+
+  void evict();
+
+ public:
+  CutPool() {}
+
+  // Records which of the inequalities of an executed node were tight, for
+  // those attached from the pool, and adds its violated post inequalities.
+  void update(const Node* node);
+
+  // Appends up to count inequalities from the pool to the inequalities of
+  // node, those with the highest scores among the ones that are not
+  // degenerate at the node and that it does not have yet, and sets the
+  // node's inequality sources. Pool inequalities that translate to the same
+  // one at the node count once, with the highest of their scores.
+  void attach(Node* node, int count) const;
+
+  // Source of the inequalities of a node that were not attached from the
+  // pool, such as those inherited from its parent, which is no pool key.
+  static CutKey no_source();
+
+  int size() const { return cuts.size(); }
+};
+
+#endif  // __CUT_POOL_H__
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <set>
+#include <vector>
+#include <Eigen/Dense>
+#include "cutting_plane.h"
+#include "freeze_map.h"
+#include "cut.h"
+#include "sdp.h"
+#include "separation.h"
+
+CuttingPlaneTuner::CuttingPlaneTuner(int max_rounds, int cuts_per_round) {
+  this->max_rounds = max_rounds;
+  this->cuts_per_round = std::max(CUTTING_PLANE_MIN_CUTS,
+                                  std::min(CUTTING_PLANE_MAX_CUTS,
+                                           cuts_per_round));
+}
+
+void CuttingPlaneTuner::record(double round_seconds,
+                               double first_solve_seconds) {
+  if (round_seconds > CUTTING_PLANE_ROUND_TIME * first_solve_seconds) {
+    cuts_per_round = std::max(CUTTING_PLANE_MIN_CUTS, cuts_per_round / 2);
+  } else if (round_seconds <
+             0.5 * CUTTING_PLANE_ROUND_TIME * first_solve_seconds) {
+    cuts_per_round = std::min(CUTTING_PLANE_MAX_CUTS,
+                              cuts_per_round + (cuts_per_round + 1) / 2);
+  }
+}
+
+bool cutting_plane_rounds(
+    const Eigen::MatrixXd& A,
+    SdpSolver* solver,
+    double cutoff,
+    double first_solve_seconds,
+    CuttingPlaneTuner* tuner,
+    const CutFamilies& families,
+    CutList& inequalities,
+    Eigen::MatrixXd& X,
+    double& upper_bound,
+    SdpState& state,
+    int& iterations) {
+  int N = A.rows();
+
+  // Separation works in the indices of a FreezeMap, here the identity
+  FreezeMap identity(N);
+
+  for (int round = 0; round < tuner->get_max_rounds(); round++) {
+    // Keep the inequalities that are nearly tight, with their multipliers
+    CutList next_inequalities;
+    std::vector<double> next_multipliers;
+    std::set<CutKey> present;
+    bool has_multipliers =
+      state.multipliers.size() == (int) inequalities.size();
+    int ineq_ix = 0;
+    for (const Cut& ineq : inequalities) {
+      if (ineq.eval(X) <= CUTTING_PLANE_DROP_SLACK) {
+        next_inequalities.push_back(ineq);
+        next_multipliers.push_back(
+          has_multipliers ? state.multipliers(ineq_ix) : 0.0);
+        present.insert(ineq.get_key());
+      }
+      ineq_ix++;
+    }
+
+    CutList separated;
+    choose_best_cuts(X,
+                     identity,
+                     std::set<int>(),
+                     tuner->get_cuts_per_round(),
+                     families,
+                     separated);
+    int num_added = 0;
+    for (const Cut& ineq : separated) {
+      if (ineq.eval(X) < -CUTTING_PLANE_MIN_VIOLATION &&
+          present.insert(ineq.get_key()).second) {
+        next_inequalities.push_back(ineq);
+        next_multipliers.push_back(0.0);
+        num_added++;
+      }
+    }
+    if (num_added == 0) {
+      break;
+    }
+
+    SdpState start;
+    start.V = state.V;
+    start.multipliers = Eigen::Map<Eigen::VectorXd>(next_multipliers.data(),
+                                                    next_multipliers.size());
+
+    std::chrono::steady_clock::time_point round_start =
+      std::chrono::steady_clock::now();
+
+    Eigen::MatrixXd next_X(N, N);
+    double next_upper_bound;
+    SdpState next_state;
+    bool pruned = solver->solve(A,
+                                next_inequalities,
+                                start.V.rows() == N ? &start : NULL,
+                                cutoff,
+                                next_X,
+                                next_upper_bound,
+                                next_state);
+
+    std::chrono::steady_clock::time_point round_end =
+      std::chrono::steady_clock::now();
+    tuner->record(
+      std::chrono::duration<double>(round_end - round_start).count(),
+      first_solve_seconds);
+    iterations += next_state.iterations;
+
+    if (pruned) {
+      upper_bound = next_upper_bound;
+      return true;
+    }
+
+    // A looser certificate can make the bound worse, in which case the last
+    // solution is kept
+    double improvement = upper_bound - next_upper_bound;
+    if (improvement <= 0) {
+      break;
+    }
+
+    inequalities.swap(next_inequalities);
+    X = next_X;
+    upper_bound = next_upper_bound;
+    state = next_state;
+
+    if (improvement <
+        CUTTING_PLANE_MIN_IMPROVEMENT * std::max(1.0, std::abs(upper_bound))) {
+      break;
+    }
+  }
+
+  return false;
+}
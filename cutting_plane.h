@@ -0,0 +1,74 @@
+// Implements cutting-plane rounds at a node: after the node's SDP is solved,
+// the inequalities most violated by its solution are added, those
+// with large slack are dropped, and the SDP is solved again from the previous
+// solution, which tightens the node's bound before it branches.
+
+#ifndef __CUTTING_PLANE_H__
+#define __CUTTING_PLANE_H__
+
+#include <memory>
+#include <Eigen/Dense>
+#include "cut.h"
+#include "sdp.h"
+#include "separation.h"
+
+// Rounds stop once a round improves the bound by less than this fraction.
+const double CUTTING_PLANE_MIN_IMPROVEMENT = 1e-3;
+
+// Inequalities are added if the solution violates them by more than this.
+const double CUTTING_PLANE_MIN_VIOLATION = 1e-4;
+
+// Inequalities with more slack than this in the solution are dropped.
+const double CUTTING_PLANE_DROP_SLACK = 0.1;
+
+// Bounds on the number of inequalities added per round.
+const int CUTTING_PLANE_MIN_CUTS = 5;
+const int CUTTING_PLANE_MAX_CUTS = 500;
+
+// Target time of a round, as a multiple of the time of the node's first
+// solve. The number of inequalities added per round is halved when rounds
+// take longer than this, and grown by half when they take less than half.
+const double CUTTING_PLANE_ROUND_TIME = 1.0;
+
+// Chooses the number of inequalities added per round on a worker, from the
+// measured times of rounds at the nodes it executes.
+class CuttingPlaneTuner
+{
+ private:
+  int max_rounds;
+  int cuts_per_round;
+
+ public:
+  // Takes the maximum number of rounds per node, and the initial number of
+  // inequalities added per round.
+  CuttingPlaneTuner(int max_rounds, int cuts_per_round);
+
+  int get_max_rounds() const { return max_rounds; }
+  int get_cuts_per_round() const { return cuts_per_round; }
+
+  // Records the time of a round and of the first solve at the same node.
+  void record(double round_seconds, double first_solve_seconds);
+};
+
+// Runs up to tuner->get_max_rounds() cutting-plane rounds on the SDP of A with
+// inequalities in local indices, separating those of the given families,
+// starting from its solution X with upper bound upper_bound and state state,
+// which are replaced by those of the last round that improved the bound, as
+// are the inequalities. Stops early when
+// no inequality is violated, when a round improves the bound by too little,
+// or when a solve proves the bound below cutoff, in which case it returns
+// true. Adds the iterations of the rounds to iterations.
+bool cutting_plane_rounds(
+    const Eigen::MatrixXd& A,
+    SdpSolver* solver,
+    double cutoff,
+    double first_solve_seconds,
+    CuttingPlaneTuner* tuner,
+    const CutFamilies& families,
+    CutList& inequalities,
+    Eigen::MatrixXd& X,
+    double& upper_bound,
+    SdpState& state,
+    int& iterations);
+
+#endif  // __CUTTING_PLANE_H__
@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <iostream>
 #include <fstream>
 #include <Eigen/Dense>
 #include <string>
+#include "eigen_util.h"
 
 // Implementation based on:
 // https://gist.github.com/infusion/43bd2aa421790d5b4582
@@ -11,7 +15,9 @@ Eigen::MatrixXd read_csv(std::string filename) {
 
   int N = 0;
   while (std::getline(in_file, line)) {
-    N++;
+    if (line.rfind("#", 0) != 0) {
+      N++;
+    }
   }
 
   in_file.clear();
@@ -48,3 +54,81 @@ Eigen::MatrixXd read_csv(std::string filename) {
 
   return A;
 }
+
+double max_eigenvalue_upper_bound(const Eigen::MatrixXd& G) {
+  int N = G.rows();
+  if (N == 0) {
+    return 0.0;
+  }
+
+  int K = std::min(N, LANCZOS_STEPS);
+
+  // Lanczos with full reorthogonalization, which is cheap for K << N. The
+  // start vector is fixed so that results are reproducible.
+  Eigen::MatrixXd Q(N, K);
+  Eigen::VectorXd alpha(K);
+  Eigen::VectorXd beta(K);
+  Eigen::VectorXd q = Eigen::VectorXd::LinSpaced(N, 1.0, 2.0);
+  q.normalize();
+  int steps = 0;
+  for (int k = 0; k < K; k++) {
+    Q.col(k) = q;
+    Eigen::VectorXd w = G * q;
+    alpha(k) = q.dot(w);
+    w -= Q.leftCols(k + 1) * (Q.leftCols(k + 1).transpose() * w);
+    beta(k) = w.norm();
+    steps++;
+    if (beta(k) <= 1e-12 * std::abs(alpha(k)) || beta(k) == 0) {
+      // Invariant subspace found
+      break;
+    }
+    q = w / beta(k);
+  }
+
+  Eigen::MatrixXd T = Eigen::MatrixXd::Zero(steps, steps);
+  for (int k = 0; k < steps; k++) {
+    T(k, k) = alpha(k);
+    if (k + 1 < steps) {
+      T(k, k + 1) = beta(k);
+      T(k + 1, k) = beta(k);
+    }
+  }
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> tridiagonal_solver(T);
+  double theta = tridiagonal_solver.eigenvalues()(steps - 1);
+
+  // The Ritz value is within the residual of some eigenvalue, which is
+  // usually the largest one
+  double residual =
+    std::abs(beta(steps - 1) * tridiagonal_solver.eigenvectors()(steps - 1,
+                                                                 steps - 1));
+  // Rounding errors of order N eps ||G|| can make the factorization of a
+  // matrix with a smaller negative eigenvalue succeed, so the shift starts
+  // above them
+  double eps = std::numeric_limits<double>::epsilon();
+  double gamma = (N + 2) * eps / (1 - (N + 2) * eps);
+  double norm = G.cwiseAbs().colwise().sum().maxCoeff();
+  double margin = std::max(residual, gamma * norm);
+
+  Eigen::MatrixXd S(N, N);
+  for (int attempt = 0; attempt < 60; attempt++) {
+    double shift = theta + margin;
+    S = -G;
+    S.diagonal().array() += shift;
+    Eigen::LLT<Eigen::MatrixXd> llt(S);
+    if (llt.info() == Eigen::Success) {
+      // The computed factor satisfies LL' = S + E with ||E|| <=
+      // gamma_{N+1} ||L||_F^2, and forming S rounded its diagonal by at
+      // most eps |S_ii|
+      double L_norm2 = llt.matrixL().toDenseMatrix().squaredNorm();
+      return shift + gamma * L_norm2 +
+        eps * S.diagonal().cwiseAbs().maxCoeff();
+    }
+    margin *= 4.0;
+  }
+
+  // Not reached for finite G, but fall back on a dense eigendecomposition,
+  // whose error is of order eps ||G|| and well within this margin
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd>
+    solver(G, Eigen::EigenvaluesOnly);
+  return solver.eigenvalues()(N - 1) + N * gamma * norm;
+}
@@ -10,4 +10,16 @@
 // the '#' character.
 Eigen::MatrixXd read_csv(std::string filename);
 
+// Number of Lanczos steps used to estimate the largest eigenvalue.
+const int LANCZOS_STEPS = 40;
+
+// Returns an upper bound on the largest eigenvalue of the symmetric matrix G.
+// The eigenvalue is estimated by Lanczos iteration, and the bound is verified
+// by a dense Cholesky factorization of sI - G, increasing the shift s until
+// the factorization succeeds. Each attempt costs O(N^3), and the first one
+// usually succeeds. The returned bound adds to s the backward error of the
+// factorization, gamma_{N+1} ||L||_F^2 (Higham, Theorem 10.3), so it holds
+// in floating point however inaccurate the estimate is.
+double max_eigenvalue_upper_bound(const Eigen::MatrixXd& G);
+
 #endif  // __EIGEN_UTIL_H__
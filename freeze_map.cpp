@@ -1,39 +1,134 @@
-#include <map>
+#include <algorithm>
+#include <cassert>
 #include <string>
 #include <utility>
+#include <vector>
 #include <Eigen/Dense>
 #include "freeze_map.h"
 
 
+FreezeMap::FreezeMap(int N) {
+  this->N = N;
+  data.resize(2 * N);
+  for (int i = 0; i < N; i++) {
+    data[i] = 2 * i;
+    data[N + i] = i;
+  }
+}
+
+int FreezeMap::find(int i, int* sign) const {
+  int t = 0;
+  while (data[i] >> 1 != i) {
+    t ^= data[i] & 1;
+    i = data[i] >> 1;
+  }
+  *sign = t ? -1 : 1;
+  return i;
+}
+
+void FreezeMap::resolve(int* rep, int* sign) const {
+  std::fill(rep, rep + N, -1);
+
+  // Walk up from each index to a resolved one, then resolve the path back
+  std::vector<int> path;
+  for (int v = 0; v < N; v++) {
+    int u = v;
+    while (rep[u] == -1 && data[u] >> 1 != u) {
+      path.push_back(u);
+      u = data[u] >> 1;
+    }
+    if (rep[u] == -1) {
+      rep[u] = u;
+      sign[u] = 1;
+    }
+    while (!path.empty()) {
+      int w = path.back();
+      path.pop_back();
+      int p = data[w] >> 1;
+      rep[w] = rep[p];
+      sign[w] = (data[w] & 1) ? -sign[p] : sign[p];
+    }
+  }
+}
+
+void FreezeMap::get_key_indices(int* key_to_ix) const {
+  std::fill(key_to_ix, key_to_ix + N, -1);
+  for (int ix = 0; ix < get_num_keys(); ix++) {
+    key_to_ix[get_key(ix)] = ix;
+  }
+}
+
+void FreezeMap::freeze(int i, int j, int s) {
+  assert(i >= 0 && i < N && j >= 0 && j < N && i != j);
+  assert(data[j] == 2 * j && (s == 1 || s == -1));
+  std::vector<int>::iterator it =
+    std::lower_bound(data.begin() + N, data.end(), i);
+  assert(it != data.end() && *it == i);
+  data[i] = 2 * j + (s < 0 ? 1 : 0);
+  data.erase(it);
+}
+
+
+void FreezeMap_groups(const FreezeMap* f,
+                      std::vector<int>& start,
+                      std::vector<int>& members,
+                      std::vector<int>& signs) {
+  int N = f->get_num_indices();
+  int M = f->get_num_keys();
+
+  std::vector<int> rep(N);
+  std::vector<int> sign(N);
+  f->resolve(rep.data(), sign.data());
+  std::vector<int> key_to_ix(N);
+  f->get_key_indices(key_to_ix.data());
+
+  start.assign(M + 1, 0);
+  for (int v = 0; v < N; v++) {
+    start[key_to_ix[rep[v]] + 1]++;
+  }
+  for (int ix = 0; ix < M; ix++) {
+    start[ix + 1] += start[ix];
+  }
+
+  // Each key comes first in its group, as the keys are visited first
+  members.resize(N);
+  signs.resize(N);
+  std::vector<int> next(start.begin(), start.end() - 1);
+  for (int ix = 0; ix < M; ix++) {
+    members[next[ix]] = f->get_key(ix);
+    signs[next[ix]] = 1;
+    next[ix]++;
+  }
+  for (int v = 0; v < N; v++) {
+    if (rep[v] != v) {
+      int pos = next[key_to_ix[rep[v]]]++;
+      members[pos] = v;
+      signs[pos] = sign[v];
+    }
+  }
+}
+
+
 std::string FreezeMap_to_string(const FreezeMap* f) {
-  std::string s = "(";
+  std::vector<int> start, members, signs;
+  FreezeMap_groups(f, start, members, signs);
 
-  bool first = true;
-  for (FreezeMap::const_iterator it=f->begin(); it != f->end(); ++it) {
-    int i = it->first;
+  std::string s = "(";
 
-    if (first) {
-      first = false;
-    } else {
+  for (int ix = 0; ix < f->get_num_keys(); ix++) {
+    if (ix > 0) {
       s.append(",");
     }
-    s.append(std::to_string(i));
+    s.append(std::to_string(f->get_key(ix)));
     s.append(",(");
 
-    bool inner_first = true;
-    for (std::map<int, int>::const_iterator jt=it->second.begin();
-         jt != it->second.end();
-         ++jt) {
-      if (inner_first) {
-        inner_first = false;
-      } else {
+    for (int p = start[ix] + 1; p < start[ix + 1]; p++) {
+      if (p > start[ix] + 1) {
         s.append(",");
       }
-      int j = jt->first;
-      int s_ij = jt->second;
-      s.append(std::to_string(j));
+      s.append(std::to_string(members[p]));
       s.append(",");
-      s.append(std::to_string(s_ij));
+      s.append(std::to_string(signs[p]));
     }
     s.append(")");
   }
@@ -45,9 +140,12 @@ std::string FreezeMap_to_string(const FreezeMap* f) {
 
 
 void FreezeMap_serialize(const FreezeMap* f, int* s) {
+  std::vector<int> start, members, signs;
+  FreezeMap_groups(f, start, members, signs);
+
   int s_ix = 0;
-  for (FreezeMap::const_iterator it=f->begin(); it != f->end(); ++it) {
-    int i = it->first;
+  for (int ix = 0; ix < f->get_num_keys(); ix++) {
+    int i = f->get_key(ix);
 
     s[s_ix] = i;
     s_ix++;
@@ -56,17 +154,12 @@ void FreezeMap_serialize(const FreezeMap* f, int* s) {
     s[s_ix] = 0;
     s_ix++;
 
-    for (std::map<int, int>::const_iterator jt=it->second.begin();
-             jt != it->second.end();
-             ++jt) {
-      int j = jt->first;
-      int s_ij = jt->second;
-
-      s[s_ix] = j;
+    for (int p = start[ix] + 1; p < start[ix + 1]; p++) {
+      s[s_ix] = members[p];
       s_ix++;
       s[s_ix] = i;
       s_ix++;
-      s[s_ix] = s_ij;
+      s[s_ix] = signs[p];
       s_ix++;
     }
   }
@@ -74,146 +167,184 @@ void FreezeMap_serialize(const FreezeMap* f, int* s) {
 
 
 void FreezeMap_deserialize(int N, const int* s, FreezeMap* f) {
-  f->clear();
+  f->N = N;
+  f->data.resize(N);
 
+  // The keys come in increasing order
   for (int i = 0; i < N; i++) {
     int s1 = s[i * 3];
     int s2 = s[i * 3 + 1];
     int s3 = s[i * 3 + 2];
 
     if (s3 == 0) {
-      f->insert(std::make_pair(s1, std::map<int, int>()));
+      f->data[s1] = 2 * s1;
+      f->data.push_back(s1);
     } else {
-      (*f)[s2][s1] = s3;
+      f->data[s1] = 2 * s2 + (s3 < 0 ? 1 : 0);
     }
   }
 }
 
 
 int FreezeMap_num_frozen(const FreezeMap* f) {
-  int ret = 0;
-  for (FreezeMap::const_iterator it=f->begin(); it != f->end(); ++it) {
-    ret += it->second.size();
-  }
-  return ret;
+  return f->get_num_indices() - f->get_num_keys();
 }
 
 
 Eigen::MatrixXd FreezeMap_transform_matrix(const Eigen::MatrixXd& A,
                                            const FreezeMap* f) {
   int N = A.rows();
-  int M = N - FreezeMap_num_frozen(f);
+  int M = f->get_num_keys();
+
+  // B = S'AS for the N x M matrix S with S(v, ix) = s whenever v is in the
+  // group of the key at ix with sign s, stored by columns as the groups
+  std::vector<int> start, members, signs;
+  FreezeMap_groups(f, start, members, signs);
+
+  Eigen::MatrixXd AS(N, M);
+#pragma omp parallel for schedule(static) if (M >= FREEZE_MAP_PARALLEL_MIN)
+  for (int ix = 0; ix < M; ix++) {
+    AS.col(ix) = A.col(members[start[ix]]);
+    for (int p = start[ix] + 1; p < start[ix + 1]; p++) {
+      AS.col(ix) += signs[p] * A.col(members[p]);
+    }
+  }
 
   Eigen::MatrixXd ret(M, M);
+#pragma omp parallel for schedule(static) if (M >= FREEZE_MAP_PARALLEL_MIN)
+  for (int ix = 0; ix < M; ix++) {
+    ret.row(ix) = AS.row(members[start[ix]]);
+    for (int p = start[ix] + 1; p < start[ix + 1]; p++) {
+      ret.row(ix) += signs[p] * AS.row(members[p]);
+    }
+  }
 
-  int row_ix = 0;
-  int col_ix = 0;
-  for (FreezeMap::const_iterator it=f->begin(); it != f->end(); ++it) {
-    int i = it->first;
-
-    col_ix = 0;
-    for (FreezeMap::const_iterator kt=f->begin(); kt != f->end(); ++kt) {
-      int k = kt->first;
-
-      ret(row_ix, col_ix) = A(i, k);
-
-      for (std::map<int, int>::const_iterator jt=it->second.begin();
-           jt != it->second.end();
-           ++jt) {
-        int j = jt->first;
-        int s_ij = jt->second;
-
-        for (std::map<int, int>::const_iterator jt2=kt->second.begin();
-             jt2 != kt->second.end();
-             ++jt2) {
-          int j2 = jt2->first;
-          int s_ij2 = jt2->second;
+  return ret;
+}
 
-          ret(row_ix, col_ix) += s_ij * s_ij2 * A(j, j2);
-        }
-      }
+Eigen::MatrixXd FreezeMap_fold_matrix(const Eigen::MatrixXd& B,
+                                      int ix_i,
+                                      int ix_j,
+                                      int s) {
+  int m = B.rows() - 1;
+  int tail = m - ix_i;
+
+  // Drop row and column ix_i
+  Eigen::MatrixXd ret(m, m);
+  ret.topLeftCorner(ix_i, ix_i) = B.topLeftCorner(ix_i, ix_i);
+  ret.topRightCorner(ix_i, tail) = B.topRightCorner(ix_i, tail);
+  ret.bottomLeftCorner(tail, ix_i) = B.bottomLeftCorner(tail, ix_i);
+  ret.bottomRightCorner(tail, tail) = B.bottomRightCorner(tail, tail);
+
+  // and add s times them to row and column ix_j, which gets
+  // B(j, j) + 2s B(i, j) + B(i, i) on the diagonal
+  int jx = ix_j > ix_i ? ix_j - 1 : ix_j;
+  for (int k = 0; k < m; k++) {
+    int kx = k < ix_i ? k : k + 1;
+    ret(jx, k) += s * B(ix_i, kx);
+    ret(k, jx) += s * B(kx, ix_i);
+  }
+  ret(jx, jx) += B(ix_i, ix_i);
 
-      for (std::map<int, int>::const_iterator jt=it->second.begin();
-           jt != it->second.end();
-           ++jt) {
-        int j = jt->first;
-        int s_ij = jt->second;
+  return ret;
+}
 
-        ret(row_ix, col_ix) += s_ij * A(k, j);
-      }
-      for (std::map<int, int>::const_iterator jt=kt->second.begin();
-           jt != kt->second.end();
-           ++jt) {
-        int j = jt->first;
-        int s_kj = jt->second;
+bool FreezeMap_find_branch(const FreezeMap* parent,
+                           const FreezeMap* child,
+                           int* i,
+                           int* j,
+                           int* s) {
+  int N = parent->get_num_indices();
+  if (child->get_num_indices() != N ||
+      child->get_num_keys() != parent->get_num_keys() - 1) {
+    return false;
+  }
 
-        ret(row_ix, col_ix) += s_kj * A(i, j);
+  // The key of the parent missing from the child
+  int ix = 0;
+  while (ix < child->get_num_keys() &&
+         parent->get_key(ix) == child->get_key(ix)) {
+    ix++;
+  }
+  *i = parent->get_key(ix);
+  *j = child->find(*i, s);
+
+  std::vector<int> parent_rep(N), parent_sign(N);
+  std::vector<int> child_rep(N), child_sign(N);
+  parent->resolve(parent_rep.data(), parent_sign.data());
+  child->resolve(child_rep.data(), child_sign.data());
+  if (parent_rep[*j] != *j) {
+    return false;
+  }
+  for (int v = 0; v < N; v++) {
+    if (parent_rep[v] == *i) {
+      if (child_rep[v] != *j || child_sign[v] != *s * parent_sign[v]) {
+        return false;
       }
-
-      col_ix++;
+    } else if (child_rep[v] != parent_rep[v] ||
+               child_sign[v] != parent_sign[v]) {
+      return false;
     }
-    row_ix++;
   }
-
-  return ret;
+  return true;
 }
 
 Eigen::VectorXd FreezeMap_expand_vector(const Eigen::VectorXd& y,
                                         const FreezeMap* f) {
-  int N = FreezeMap_num_frozen(f) + f->size();
+  int N = f->get_num_indices();
+
+  std::vector<int> rep(N);
+  std::vector<int> sign(N);
+  f->resolve(rep.data(), sign.data());
+  std::vector<int> key_to_ix(N);
+  f->get_key_indices(key_to_ix.data());
 
   Eigen::VectorXd ret(N);
+  for (int v = 0; v < N; v++) {
+    ret(v) = sign[v] * y(key_to_ix[rep[v]]);
+  }
 
-  int ix = 0;
-  for (FreezeMap::const_iterator it=f->begin(); it != f->end(); ++it) {
-    int i = it->first;
+  return ret;
+}
 
-    ret(i) = y(ix);
+Eigen::MatrixXd FreezeMap_expand_rows(const Eigen::MatrixXd& V,
+                                      const FreezeMap* f) {
+  int N = f->get_num_indices();
 
-    for (std::map<int, int>::const_iterator jt=it->second.begin();
-         jt != it->second.end();
-         ++jt) {
-      int j = jt->first;
-      int s_ij = jt->second;
+  std::vector<int> rep(N);
+  std::vector<int> sign(N);
+  f->resolve(rep.data(), sign.data());
+  std::vector<int> key_to_ix(N);
+  f->get_key_indices(key_to_ix.data());
 
-      ret(j) = s_ij * y(ix);
-    }
+  Eigen::MatrixXd ret(N, V.cols());
+  for (int v = 0; v < N; v++) {
+    ret.row(v) = sign[v] * V.row(key_to_ix[rep[v]]);
+  }
 
-    ix++;
+  return ret;
+}
+
+Eigen::MatrixXd FreezeMap_restrict_rows(const Eigen::MatrixXd& V,
+                                        const FreezeMap* f) {
+  Eigen::MatrixXd ret(f->get_num_keys(), V.cols());
+
+  for (int ix = 0; ix < f->get_num_keys(); ix++) {
+    ret.row(ix) = V.row(f->get_key(ix));
   }
 
   return ret;
 }
 
 void FreezeMap_print(const FreezeMap* f) {
-  for (FreezeMap::const_iterator it=f->begin(); it != f->end(); ++it) {
-    printf("%d : ", it->first);
-    for (std::map<int, int>::const_iterator jt=it->second.begin();
-	 jt != it->second.end();
-	 ++jt) {
-      printf("(%d, %d) ", jt->first, jt->second);
+  std::vector<int> start, members, signs;
+  FreezeMap_groups(f, start, members, signs);
+
+  for (int ix = 0; ix < f->get_num_keys(); ix++) {
+    printf("%d : ", f->get_key(ix));
+    for (int p = start[ix] + 1; p < start[ix + 1]; p++) {
+      printf("(%d, %d) ", members[p], signs[p]);
     }
     printf("\n");
   }
 }
-
-std::pair<FreezeMap, FreezeMap> FreezeMap_branch(const FreezeMap* f,
-                                                 int i,
-                                                 int j) {
-  FreezeMap freezes_pos = *f;
-  freezes_pos[j].insert(freezes_pos[i].begin(), freezes_pos[i].end());
-  freezes_pos[j].insert(std::make_pair(i, +1));
-  freezes_pos.erase(i);
-
-  FreezeMap freezes_neg = *f;
-  std::for_each(freezes_neg[i].begin(),
-                freezes_neg[i].end(),
-                [](std::pair<const int, int>& p) {
-                  p.second = -p.second;
-                });
-  freezes_neg[j].insert(freezes_neg[i].begin(), freezes_neg[i].end());
-  freezes_neg[j].insert(std::make_pair(i, -1));
-  freezes_neg.erase(i);
-
-  return std::make_pair(freezes_pos, freezes_neg);
-}
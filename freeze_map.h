@@ -1,13 +1,14 @@
 #ifndef __FREEZE_MAP_H__
 #define __FREEZE_MAP_H__
 
-#include <map>
+#include <string>
 #include <utility>
+#include <vector>
+#include <Eigen/Dense>
 
 // A FreezeMap tracks which indices have been identified together and with
-// which sign flips. It consists of a map from indices ("representatives") to
-// a set of pairs of indices and signs. All indices appearing are distinct.
-// For example, the FreezeMap
+// which sign flips. Each index is either a "representative" or frozen to
+// exactly one representative with a sign. For example, the FreezeMap
 //
 //   {1: [(2, +), (4, -)],
 //    5: [(3, -), (8, -)],
@@ -20,12 +21,62 @@
 //   x5 = -x3 = -x8
 //   x7 = x9
 //
-// Note that we adopt the convention of including an empty list of "partners"
-// for indices that have not been identified with any others. This helps with
-// serialization/deserialization in a fixed-width format. Also, it ensure that
-// the "active" indices are exactly the keys of the FreezeMap.
+// and the "active" indices, or keys, are the representatives 1, 5, 6, 7.
+//
+// The identifications are stored as a signed union-find forest in one flat
+// array, so that copying a FreezeMap is a single copy of N + M integers for
+// M keys. Freezing a key links it in O(1) but removes it from the sorted
+// keys in O(M), and as the forest is not compressed, find walks up to one
+// link per freeze made since the index was frozen; resolve visits each link
+// once.
+class FreezeMap
+{
+ private:
+  int N;
+  // data[v] for v < N is 2 * p + t, where x_v = (-1)^t x_p and p == v for the
+  // keys, and data[N..] are the keys in increasing order
+  std::vector<int> data;
+
+  friend void FreezeMap_deserialize(int N, const int* s, FreezeMap* f);
+
+ public:
+  FreezeMap() : N(0) {}
+
+  // The FreezeMap on N indices with nothing frozen.
+  explicit FreezeMap(int N);
+
+  int get_num_indices() const { return N; }
+  int get_num_keys() const { return data.size() - N; }
+  int get_key(int ix) const { return data[N + ix]; }
+  const int* get_keys() const { return data.data() + N; }
+
+  // Returns the representative of i and writes the sign s with x_i = s x_rep.
+  int find(int i, int* sign) const;
+
+  // Writes the representative and sign of every index, in time O(N).
+  void resolve(int* rep, int* sign) const;
 
-typedef std::map<int, std::map<int, int>> FreezeMap;
+  // Writes the position among the keys of every key, and -1 for the frozen
+  // indices.
+  void get_key_indices(int* key_to_ix) const;
+
+  // Freezes the key i to the key j by x_i = s x_j, together with the indices
+  // already frozen to i, in time O(M). i and j must be distinct keys and s
+  // must be +1 or -1.
+  void freeze(int i, int j, int s);
+};
+
+// Transformed matrices of at least this size are computed across OpenMP
+// threads.
+const int FREEZE_MAP_PARALLEL_MIN = 64;
+
+// Writes the group of the key at position ix, the key followed by the indices
+// frozen to it in increasing order, to members[start[ix]..start[ix + 1]),
+// with the sign of each relative to the key.
+void FreezeMap_groups(const FreezeMap* f,
+                      std::vector<int>& start,
+                      std::vector<int>& members,
+                      std::vector<int>& signs);
 
 // Returns a string serialization of a FreezeMap. The serialization is
 // guaranteed to not contain spaces and to parse to a valid Python tuple-of-
@@ -35,7 +86,9 @@ std::string FreezeMap_to_string(const FreezeMap* f);
 // Prints a human-readable string version of a FreezeMap (for debugging).
 void FreezeMap_print(const FreezeMap* f);
 
-// Serializes f to an array of 3N integers.
+// Serializes f to an array of 3N integers: (i, i, 0) for each key i, followed
+// by (j, i, s) for each index j frozen to it by x_j = s x_i, in increasing
+// order of i and then j.
 void FreezeMap_serialize(const FreezeMap* f, int* s);
 
 // Deserializes f from an array of 3N integers.
@@ -49,15 +102,36 @@ int FreezeMap_num_frozen(const FreezeMap* f);
 Eigen::MatrixXd FreezeMap_transform_matrix(const Eigen::MatrixXd& A,
                                            const FreezeMap* f);
 
+// Returns the transformed matrix of the FreezeMap obtained from f by freezing
+// the key at position ix_i to the key at position ix_j with sign s, given the
+// transformed matrix B of f, in time O(M) besides copying.
+Eigen::MatrixXd FreezeMap_fold_matrix(const Eigen::MatrixXd& B,
+                                      int ix_i,
+                                      int ix_j,
+                                      int s);
+
+// Returns whether child is parent with a key i frozen to a key j by
+// x_i = s x_j, and if so writes i, j and s.
+bool FreezeMap_find_branch(const FreezeMap* parent,
+                           const FreezeMap* child,
+                           int* i,
+                           int* j,
+                           int* s);
+
 // Returns z such that, if [i_1, ..., i_m] are the (sorted) keys of f, then
-// z[i_k] = y[k] and z_[j] = s * y[k] whenever (j, s) is in f[i_k].
+// z[i_k] = y[k] and z_[j] = s * y[k] whenever x_j = s x_{i_k}.
 Eigen::VectorXd FreezeMap_expand_vector(const Eigen::VectorXd& y,
                                         const FreezeMap* f);
 
-// Returns two FreezeMaps corresponding to branching on x_i = x_j and
-// x_i = -x_j.
-std::pair<FreezeMap, FreezeMap> FreezeMap_branch(const FreezeMap* f,
-                                                 int i,
-                                                 int j);
+// Returns the matrix whose rows are the rows of V expanded as in
+// FreezeMap_expand_vector, i.e. row i_k is V.row(k) and row j is
+// s * V.row(k) whenever x_j = s x_{i_k}.
+Eigen::MatrixXd FreezeMap_expand_rows(const Eigen::MatrixXd& V,
+                                      const FreezeMap* f);
+
+// Returns the rows of V indexed by the (sorted) keys of f. This inverts
+// FreezeMap_expand_rows.
+Eigen::MatrixXd FreezeMap_restrict_rows(const Eigen::MatrixXd& V,
+                                        const FreezeMap* f);
 
 #endif  // __FREEZE_MAP_H__
@@ -0,0 +1,67 @@
+#include <limits>
+#include <mpi.h>
+#include "incumbent.h"
+
+Incumbent::Incumbent() {
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+  MPI_Win_allocate(sizeof(Entry),
+                   sizeof(Entry),
+                   MPI_INFO_NULL,
+                   MPI_COMM_WORLD,
+                   &entry,
+                   &window);
+  MPI_Win_lock_all(0, window);
+  entry->value = -std::numeric_limits<double>::infinity();
+  entry->rank = -1;
+  MPI_Win_sync(window);
+  // No process may update a copy before it is initialized
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+Incumbent::~Incumbent() {
+  MPI_Win_unlock_all(window);
+  MPI_Win_free(&window);
+}
+
+Incumbent::Entry Incumbent::read() {
+  Entry current;
+  MPI_Get_accumulate(NULL,
+                     0,
+                     MPI_DOUBLE_INT,
+                     &current,
+                     1,
+                     MPI_DOUBLE_INT,
+                     rank,
+                     0,
+                     1,
+                     MPI_DOUBLE_INT,
+                     MPI_NO_OP,
+                     window);
+  MPI_Win_flush_local(rank, window);
+  return current;
+}
+
+void Incumbent::publish(double value) {
+  // Only a filter: MPI_MAXLOC keeps the best value whatever this read saw
+  if (value <= get()) {
+    return;
+  }
+
+  Entry update;
+  update.value = value;
+  update.rank = rank;
+  for (int i = 0; i < p; i++) {
+    MPI_Accumulate(&update,
+                   1,
+                   MPI_DOUBLE_INT,
+                   i,
+                   0,
+                   1,
+                   MPI_DOUBLE_INT,
+                   MPI_MAXLOC,
+                   window);
+  }
+  MPI_Win_flush_all(window);
+}
@@ -0,0 +1,53 @@
+// Implements the incumbent of a run, the best lower bound found so far, as
+// an MPI window that every process can read and improve without waiting for
+// a message. Each process holds a copy of the value and of the rank that
+// holds a witness of it. A process that improves the incumbent updates every
+// copy with an atomic MPI_MAXLOC accumulate, so that reading it, which
+// happens several times per node, is a local operation, while improvements
+// are rare.
+
+#ifndef __INCUMBENT_H__
+#define __INCUMBENT_H__
+
+#include <mpi.h>
+
+class Incumbent
+{
+ private:
+  // Layout of MPI_DOUBLE_INT
+  struct Entry {
+    double value;
+    int rank;
+  };
+
+  MPI_Win window;
+  Entry* entry;
+  int rank;
+  int p;
+
+  // Reads this process's copy atomically
+  Entry read();
+
+ public:
+  // Creates the window, with no incumbent. Collective over MPI_COMM_WORLD,
+  // as is the destructor.
+  Incumbent();
+  ~Incumbent();
+  Incumbent(const Incumbent&) = delete;
+  Incumbent& operator=(const Incumbent&) = delete;
+
+  // Returns the incumbent, or -infinity if there is none yet.
+  double get() { return read().value; }
+
+  // Returns the rank of the process holding a witness of the incumbent, or
+  // -1 if there is none yet. Of several processes that published the same
+  // value, any one may hold it, but all processes agree on which.
+  int get_holder() { return read().rank; }
+
+  // Makes value the incumbent for all processes if it is better, with this
+  // process as its holder. Whether it was is not reported, since another
+  // process may improve the incumbent at any time.
+  void publish(double value);
+};
+
+#endif  // __INCUMBENT_H__
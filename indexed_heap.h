@@ -0,0 +1,96 @@
+// A binary max-heap of integer ids under a comparator, which also tracks the
+// position of each id so that any id can be removed in time O(log n). Ids
+// should be small non-negative integers, such as indices into an array of
+// the items being ordered.
+
+#ifndef __INDEXED_HEAP_H__
+#define __INDEXED_HEAP_H__
+
+#include <utility>
+#include <vector>
+
+template <typename Less>
+class IndexedHeap
+{
+ private:
+  Less less;
+  std::vector<int> heap;
+  // Position of each id in heap, or -1 if absent
+  std::vector<int> position;
+
+  void swap_at(int a, int b) {
+    std::swap(heap[a], heap[b]);
+    position[heap[a]] = a;
+    position[heap[b]] = b;
+  }
+
+  void sift_up(int k) {
+    while (k > 0) {
+      int parent = (k - 1) / 2;
+      if (!less(heap[parent], heap[k])) {
+        break;
+      }
+      swap_at(parent, k);
+      k = parent;
+    }
+  }
+
+  void sift_down(int k) {
+    int n = heap.size();
+    while (true) {
+      int largest = k;
+      int left = 2 * k + 1;
+      if (left < n && less(heap[largest], heap[left])) {
+        largest = left;
+      }
+      if (left + 1 < n && less(heap[largest], heap[left + 1])) {
+        largest = left + 1;
+      }
+      if (largest == k) {
+        break;
+      }
+      swap_at(k, largest);
+      k = largest;
+    }
+  }
+
+ public:
+  explicit IndexedHeap(Less less) : less(less) {}
+
+  bool empty() const { return heap.empty(); }
+  int size() const { return heap.size(); }
+
+  // Returns the largest id under the comparator.
+  int top() const { return heap[0]; }
+
+  void push(int id) {
+    if (id >= (int) position.size()) {
+      position.resize(id + 1, -1);
+    }
+    position[id] = heap.size();
+    heap.push_back(id);
+    sift_up(heap.size() - 1);
+  }
+
+  void remove(int id) {
+    int k = position[id];
+    int last = heap.size() - 1;
+    if (k != last) {
+      swap_at(k, last);
+    }
+    heap.pop_back();
+    position[id] = -1;
+    if (k < (int) heap.size()) {
+      int moved = heap[k];
+      sift_up(k);
+      sift_down(position[moved]);
+    }
+  }
+
+  void clear() {
+    heap.clear();
+    position.clear();
+  }
+};
+
+#endif  // __INDEXED_HEAP_H__
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <cstdio>
 #include <cstdlib>
@@ -6,9 +7,13 @@
 #include <string>
 #include <unistd.h>
 #include <Eigen/Dense>
+#include "bit_laplacian.h"
 #include "eigen_util.h"
 #include "node.h"
 #include "mcbb_impl.h"
+#include "mcbb_options.h"
+#include "sdp.h"
+#include "separation.h"
 
 
 int main(int argc, char* argv[]) {
@@ -21,40 +26,209 @@ int main(int argc, char* argv[]) {
   std::string filename;
   Eigen::MatrixXd A;
   int getopt_ret;
-  int N, M;
-  int verbosity = 0;
+  McbbOptions options;
   bool is_sync = false;
+  bool is_steal = false;
   bool readable_output = false;
-  while ((getopt_ret = getopt(argc, argv, "f:m:sv")) != -1) {
+  while ((getopt_ret = getopt(argc, argv, "f:m:sdv:rb:wut:l:T:c:k:F:M:N:P:D:E:")) != -1) {
     switch (getopt_ret) {
     case 'f':
       filename = std::string(optarg);
       A = read_csv(optarg);
-      N = A.rows();
+      break;
     case 'm':
-      M = std::atoi(optarg);
+      options.num_ineqs = std::atoi(optarg);
       break;
     case 'v':
-      verbosity = std::atoi(optarg);
+      options.verbosity = std::atoi(optarg);
       break;
     case 's':
       is_sync = true;
       break;
+    case 'd':
+      is_steal = true;
+      break;
     case 'r':
       readable_output = true;
       break;
+    case 'b':
+      if (!parse_sdp_backend(optarg, &options.sdp_backend)) {
+        if (rank == 0) {
+          fprintf(stderr, "Unknown or unavailable SDP backend: %s\n", optarg);
+        }
+        MPI_Finalize();
+        return 1;
+      }
+      break;
+    case 'w':
+      options.warm_start = true;
+      break;
+    case 'u':
+      options.measure_uncached_setup = true;
+      break;
+    case 't':
+      options.sdp_tolerance = std::atof(optarg);
+      break;
+    case 'l':
+      if (std::string(optarg) == "auto") {
+        options.leaf_size = BRUTE_FORCE_LEAF_SIZE_AUTO;
+      } else {
+        options.leaf_size = std::atoi(optarg);
+      }
+      break;
+    case 'T':
+      options.tabu_iterations = std::atoi(optarg);
+      break;
+    case 'c':
+      options.pool_cuts = std::atoi(optarg);
+      break;
+    case 'k':
+      options.cut_rounds = std::atoi(optarg);
+      break;
+    case 'F':
+      if (!parse_cut_families(optarg, &options.cut_families)) {
+        if (rank == 0) {
+          fprintf(stderr, "Unknown cut families: %s\n", optarg);
+        }
+        MPI_Finalize();
+        return 1;
+      }
+      break;
+    case 'M':
+      options.queue_memory_mb = std::atoi(optarg);
+      break;
+    case 'N':
+      if (!parse_node_selection(optarg, &options.node_selection)) {
+        if (rank == 0) {
+          fprintf(stderr, "Unknown node selection policy: %s\n", optarg);
+        }
+        MPI_Finalize();
+        return 1;
+      }
+      break;
+    case 'P':
+      options.prefetch_depth = std::max(1, std::atoi(optarg));
+      break;
+    case 'D':
+      options.dive_nodes = std::max(0, std::atoi(optarg));
+      break;
+    case 'E':
+      options.dive_seconds = std::max(0.0, std::atof(optarg));
+      break;
+    }
+  }
+
+  // Work stealing has no coordinator to keep a cut pool, take dived nodes
+  // back, prefetch for workers or tell the queues whether workers are busy
+  if (is_steal) {
+    std::string unsupported;
+    if (options.pool_cuts > 0) {
+      unsupported += " -c";
+    }
+    if (options.dive_nodes > 0 || options.dive_seconds > 0) {
+      unsupported += " -D/-E";
+    }
+    if (options.prefetch_depth > 1) {
+      unsupported += " -P";
+    }
+    if (options.node_selection == NODE_SELECTION_HYBRID) {
+      unsupported += " -N hybrid";
+    }
+    if (!unsupported.empty()) {
+      if (rank == 0) {
+        fprintf(stderr,
+                "Options not supported with work stealing (-d):%s\n",
+                unsupported.c_str());
+      }
+      MPI_Finalize();
+      return 1;
     }
   }
 
+  // Without a coordinator, every process solves nodes
+  int num_workers = is_steal ? p : p - 1;
   if (rank == 0) {
     if (readable_output) {
       printf("Solving %s\n", filename.c_str());
-      printf("Running with %d workers\n", p - 1);
-      printf("Using %d triangular inequalities\n", M);
+      printf("Running with %d workers\n", num_workers);
+      if (is_steal) {
+        printf("Stealing work between processes without a coordinator\n");
+      }
+      if (is_unweighted_laplacian(A)) {
+        printf("Using bit-packed kernels for an unweighted Laplacian\n");
+      }
+      printf("Using %d inequalities\n", options.num_ineqs);
+      printf("Separating cut families: %s\n",
+             cut_families_name(options.cut_families).c_str());
+      printf("Using %s SDP backend\n",
+             sdp_backend_name(options.sdp_backend).c_str());
+      if (options.warm_start) {
+        printf("Warm-starting SDPs from parent solutions\n");
+      }
+      if (options.sdp_tolerance > 0) {
+        printf("Using SDP tolerance %g below the root\n",
+               options.sdp_tolerance);
+      }
+      if (options.leaf_size == BRUTE_FORCE_LEAF_SIZE_AUTO) {
+        printf("Choosing brute force leaf size adaptively\n");
+      } else {
+        printf("Using brute force on leaves of size %d\n", options.leaf_size);
+      }
+      if (options.tabu_iterations > 0) {
+        printf("Using %d tabu search moves after rounding\n",
+               options.tabu_iterations);
+      }
+      if (options.pool_cuts > 0 && !is_steal) {
+        printf("Attaching %d inequalities from the cut pool to each node\n",
+               options.pool_cuts);
+      }
+      if (options.cut_rounds > 0) {
+        printf("Using up to %d cutting-plane rounds per node\n",
+               options.cut_rounds);
+      }
+      if (options.queue_memory_mb > 0) {
+        printf("Spilling the node queue to disk beyond %d MB\n",
+               options.queue_memory_mb);
+      }
+      printf("Selecting nodes by %s\n",
+             node_selection_name(options.node_selection).c_str());
+      if (options.prefetch_depth > 1 && !is_sync && !is_steal) {
+        printf("Prefetching up to %d nodes per worker\n",
+               options.prefetch_depth);
+      }
+      if (options.dive_nodes > 0 && !is_steal) {
+        printf("Diving up to %d nodes below each node on the workers\n",
+               options.dive_nodes);
+        if (options.dive_seconds > 0) {
+          printf("Ending dives after %g seconds\n", options.dive_seconds);
+        }
+      }
     } else {
       printf("FILENAME=%s\n", filename.c_str());
-      printf("WORKERS=%d\n", p - 1);
-      printf("INEQUALITIES=%d\n", M);
+      printf("WORKERS=%d\n", num_workers);
+      printf("WORK_STEALING=%d\n", is_steal ? 1 : 0);
+      printf("BIT_LAPLACIAN=%d\n", is_unweighted_laplacian(A) ? 1 : 0);
+      printf("INEQUALITIES=%d\n", options.num_ineqs);
+      printf("CUT_FAMILIES=%s\n",
+             cut_families_name(options.cut_families).c_str());
+      printf("SDP_BACKEND=%s\n",
+             sdp_backend_name(options.sdp_backend).c_str());
+      printf("WARM_START=%d\n", options.warm_start ? 1 : 0);
+      printf("SDP_TOLERANCE=%g\n", options.sdp_tolerance);
+      if (options.leaf_size == BRUTE_FORCE_LEAF_SIZE_AUTO) {
+        printf("LEAF_SIZE=auto\n");
+      } else {
+        printf("LEAF_SIZE=%d\n", options.leaf_size);
+      }
+      printf("TABU_ITERATIONS=%d\n", options.tabu_iterations);
+      printf("POOL_CUTS=%d\n", options.pool_cuts);
+      printf("CUT_ROUNDS=%d\n", options.cut_rounds);
+      printf("QUEUE_MEMORY_MB=%d\n", options.queue_memory_mb);
+      printf("NODE_SELECTION=%s\n",
+             node_selection_name(options.node_selection).c_str());
+      printf("PREFETCH_DEPTH=%d\n", options.prefetch_depth);
+      printf("DIVE_NODES=%d\n", options.dive_nodes);
+      printf("DIVE_SECONDS=%g\n", options.dive_seconds);
     }
   }
 
@@ -62,10 +236,12 @@ int main(int argc, char* argv[]) {
   MPI_Barrier(MPI_COMM_WORLD);
   double start_time = MPI_Wtime();
 
-  if (is_sync) {
-    mcbb_sync(&A, M, verbosity);
+  if (is_steal) {
+    mcbb_steal(&A, options);
+  } else if (is_sync) {
+    mcbb_sync(&A, options);
   } else {
-    mcbb_async(&A, M, verbosity);
+    mcbb_async(&A, options);
   }
 
   MPI_Barrier(MPI_COMM_WORLD);
@@ -1,11 +1,25 @@
+#include <algorithm>
+#include <deque>
 #include <iostream>
+#include <limits>
 #include <list>
+#include <random>
 #include <cstdio>
 #include <cstdlib>
+#include <vector>
 #include <Eigen/Dense>
 #include <mpi.h>
+#include "freeze_map.h"
+#include "bit_laplacian.h"
+#include "brute_force.h"
+#include "cut_pool.h"
+#include "incumbent.h"
 #include "node.h"
 #include "node_queue.h"
+#include "node_worker.h"
+#include "reduced_matrix_cache.h"
+#include "sdp.h"
+#include "sdp_low_rank.h"
 #include "message.h"
 #include "mcbb_impl.h"
 #include "mpi_util.h"
@@ -14,16 +28,67 @@
 // - MPI_Init has been called and MPI_Finalize will be called later.
 // - Every process has the same `A` and is calling this function.
 
+// Collects the SDP solver statistics of all processes and prints them, where
+// local are those of the root. Called by the root, matching the
+// reduce_sdp_solver_stats call of every other process.
+static void print_sdp_solver_stats(const McbbOptions& options,
+                                   const SdpSolverStats& local) {
+  SdpSolverStats total;
+  reduce_sdp_solver_stats(local, &total);
+
+  printf("SDP solves: %d\n", total.solves);
+  printf("SDP setup time: %f seconds\n", total.setup_time);
+  printf("SDP solve time: %f seconds\n", total.solve_time);
+  if (options.measure_uncached_setup &&
+      options.sdp_backend == SDP_BACKEND_MOSEK_CACHED) {
+    printf("SDP uncached setup time: %f seconds\n",
+           total.uncached_setup_time);
+  }
+}
+
+// Fetches the witness of the incumbent from the process holding it and
+// prints its value on the root. Must be called by every process once the
+// search is over, where worker is NULL on a process that executed no nodes.
+static void print_witness(const Eigen::MatrixXd* A,
+                          Incumbent* incumbent,
+                          const NodeWorker* worker) {
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  int holder = incumbent->get_holder();
+  if (holder == -1) {
+    return;
+  }
+
+  Eigen::VectorXd witness;
+  gather_witness(A->rows(),
+                 holder,
+                 worker ? worker->get_best_witness() : Eigen::VectorXd(),
+                 &witness);
+  if (rank == 0) {
+    printf("Witness value: %.4f (found by process %d)\n",
+           witness.dot(*A * witness),
+           holder);
+  }
+}
 
-void mcbb_sync(const Eigen::MatrixXd* A, int M, int verbosity) {
+double mcbb_sync(const Eigen::MatrixXd* A, const McbbOptions& options) {
   // --- Setup ---
 
   int N = A->rows();
+  // Inequalities per node, inherited from the parent and from the cut pool
+  int M = options.num_ineqs + options.pool_cuts;
 
-  // Buffer for sending work/termination requests to worker nodes
-  int* node_request_buffer = new int[3*N + 6*M + 1];
-  // Buffer for returning results to parent node
-  double* node_response_buffer = new double[N + 4 + 6*M];
+  // Buffers of the work/termination requests to worker nodes and of their
+  // results
+  std::vector<char> node_request_buffer;
+  std::vector<char> node_response_buffer;
+  // Buffer of the warm starts and solutions, with factors of rank R
+  int R = low_rank_sdp_rank(N, M);
+  std::vector<char> warm_start_buffer;
+
+  long total_sdp_iterations = 0;
+  long total_sdp_warm_starts = 0;
+  int total_pruned = 0;
 
   int rank, p, num_workers;
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -31,79 +96,131 @@ void mcbb_sync(const Eigen::MatrixXd* A, int M, int verbosity) {
   // Reserve process 0 for coordination
   num_workers = p - 1;
 
-  NodeQueue node_queue;
+  NodeQueue node_queue(options.node_selection,
+                       (long) options.queue_memory_mb * 1024 * 1024);
+  // Workers publish the lower bounds they find here, and the root reads it
+  // to prune its queue
+  Incumbent incumbent;
   if (rank == 0) {  // --- Root coordinating process ---
-    Eigen::VectorXd best_lower_bound_witness(N);
     MPI_Status root_status;
+    CutPool cut_pool;
 
     std::shared_ptr<Node> root_node(new Node(A));
-    node_queue.push(root_node);
+    node_queue.push(root_node->get_record());
 
     std::list<std::shared_ptr<Node>> node_batch{};
+    // Nodes returned unexplored by the dives of the current round
+    std::vector<QueuedNode> batch_frontier;
+    std::vector<QueuedNode> frontier;
+    std::vector<int> frontier_buffer;
 
     bool saturation_achieved = false;
     int round_count = 0;
 
     while (!node_queue.empty()) {
+      node_queue.aggregate_lower_bound(incumbent.get());
       node_batch.clear();
       // Send out as many nodes as possible
-      for (int i = 1; i <= p - 1; i++) {
+      for (int i = 1; i <= num_workers; i++) {
         if (!node_queue.empty()) {
-          std::shared_ptr<Node> this_node = node_queue.pop();
+          std::shared_ptr<Node> this_node(new Node(A, node_queue.pop()));
           node_batch.push_back(this_node);
 
-          send_work_request(N, M, i, this_node.get(), node_request_buffer);
+          if (options.pool_cuts > 0) {
+            cut_pool.attach(this_node.get(), options.pool_cuts);
+          }
+          send_work_request(N,
+                            i,
+                            this_node.get(),
+                            node_request_buffer);
+          if (options.warm_start) {
+            send_warm_start(N, R, i, this_node.get(), warm_start_buffer);
+            this_node->set_warm_start(std::shared_ptr<const SdpWarmStart>());
+          }
         } else {
           break;
         }
       }
 
-      if (node_batch.size() == p - 1 && !saturation_achieved) {
+      if ((int) node_batch.size() == num_workers && !saturation_achieved) {
         printf("Round %d : saturation achieved\n", round_count);
         saturation_achieved = true;
       }
 
-      if (node_batch.size() < p - 1 && saturation_achieved) {
+      if ((int) node_batch.size() < num_workers && saturation_achieved) {
         printf("Round %d : saturation lost\n", round_count);
         saturation_achieved = false;
       }
+      node_queue.set_saturated(saturation_achieved);
 
       if (round_count % 10 == 0) {
         node_queue.clean();
-        printf("Round %d : surplus queue size = %d\n",
+        printf("Round %d : surplus queue size = %d, gap = %.4f\n",
                round_count,
-               node_queue.size());
+               node_queue.size(),
+               node_queue.get_gap());
       }
 
       // Wait to hear back from all active workers and process each result.
-      // Aggregate the new best lower bound and corresponding vector, and set
-      // the upper bounds of each node.
+      // Aggregate the new best lower bound, and set the upper bounds of each
+      // node.
       int worker_ix = 1;
       for (std::list<std::shared_ptr<Node>>::const_iterator it =
              node_batch.begin();
            it != node_batch.end();
            ++it) {
         receive_work_response(N,
-                              M,
                               worker_ix,
                               (*it).get(),
                               node_response_buffer,
                               &root_status);
-
-        if (node_queue.aggregate_lower_bound((*it)->get_lower_bound())) {
-          best_lower_bound_witness = (*it)->get_lower_bound_witness();
+        if (options.warm_start) {
+          receive_solution(N,
+                           R,
+                           worker_ix,
+                           (*it).get(),
+                           warm_start_buffer,
+                           &root_status);
+        }
+        if (options.dive_nodes > 0) {
+          int num_created, num_pruned;
+          receive_frontier(worker_ix,
+                           &num_created,
+                           &num_pruned,
+                           &frontier,
+                           frontier_buffer);
+          total_pruned += num_pruned;
+          batch_frontier.insert(batch_frontier.end(),
+                                frontier.begin(),
+                                frontier.end());
+        }
+        total_sdp_iterations += (*it)->get_sdp_iterations();
+        total_sdp_warm_starts += (*it)->get_sdp_warm_starts();
+        if ((*it)->is_pruned()) {
+          total_pruned++;
+        }
+        if (options.pool_cuts > 0) {
+          cut_pool.update((*it).get());
         }
 
+        node_queue.aggregate_lower_bound((*it)->get_lower_bound());
+
         worker_ix++;
       }
 
-      // Update node queue with branches as needed
+      // Update node queue with branches as needed, which the workers made
+      // themselves if they dove
+      for (const QueuedNode& record : batch_frontier) {
+        node_queue.push(record);
+      }
+      batch_frontier.clear();
       for (std::list<std::shared_ptr<Node>>::const_iterator it =
              node_batch.begin();
            it != node_batch.end();
            ++it) {
-        if ((*it)->get_upper_bound() >= node_queue.get_lower_bound()) {
-          std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>> children =
+        if (options.dive_nodes == 0 &&
+            (*it)->can_branch(node_queue.get_lower_bound())) {
+          std::pair<QueuedNode, QueuedNode> children =
             (*it)->branch_on_suggested();
           node_queue.push(children.first);
           node_queue.push(children.second);
@@ -113,39 +230,88 @@ void mcbb_sync(const Eigen::MatrixXd* A, int M, int verbosity) {
     }
     round_count--;
 
-    for (int i = 1; i <= p - 1; i++) {
-      send_finish_request(N, M, i, node_request_buffer);
+    for (int i = 1; i <= num_workers; i++) {
+      send_finish_request(i);
     }
 
     printf("Final value: %.4f\n", node_queue.get_lower_bound());
+    print_witness(A, &incumbent, NULL);
     printf("Finished in %d rounds\n", round_count);
+    printf("SDP iterations: %ld\n", total_sdp_iterations);
+    if (options.warm_start) {
+      printf("Warm-started SDP solves: %ld\n", total_sdp_warm_starts);
+    }
+    printf("Nodes pruned during SDP: %d\n", total_pruned);
+    if (options.pool_cuts > 0) {
+      printf("Cut pool size: %d\n", cut_pool.size());
+    }
+    if (options.queue_memory_mb > 0) {
+      printf("Nodes spilled to disk: %ld (%ld dropped there)\n",
+             node_queue.get_num_spilled(),
+             node_queue.get_num_spilled_pruned());
+    }
+
+    print_sdp_solver_stats(options, SdpSolverStats());
   } else {         // --- Worker process ---
     MPI_Status worker_status;
     Node worker_node(A);
+    NodeWorker worker(A, options, &incumbent);
+    // Nodes left unexplored by a dive
+    std::vector<QueuedNode> frontier;
+    std::vector<int> frontier_buffer;
 
-    while (receive_work_request(N,
-                                M,
-                                &worker_node,
+    while (receive_work_request(&worker_node,
                                 node_request_buffer,
                                 &worker_status) != MESSAGE_FINISH) {
-      worker_node.execute(M);
-      send_work_response(N, M, &worker_node, node_response_buffer);
+      if (options.warm_start) {
+        receive_warm_start(N,
+                           R,
+                           &worker_node,
+                           warm_start_buffer,
+                           &worker_status);
+      }
+      int num_created, num_pruned;
+      if (options.dive_nodes > 0) {
+        worker.dive(&worker_node, &frontier, &num_created, &num_pruned);
+      } else {
+        worker.execute(&worker_node);
+      }
+      send_work_response(N, &worker_node, node_response_buffer);
+      if (options.warm_start) {
+        send_solution(N, R, &worker_node, warm_start_buffer);
+      }
+      if (options.dive_nodes > 0) {
+        send_frontier(num_created, num_pruned, frontier, frontier_buffer);
+      }
     }
+
+    print_witness(A, &incumbent, &worker);
+    SdpSolverStats unused;
+    reduce_sdp_solver_stats(worker.get_stats(), &unused);
   }
 
-  delete[] node_request_buffer;
-  delete[] node_response_buffer;
+  return incumbent.get();
 }
 
-void mcbb_async(const Eigen::MatrixXd* A, int M, int verbosity) {
+double mcbb_async(const Eigen::MatrixXd* A, const McbbOptions& options) {
   // --- Setup ---
 
   int N = A->rows();
-
-  // Buffer for sending work/termination requests to worker nodes
-  int* node_request_buffer = new int[3*N + 6*M + 1];
-  // Buffer for returning results to parent node
-  double* node_response_buffer = new double[N + 4 + 6*M];
+  // Inequalities per node, inherited from the parent and from the cut pool
+  int M = options.num_ineqs + options.pool_cuts;
+  int verbosity = options.verbosity;
+
+  // Buffers of the work/termination requests to worker nodes and of their
+  // results
+  std::vector<char> node_request_buffer;
+  std::vector<char> node_response_buffer;
+  // Buffer of the warm starts and solutions, with factors of rank R
+  int R = low_rank_sdp_rank(N, M);
+  std::vector<char> warm_start_buffer;
+
+  long total_sdp_iterations = 0;
+  long total_sdp_warm_starts = 0;
+  int total_pruned = 0;
 
   int rank, p, num_workers;
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -155,13 +321,17 @@ void mcbb_async(const Eigen::MatrixXd* A, int M, int verbosity) {
 
   int total_nodes = 0;
 
-  NodeQueue node_queue{};
+  NodeQueue node_queue(options.node_selection,
+                       (long) options.queue_memory_mb * 1024 * 1024);
+  // Workers publish the lower bounds they find here, and the root reads it
+  // to prune its queue
+  Incumbent incumbent;
   if (rank == 0) {  // --- Root coordinating process ---
-    Eigen::VectorXd best_lower_bound_witness(N);
     MPI_Status root_status;
+    CutPool cut_pool;
 
     std::shared_ptr<Node> root_node(new Node(A));
-    node_queue.push(root_node);
+    node_queue.push(root_node->get_record());
 
     if (verbosity) {
       std::cout << FreezeMap_to_string(root_node->get_freeze_map());
@@ -170,94 +340,492 @@ void mcbb_async(const Eigen::MatrixXd* A, int M, int verbosity) {
 
     total_nodes++;
 
-    // Tracks which nodes are currently pending on which processes
-    std::map<int, std::shared_ptr<Node>> node_assignments{};
-
-    while (!node_queue.empty() || !node_assignments.empty()) {
+    // Nodes pending on each process, oldest first, and the free prefetch
+    // slots of the workers, those of idle workers first
+    std::vector<std::deque<std::shared_ptr<Node>>> node_assignments(p);
+    std::deque<int> free_slots;
+    for (int d = 0; d < options.prefetch_depth; d++) {
       for (int i = 1; i <= p - 1; i++) {
-        // If process is idle and there is work to do, send it out
-        if ((node_assignments.find(i) == node_assignments.end()) &&
-            !node_queue.empty()) {
-          std::shared_ptr<Node> this_node = node_queue.pop();
+        free_slots.push_back(i);
+      }
+    }
+    int num_pending = 0;
+    int num_idle = num_workers;
+    // Nodes returned unexplored by a dive
+    std::vector<QueuedNode> frontier;
+    std::vector<int> frontier_buffer;
+    if (options.prefetch_depth > 1) {
+      attach_work_request_buffer(N,
+                                 M,
+                                 options.warm_start ? R : 0,
+                                 num_workers * (options.prefetch_depth + 1));
+    }
 
-          send_work_request(N, M, i, this_node.get(), node_request_buffer);
+    while (!node_queue.empty() || num_pending > 0) {
+      // Send out work while there is some and a worker has a free slot
+      node_queue.aggregate_lower_bound(incumbent.get());
+      while (!free_slots.empty() && !node_queue.empty()) {
+        int i = free_slots.front();
+        free_slots.pop_front();
+        std::shared_ptr<Node> this_node(new Node(A, node_queue.pop()));
 
-          if (verbosity) {
-            std::cout << FreezeMap_to_string(this_node->get_freeze_map());
-            printf(" %f\n", MPI_Wtime());
-          }
+        if (options.pool_cuts > 0) {
+          cut_pool.attach(this_node.get(), options.pool_cuts);
+        }
+        send_work_request(N,
+                          i,
+                          this_node.get(),
+                          node_request_buffer);
+        if (options.warm_start) {
+          send_warm_start(N, R, i, this_node.get(), warm_start_buffer);
+          this_node->set_warm_start(std::shared_ptr<const SdpWarmStart>());
+        }
+
+        if (verbosity) {
+          std::cout << FreezeMap_to_string(this_node->get_freeze_map());
+          printf(" %f\n", MPI_Wtime());
+        }
 
-          node_assignments[i] = this_node;
+        if (node_assignments[i].empty()) {
+          num_idle--;
         }
+        node_assignments[i].push_back(this_node);
+        num_pending++;
       }
+      node_queue.set_saturated(num_idle == 0);
 
       receive_work_response(N,
-                            M,
                             node_assignments,
                             node_response_buffer,
                             &root_status);
 
       int response_source = root_status.MPI_SOURCE;
-      std::shared_ptr<Node> response_node = node_assignments[response_source];
+      std::shared_ptr<Node> response_node =
+        node_assignments[response_source].front();
+      if (options.warm_start) {
+        receive_solution(N,
+                         R,
+                         response_source,
+                         response_node.get(),
+                         warm_start_buffer,
+                         &root_status);
+      }
+      if (options.dive_nodes > 0) {
+        int num_created, num_pruned;
+        receive_frontier(response_source,
+                         &num_created,
+                         &num_pruned,
+                         &frontier,
+                         frontier_buffer);
+        total_nodes += num_created;
+        total_pruned += num_pruned;
+      }
+      total_sdp_iterations += response_node->get_sdp_iterations();
+      total_sdp_warm_starts += response_node->get_sdp_warm_starts();
+      if (response_node->is_pruned()) {
+        total_pruned++;
+      }
+      if (options.pool_cuts > 0) {
+        cut_pool.update(response_node.get());
+      }
+
+      if (verbosity >= 2) {
+        std::cout << "SDP_ITERATIONS "
+                  << FreezeMap_to_string(response_node->get_freeze_map())
+                  << " " << response_node->get_sdp_iterations()
+                  << " " << response_node->get_sdp_warm_starts()
+                  << std::endl;
+      }
 
       if (verbosity) {
         std::cout << FreezeMap_to_string(response_node->get_freeze_map());
         printf(" %f\n", MPI_Wtime());
       }
 
-      if (node_queue.aggregate_lower_bound(response_node->get_lower_bound())) {
-        best_lower_bound_witness = response_node->get_lower_bound_witness();
-      }
+      node_queue.aggregate_lower_bound(response_node->get_lower_bound());
 
-      if (response_node->get_upper_bound() > node_queue.get_lower_bound()) {
-        std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>> children =
+      for (const QueuedNode& record : frontier) {
+        node_queue.push(record);
+      }
+      if (options.dive_nodes == 0 &&
+          response_node->can_branch(node_queue.get_lower_bound())) {
+        std::pair<QueuedNode, QueuedNode> children =
           response_node->branch_on_suggested();
         node_queue.push(children.first);
         node_queue.push(children.second);
 
         if (verbosity) {
+          FreezeMap freezes_pos =
+            BranchPath_freeze_map(children.first.path.get(), N);
+          FreezeMap freezes_neg =
+            BranchPath_freeze_map(children.second.path.get(), N);
+
           std::cout << FreezeMap_to_string(response_node->get_freeze_map())
                     << " "
-                    << FreezeMap_to_string(children.first->get_freeze_map())
+                    << FreezeMap_to_string(&freezes_pos)
                     << " "
-                    << FreezeMap_to_string(children.second->get_freeze_map())
+                    << FreezeMap_to_string(&freezes_neg)
                     << std::endl;
-        }
 
-        if (verbosity) {
-          std::cout << FreezeMap_to_string(children.first->get_freeze_map());
+          std::cout << FreezeMap_to_string(&freezes_pos);
           printf(" %f\n", MPI_Wtime());
 
-          std::cout << FreezeMap_to_string(children.second->get_freeze_map());
+          std::cout << FreezeMap_to_string(&freezes_neg);
           printf(" %f\n", MPI_Wtime());
         }
 
         total_nodes += 2;
       }
 
-      node_assignments.erase(response_source);
+      node_assignments[response_source].pop_front();
+      num_pending--;
+      if (node_assignments[response_source].empty()) {
+        num_idle++;
+        free_slots.push_front(response_source);
+      } else {
+        free_slots.push_back(response_source);
+      }
     }
 
     for (int i = 1; i <= p - 1; i++) {
-      send_finish_request(N, M, i, node_request_buffer);
+      send_finish_request(i);
+    }
+    if (options.prefetch_depth > 1) {
+      detach_work_request_buffer();
     }
 
     printf("Nodes processed: %d\n", total_nodes);
     printf("Final value: %.4f\n", node_queue.get_lower_bound());
+    print_witness(A, &incumbent, NULL);
+    printf("SDP iterations: %ld\n", total_sdp_iterations);
+    if (options.warm_start) {
+      printf("Warm-started SDP solves: %ld\n", total_sdp_warm_starts);
+    }
+    printf("Nodes pruned during SDP: %d\n", total_pruned);
+    if (options.pool_cuts > 0) {
+      printf("Cut pool size: %d\n", cut_pool.size());
+    }
+    if (options.queue_memory_mb > 0) {
+      printf("Nodes spilled to disk: %ld (%ld dropped there)\n",
+             node_queue.get_num_spilled(),
+             node_queue.get_num_spilled_pruned());
+    }
+
+    print_sdp_solver_stats(options, SdpSolverStats());
   } else {         // --- Worker process ---
     MPI_Status worker_status;
-    Node worker_node(A);
+    NodeWorker worker(A, options, &incumbent);
+    // Nodes left unexplored by a dive
+    std::vector<QueuedNode> frontier;
+    std::vector<int> frontier_buffer;
+
+    // Nodes received but not yet executed, oldest first
+    std::deque<Node> pending;
+    bool finished = false;
+
+    while (true) {
+      // Take the requests that have arrived, waiting only when no node is
+      // pending
+      while (!finished && (pending.empty() || probe_work_request())) {
+        Node received(A);
+        if (receive_work_request(&received,
+                                 node_request_buffer,
+                                 &worker_status) == MESSAGE_FINISH) {
+          finished = true;
+          break;
+        }
+        if (options.warm_start) {
+          receive_warm_start(N,
+                             R,
+                             &received,
+                             warm_start_buffer,
+                             &worker_status);
+        }
+        pending.push_back(std::move(received));
+      }
+      if (pending.empty()) {
+        break;
+      }
 
-    while (receive_work_request(N,
-                                M,
-                                &worker_node,
-                                node_request_buffer,
-                                &worker_status) != MESSAGE_FINISH) {
-      worker_node.execute(M);
-      send_work_response(N, M, &worker_node, node_response_buffer);
+      Node& worker_node = pending.front();
+      int num_created, num_pruned;
+      if (options.dive_nodes > 0) {
+        worker.dive(&worker_node, &frontier, &num_created, &num_pruned);
+      } else {
+        worker.execute(&worker_node);
+      }
+      send_work_response(N, &worker_node, node_response_buffer);
+      if (options.warm_start) {
+        send_solution(N, R, &worker_node, warm_start_buffer);
+      }
+      if (options.dive_nodes > 0) {
+        send_frontier(num_created, num_pruned, frontier, frontier_buffer);
+      }
+      pending.pop_front();
+    }
+
+    print_witness(A, &incumbent, &worker);
+    SdpSolverStats unused;
+    reduce_sdp_solver_stats(worker.get_stats(), &unused);
+  }
+
+  return incumbent.get();
+}
+
+double mcbb_steal(const Eigen::MatrixXd* A, const McbbOptions& options) {
+  // --- Setup ---
+
+  int verbosity = options.verbosity;
+
+  int rank, p;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+  long total_sdp_iterations = 0;
+  long total_sdp_warm_starts = 0;
+  long total_pruned = 0;
+  long total_nodes = 0;
+  long total_stolen = 0;
+
+  NodeQueue node_queue(options.node_selection,
+                       (long) options.queue_memory_mb * 1024 * 1024);
+  Incumbent incumbent;
+  NodeWorker worker(A, options, &incumbent);
+  std::mt19937 victims(rank);
+  std::vector<int> steal_buffer;
+  std::vector<QueuedNode> stolen;
+
+  if (rank == 0) {
+    Node root_node(A);
+    node_queue.push(root_node.get_record());
+    total_nodes++;
+  }
+
+  // Termination detection: the node messages this process sent minus those
+  // it received, whether it received any since it last passed the token,
+  // and the token while this process holds it. The root holds it first, and
+  // sends it around the ring from rank p - 1 down to 1 and back to itself.
+  long message_count = 0;
+  bool black = false;
+  bool has_token = rank == 0;
+  bool token_round = false;
+  TerminationToken token = {0, false, node_queue.get_lower_bound()};
+
+  // Whether a steal request of this process is unanswered, and whether the
+  // search is over
+  bool stealing = false;
+  bool finished = false;
+
+  // Handles one probed message, which is answered at once if it is a steal
+  // request
+  auto handle_message = [&](const MPI_Status& status) {
+    double bound;
+    switch (status.MPI_TAG) {
+    case STEAL_TAG_REQUEST:
+      receive_steal_request(status.MPI_SOURCE, &bound);
+      node_queue.aggregate_lower_bound(bound);
+      // Give away the best half of the queue, up to a limit
+      stolen.clear();
+      while ((int) stolen.size() <
+             std::min(WORK_STEALING_MAX_NODES, node_queue.size() / 2)) {
+        stolen.push_back(node_queue.steal());
+      }
+      send_stolen_nodes(status.MPI_SOURCE,
+                        node_queue.get_lower_bound(),
+                        stolen,
+                        steal_buffer);
+      if (!stolen.empty()) {
+        message_count++;
+      }
+      break;
+    case STEAL_TAG_NODES:
+      receive_stolen_nodes(&status, &bound, &stolen, steal_buffer);
+      node_queue.aggregate_lower_bound(bound);
+      for (const QueuedNode& node : stolen) {
+        node_queue.push(node);
+      }
+      if (!stolen.empty()) {
+        message_count--;
+        black = true;
+        total_stolen += stolen.size();
+      }
+      stealing = false;
+      break;
+    case STEAL_TAG_TOKEN:
+      receive_termination_token(status.MPI_SOURCE, &token);
+      node_queue.aggregate_lower_bound(token.incumbent);
+      has_token = true;
+      break;
+    case STEAL_TAG_FINISH:
+      receive_steal_finish(status.MPI_SOURCE);
+      finished = true;
+      break;
+    }
+  };
+
+  while (!finished) {
+    // Handle the messages that have arrived, waiting for one only while
+    // this process is out of work and waiting for an answer to a steal
+    while (!finished) {
+      MPI_Status status;
+      int flag;
+      if (stealing && node_queue.empty()) {
+        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+        flag = 1;
+      } else {
+        MPI_Iprobe(MPI_ANY_SOURCE,
+                   MPI_ANY_TAG,
+                   MPI_COMM_WORLD,
+                   &flag,
+                   &status);
+      }
+      if (!flag) {
+        break;
+      }
+      handle_message(status);
+    }
+    if (finished) {
+      break;
+    }
+
+    node_queue.aggregate_lower_bound(incumbent.get());
+    if (!node_queue.empty()) {
+      Node node(A, node_queue.pop());
+      if (verbosity) {
+        std::cout << FreezeMap_to_string(node.get_freeze_map());
+        printf(" %f\n", MPI_Wtime());
+      }
+
+      // Busy processes do not steal, so a better incumbent is published to
+      // all of them rather than waiting for their next steal
+      worker.execute(&node);
+      if (!options.warm_start) {
+        node.set_solution(std::shared_ptr<const SdpWarmStart>());
+      }
+
+      total_sdp_iterations += node.get_sdp_iterations();
+      total_sdp_warm_starts += node.get_sdp_warm_starts();
+      if (node.is_pruned()) {
+        total_pruned++;
+      }
+
+      node_queue.aggregate_lower_bound(node.get_lower_bound());
+      if (node.can_branch(node_queue.get_lower_bound())) {
+        std::pair<QueuedNode, QueuedNode> children =
+          node.branch_on_suggested();
+        node_queue.push(children.first);
+        node_queue.push(children.second);
+        total_nodes += 2;
+      }
+      continue;
     }
+
+    // Out of work: pass the token on, and look for work elsewhere
+    if (has_token) {
+      if (rank == 0) {
+        // The round is over, and nothing happened since it started
+        if (token_round &&
+            !token.black &&
+            !black &&
+            token.count + message_count == 0) {
+          for (int i = 1; i < p; i++) {
+            send_steal_finish(i);
+          }
+          finished = true;
+          break;
+        }
+        token.count = 0;
+        token.black = false;
+        token_round = true;
+      } else {
+        token.count += message_count;
+        token.black = token.black || black;
+      }
+      token.incumbent = std::max(token.incumbent,
+                                 node_queue.get_lower_bound());
+      black = false;
+      if (p > 1) {
+        send_termination_token(rank == 0 ? p - 1 : rank - 1, token);
+        has_token = false;
+      }
+    }
+    if (!stealing && p > 1) {
+      int victim = std::uniform_int_distribution<int>(0, p - 2)(victims);
+      if (victim >= rank) {
+        victim++;
+      }
+      send_steal_request(victim, node_queue.get_lower_bound());
+      stealing = true;
+    }
+  }
+
+  // Answer the steal requests still in flight, until every process has had
+  // its own answered
+  MPI_Request barrier;
+  bool in_barrier = false;
+  while (true) {
+    if (!stealing && !in_barrier) {
+      MPI_Ibarrier(MPI_COMM_WORLD, &barrier);
+      in_barrier = true;
+    }
+    if (in_barrier) {
+      int done;
+      MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+      if (done) {
+        break;
+      }
+    }
+    MPI_Status status;
+    int flag;
+    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+    if (flag) {
+      handle_message(status);
+    }
+  }
+
+  // --- Totals over all processes ---
+
+  double local_lower_bound = node_queue.get_lower_bound();
+  double lower_bound;
+  MPI_Reduce(&local_lower_bound,
+             &lower_bound,
+             1,
+             MPI_DOUBLE,
+             MPI_MAX,
+             0,
+             MPI_COMM_WORLD);
+  long local_totals[7] = {total_nodes,
+                          total_sdp_iterations,
+                          total_sdp_warm_starts,
+                          total_pruned,
+                          total_stolen,
+                          node_queue.get_num_spilled(),
+                          node_queue.get_num_spilled_pruned()};
+  long totals[7];
+  MPI_Reduce(local_totals, totals, 7, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  if (rank == 0) {
+    printf("Nodes processed: %ld\n", totals[0]);
+    printf("Final value: %.4f\n", lower_bound);
+    print_witness(A, &incumbent, &worker);
+    printf("SDP iterations: %ld\n", totals[1]);
+    if (options.warm_start) {
+      printf("Warm-started SDP solves: %ld\n", totals[2]);
+    }
+    printf("Nodes pruned during SDP: %ld\n", totals[3]);
+    printf("Nodes stolen: %ld\n", totals[4]);
+    if (options.queue_memory_mb > 0) {
+      printf("Nodes spilled to disk: %ld (%ld dropped there)\n",
+             totals[5],
+             totals[6]);
+    }
+
+    print_sdp_solver_stats(options, worker.get_stats());
+  } else {
+    print_witness(A, &incumbent, &worker);
+    SdpSolverStats unused;
+    reduce_sdp_solver_stats(worker.get_stats(), &unused);
   }
 
-  delete[] node_request_buffer;
-  delete[] node_response_buffer;
+  return incumbent.get();
 }
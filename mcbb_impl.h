@@ -1,5 +1,25 @@
 #include <Eigen/Dense>
+#include "mcbb_options.h"
 
-void mcbb_sync(const Eigen::MatrixXd* A, int M, int verbosity);
+// Runs the branch and bound in rounds, in which process 0 sends a node to
+// each worker and waits for all of their results. Returns the value of the
+// best cut found, on every process.
+double mcbb_sync(const Eigen::MatrixXd* A, const McbbOptions& options);
 
-void mcbb_async(const Eigen::MatrixXd* A, int M, int verbosity);
+// Runs the branch and bound with process 0 as a coordinator that hands each
+// worker up to options.prefetch_depth nodes at once and refills it as soon
+// as it returns a result. Returns the value of the best cut found, on every
+// process.
+double mcbb_async(const Eigen::MatrixXd* A, const McbbOptions& options);
+
+// Most nodes a process gives away per steal request in mcbb_steal, which
+// gives at most half of its queue
+const int WORK_STEALING_MAX_NODES = 8;
+
+// Runs the branch and bound without a coordinator: every process solves
+// nodes from its own queue and keeps their children, and processes that run
+// out of work steal the best nodes of random others. The incumbent is shared
+// through an Incumbent window and also rides on the steal messages, and the
+// end of the search is detected with a Dijkstra-Safra token passed around
+// the processes. Returns the value of the best cut found, on every process.
+double mcbb_steal(const Eigen::MatrixXd* A, const McbbOptions& options);
@@ -0,0 +1,73 @@
+// Run-wide options of the branch and bound, as set on the command line of
+// mcbb.
+
+#ifndef __MCBB_OPTIONS_H__
+#define __MCBB_OPTIONS_H__
+
+#include "brute_force.h"
+#include "node_queue.h"
+#include "sdp.h"
+#include "separation.h"
+
+struct McbbOptions {
+  // Number of inequalities passed from each node to its children
+  int num_ineqs;
+  // Families of inequalities separated at each node
+  CutFamilies cut_families;
+  int verbosity;
+  SdpBackend sdp_backend;
+  // Whether to warm-start each node's SDP from its parent's solution
+  bool warm_start;
+  // Whether a caching SDP solver also times building each model from
+  // scratch, to report the setup time saved
+  bool measure_uncached_setup;
+  // Tolerance of the SDP solves at all nodes but the root, or 0 for the
+  // backend's default. The bounds are certified, so a loose tolerance trades
+  // bound quality for speed without affecting correctness.
+  double sdp_tolerance;
+  // Number of free variables up to which nodes are solved by brute force, or
+  // BRUTE_FORCE_LEAF_SIZE_AUTO to choose it from measured times
+  int leaf_size;
+  // Number of tabu search moves after rounding at each node, or 0 to stop
+  // at the first local maximum
+  int tabu_iterations;
+  // Number of inequalities from the root's cut pool attached to each node on
+  // top of those inherited from its parent, or 0 to not keep a pool
+  int pool_cuts;
+  // Maximum number of cutting-plane rounds after each node's first SDP
+  // solve, or 0 for none
+  int cut_rounds;
+  // Memory budget of the coordinator's node queue in megabytes, beyond which
+  // nodes are spilled to disk, or 0 for no limit
+  int queue_memory_mb;
+  // Order in which the coordinator dispatches queued nodes
+  NodeSelection node_selection;
+  // Number of nodes each worker holds at once in the asynchronous mode, so
+  // that the next one is ready when it finishes one
+  int prefetch_depth;
+  // Number of descendants each worker explores depth-first below a node it
+  // receives before returning the unexplored ones to the coordinator, or 0
+  // to return the node alone, and the time in seconds after which the dive
+  // stops, or 0 for no limit
+  int dive_nodes;
+  double dive_seconds;
+
+  McbbOptions()
+    : num_ineqs(0),
+      verbosity(0),
+      sdp_backend(default_sdp_backend()),
+      warm_start(false),
+      measure_uncached_setup(false),
+      sdp_tolerance(0),
+      leaf_size(BRUTE_FORCE_DEFAULT_LEAF_SIZE),
+      tabu_iterations(0),
+      pool_cuts(0),
+      cut_rounds(0),
+      queue_memory_mb(0),
+      node_selection(NODE_SELECTION_BEST_BOUND),
+      prefetch_depth(1),
+      dive_nodes(0),
+      dive_seconds(0) {}
+};
+
+#endif  // __MCBB_OPTIONS_H__
@@ -1,9 +1,26 @@
 #ifndef __MESSAGE_H__
 #define __MESSAGE_H__
 
+// Version of the format of the messages between the root and the workers,
+// the first byte of each work request and response
+const unsigned char MESSAGE_PROTOCOL_VERSION = 1;
+
 enum MessageType {
   MESSAGE_WORK,
   MESSAGE_FINISH
 };
 
+// Tags of the messages between processes in the work-stealing mode, where
+// any process may send to any other
+enum StealTag {
+  STEAL_TAG_REQUEST = 1,
+  STEAL_TAG_NODES,
+  STEAL_TAG_TOKEN,
+  STEAL_TAG_FINISH
+};
+
+// Tag of the witness of the incumbent, sent by its holder to the root once
+// the search is over
+const int WITNESS_TAG = STEAL_TAG_FINISH + 1;
+
 #endif  // __MESSAGE_H__
@@ -1,183 +1,699 @@
-#include <list>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <limits>
 #include <memory>
 #include <mpi.h>
+#include <utility>
+#include <vector>
+#include "cut.h"
 #include "node.h"
 #include "freeze_map.h"
 #include "message.h"
-#include "triangle_inequality.h"
+#include "mpi_util.h"
+#include "sdp.h"
 
-void send_work_request(int N,
-                       int M,
-                       int target_rank,
-                       const Node* node,
-                       int* node_request_buffer) {
-  node_request_buffer[3*N + 6*M] = MESSAGE_WORK;
+// Appends the bytes of a value to a message.
+template <typename T>
+static void put(std::vector<char>& buffer, const T& value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
 
-  const FreezeMap* freezes = node->get_freeze_map();
-  FreezeMap_serialize(freezes, node_request_buffer);
+// Appends a non-negative integer in groups of 7 bits, lowest first, with the
+// high bit set on all groups but the last.
+static void put_varint(std::vector<char>& buffer, unsigned int value) {
+  while (value >= 0x80) {
+    buffer.push_back((char) ((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back((char) value);
+}
 
-  int ineq_ix = 0;
-  for (std::shared_ptr<TriangleInequality> ineq : node->get_inequalities()) {
-    ineq->serialize(node_request_buffer + 3*N + 6*ineq_ix);
-    ineq_ix++;
+// Reads back the values of a message in the order they were put.
+struct MessageReader {
+  const char* pos;
+
+  template <typename T>
+  T get() {
+    T value;
+    std::memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
   }
-  for (int i = 3*N + 6*ineq_ix; i < 3*N + 6*M; i++) {
-    node_request_buffer[i] = -1;
+
+  unsigned int get_varint() {
+    unsigned int value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+      byte = *pos++;
+      value |= (unsigned int) (byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    return value;
   }
+};
 
-  MPI_Send(node_request_buffer,
-           3*N + 6*M + 1,
-           MPI_INT,
-           target_rank,
-           0,
-           MPI_COMM_WORLD);
+// Longest varint of an index below 2^31
+static const int MAX_VARINT_SIZE = 5;
+
+// Longest packed cut: its type, number of points and signs as bytes, and
+// its points
+static const int MAX_PACKED_CUT_SIZE = 3 + CUT_MAX_VERTICES * sizeof(int);
+
+// Appends the number of cuts, then each cut as its type, its number of
+// points and the bits of its negative signs (see Cut::get_sign), one byte
+// each, followed by its points.
+static void put_cuts(std::vector<char>& buffer, const CutList& cuts) {
+  put<int>(buffer, cuts.size());
+  for (const Cut& cut : cuts) {
+    unsigned char signs = 0;
+    for (int t = 0; t < cut.get_num_vertices(); t++) {
+      if (cut.get_sign(t) < 0) {
+        signs |= 1 << t;
+      }
+    }
+    put<unsigned char>(buffer, cut.get_type());
+    put<unsigned char>(buffer, cut.get_num_vertices());
+    put<unsigned char>(buffer, signs);
+    for (int t = 0; t < cut.get_num_vertices(); t++) {
+      put<int>(buffer, cut.get_vertex(t));
+    }
+  }
 }
 
-void send_finish_request(int N,
-                         int M,
-                         int target_rank,
-                         int* node_request_buffer) {
-  node_request_buffer[3*N + 6*M] = MESSAGE_FINISH;
-  MPI_Send(node_request_buffer,
-           3*N + 6*M + 1,
-           MPI_INT,
-           target_rank,
-           0,
-           MPI_COMM_WORLD);
+// Inverse of put_cuts, rebuilding each cut from its record.
+static void get_cuts(MessageReader& reader, CutList* cuts) {
+  cuts->resize(reader.get<int>());
+  for (Cut& cut : *cuts) {
+    int record[CUT_RECORD_SIZE];
+    record[0] = reader.get<unsigned char>();
+    record[1] = reader.get<unsigned char>();
+    record[2] = reader.get<unsigned char>();
+    for (int t = 0; t < CUT_MAX_VERTICES; t++) {
+      record[3 + t] = t < record[1] ? reader.get<int>() : -1;
+    }
+    cut = Cut(record);
+  }
 }
 
-void receive_work_response(int N,
-                           int M,
-                           std::map<int, std::shared_ptr<Node>>& node_map,
-                           double* node_response_buffer,
-                           MPI_Status* status) {
-  MPI_Recv(node_response_buffer,
-           N + 4 + 6*M,
-           MPI_DOUBLE,
-           MPI_ANY_SOURCE,
+// Reads the version at the start of a message, and stops the run if it is
+// not the one of this build.
+static void check_protocol_version(MessageReader& reader) {
+  int version = reader.get<unsigned char>();
+  if (version != MESSAGE_PROTOCOL_VERSION) {
+    fprintf(stderr,
+            "Message of protocol version %d, expected %d\n",
+            version,
+            MESSAGE_PROTOCOL_VERSION);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+}
+
+// Waits for a message of tag 0 from source and receives it into buffer,
+// which is resized to its length.
+static void receive_message(int source,
+                            std::vector<char>& buffer,
+                            MPI_Status* status) {
+  MPI_Probe(source, 0, MPI_COMM_WORLD, status);
+  int size;
+  MPI_Get_count(status, MPI_BYTE, &size);
+  buffer.resize(size);
+  MPI_Recv(buffer.data(),
+           size,
+           MPI_BYTE,
+           status->MPI_SOURCE,
            0,
            MPI_COMM_WORLD,
            status);
+}
+
+int work_request_size(int N, int M) {
+  return 2 + MAX_VARINT_SIZE * (1 + 2*N) + sizeof(int) +
+    M * MAX_PACKED_CUT_SIZE;
+}
 
-  std::shared_ptr<Node> node = node_map.find(status->MPI_SOURCE)->second;
+// Largest length in bytes of a warm start message with a factor of rank R
+// and M multipliers.
+static int warm_start_size(int N, int M, int R) {
+  return 2 + 3 * sizeof(int) + (N*R + M) * sizeof(double);
+}
+
+// Buffer of the root's sends, while attached
+static char* work_request_buffer = NULL;
+
+// Sends a message from the root to a worker, through the attached buffer if
+// there is one.
+static void send_from_root(void* buffer,
+                           int count,
+                           MPI_Datatype type,
+                           int target_rank) {
+  if (work_request_buffer != NULL) {
+    MPI_Bsend(buffer, count, type, target_rank, 0, MPI_COMM_WORLD);
+  } else {
+    MPI_Send(buffer, count, type, target_rank, 0, MPI_COMM_WORLD);
+  }
+}
+
+void attach_work_request_buffer(int N, int M, int R, int count) {
+  int request_size, solution_size = 0;
+  MPI_Pack_size(work_request_size(N, M),
+                MPI_BYTE,
+                MPI_COMM_WORLD,
+                &request_size);
+  request_size += MPI_BSEND_OVERHEAD;
+  if (R > 0) {
+    MPI_Pack_size(warm_start_size(N, M, R),
+                  MPI_BYTE,
+                  MPI_COMM_WORLD,
+                  &solution_size);
+    solution_size += MPI_BSEND_OVERHEAD;
+  }
+
+  int size = count * (request_size + solution_size);
+  work_request_buffer = new char[size];
+  MPI_Buffer_attach(work_request_buffer, size);
+}
+
+void detach_work_request_buffer() {
+  char* buffer;
+  int size;
+  // Waits for the buffered messages to be delivered
+  MPI_Buffer_detach(&buffer, &size);
+  delete[] work_request_buffer;
+  work_request_buffer = NULL;
+}
 
-  node->set_lower_bound(node_response_buffer[N]);
-  node->set_upper_bound(node_response_buffer[N + 1]);
-  node->set_branch_i(node_response_buffer[N + 2]);
-  node->set_branch_j(node_response_buffer[N + 3]);
+void pack_work_request(int N, const Node* node, std::vector<char>& buffer) {
+  buffer.clear();
+  put<unsigned char>(buffer, MESSAGE_PROTOCOL_VERSION);
+  put<unsigned char>(buffer, MESSAGE_WORK);
+
+  // Each frozen index, as the gap from the previous one, and its
+  // representative with the sign in the lowest bit
+  std::vector<int> rep(N);
+  std::vector<int> sign(N);
+  node->get_freeze_map()->resolve(rep.data(), sign.data());
+  put_varint(buffer, FreezeMap_num_frozen(node->get_freeze_map()));
+  int previous = 0;
+  for (int v = 0; v < N; v++) {
+    if (rep[v] != v) {
+      put_varint(buffer, v - previous);
+      put_varint(buffer, 2 * rep[v] + (sign[v] < 0 ? 1 : 0));
+      previous = v;
+    }
+  }
+
+  put_cuts(buffer, node->get_inequalities());
+}
+
+void send_work_request(int N,
+                       int target_rank,
+                       const Node* node,
+                       std::vector<char>& buffer) {
+  pack_work_request(N, node, buffer);
+  send_from_root(buffer.data(), buffer.size(), MPI_BYTE, target_rank);
+}
+
+void send_finish_request(int target_rank) {
+  unsigned char message[2] = {MESSAGE_PROTOCOL_VERSION, MESSAGE_FINISH};
+  send_from_root(message, 2, MPI_BYTE, target_rank);
+}
+
+void unpack_work_response(int N,
+                          Node* node,
+                          const std::vector<char>& buffer) {
+  MessageReader reader{buffer.data()};
+  check_protocol_version(reader);
+
+  node->set_lower_bound(reader.get<double>());
+  node->set_upper_bound(reader.get<double>());
+  node->set_branch_i(reader.get<int>());
+  node->set_branch_j(reader.get<int>());
+  node->set_sdp_iterations(reader.get<int>());
+  node->set_sdp_warm_starts(reader.get<int>());
+  node->set_pruned(reader.get<unsigned char>() != 0);
 
   Eigen::VectorXd lower_bound_witness(N);
-  lower_bound_witness =
-    Eigen::Map<Eigen::VectorXd>(node_response_buffer, N);
+  for (int i = 0; i < N; i += 8) {
+    unsigned char bits = reader.get<unsigned char>();
+    for (int k = 0; k < 8 && i + k < N; k++) {
+      lower_bound_witness(i + k) = (bits >> k) & 1 ? -1 : 1;
+    }
+  }
   node->set_lower_bound_witness(lower_bound_witness);
 
-  std::list<std::shared_ptr<TriangleInequality>> post_inequalities{};
-  for (int i = N + 4; i < N + 4 + 6*M; i += 6) {
-    if (node_response_buffer[i] != -1) {
-      post_inequalities.push_back(std::shared_ptr<TriangleInequality>(new TriangleInequality(node_response_buffer + i)));
-    }
+  CutList post_inequalities;
+  get_cuts(reader, &post_inequalities);
+  int num_post = post_inequalities.size();
+  node->set_post_inequalities(std::move(post_inequalities));
+
+  Eigen::VectorXd post_values(num_post);
+  for (int i = 0; i < num_post; i++) {
+    post_values(i) = reader.get<double>();
+  }
+  node->set_post_inequality_values(post_values);
+
+  Eigen::VectorXd slacks(reader.get<int>());
+  for (int i = 0; i < slacks.size(); i++) {
+    slacks(i) = reader.get<double>();
   }
+  node->set_inequality_slacks(slacks);
+}
+
+void receive_work_response(
+    int N,
+    std::vector<std::deque<std::shared_ptr<Node>>>& pending,
+    std::vector<char>& buffer,
+    MPI_Status* status) {
+  receive_message(MPI_ANY_SOURCE, buffer, status);
 
-  node->set_post_inequalities(post_inequalities);
+  // A worker answers its requests in the order they were sent
+  std::shared_ptr<Node> node = pending[status->MPI_SOURCE].front();
+  unpack_work_response(N, node.get(), buffer);
 }
 
 void receive_work_response(int N,
-			   int M,
                            int target_rank,
                            Node* node,
-                           double* node_response_buffer,
+                           std::vector<char>& buffer,
                            MPI_Status* status) {
-  MPI_Recv(node_response_buffer,
-           N + 4 + 6*M,
-           MPI_DOUBLE,
-           target_rank,
-           0,
-           MPI_COMM_WORLD,
-           status);
-
-  node->set_lower_bound(node_response_buffer[N]);
-  node->set_upper_bound(node_response_buffer[N + 1]);
-  node->set_branch_i(node_response_buffer[N + 2]);
-  node->set_branch_j(node_response_buffer[N + 3]);
+  receive_message(target_rank, buffer, status);
+  unpack_work_response(N, node, buffer);
+}
 
-  Eigen::VectorXd lower_bound_witness(N);
-  lower_bound_witness =
-    Eigen::Map<Eigen::VectorXd>(node_response_buffer, N);
-  node->set_lower_bound_witness(lower_bound_witness);
+void pack_work_response(int N, const Node* node, std::vector<char>& buffer) {
+  buffer.clear();
+  put<unsigned char>(buffer, MESSAGE_PROTOCOL_VERSION);
+  put<double>(buffer, node->get_lower_bound());
+  put<double>(buffer, node->get_upper_bound());
+  put<int>(buffer, node->get_branch_i());
+  put<int>(buffer, node->get_branch_j());
+  put<int>(buffer, node->get_sdp_iterations());
+  put<int>(buffer, node->get_sdp_warm_starts());
+  put<unsigned char>(buffer, node->is_pruned() ? 1 : 0);
 
-  std::list<std::shared_ptr<TriangleInequality>> post_inequalities{};
-  for (int i = N + 4; i < N + 4 + 6*M; i += 6) {
-    if (node_response_buffer[i] != -1) {
-      post_inequalities.push_back(std::shared_ptr<TriangleInequality>(new TriangleInequality(node_response_buffer + i)));
+  // The witness is a sign vector, sent as the bits of its negative entries
+  Eigen::VectorXd lower_bound_witness =
+    FreezeMap_expand_vector(node->get_lower_bound_witness(),
+                            node->get_freeze_map());
+  for (int i = 0; i < N; i += 8) {
+    unsigned char bits = 0;
+    for (int k = 0; k < 8 && i + k < N; k++) {
+      if (lower_bound_witness(i + k) < 0) {
+        bits |= 1 << k;
+      }
     }
+    put<unsigned char>(buffer, bits);
   }
 
-  node->set_post_inequalities(post_inequalities);
+  put_cuts(buffer, node->get_post_inequalities());
+
+  const Eigen::VectorXd& post_values = node->get_post_inequality_values();
+  for (int i = 0; i < (int) node->get_post_inequalities().size(); i++) {
+    put<double>(buffer, i < post_values.size() ? post_values(i) : 0);
+  }
+  const Eigen::VectorXd& slacks = node->get_inequality_slacks();
+  put<int>(buffer, slacks.size());
+  for (int i = 0; i < slacks.size(); i++) {
+    put<double>(buffer, slacks(i));
+  }
 }
 
 void send_work_response(int N,
-                        int M,
                         const Node* node,
-                        double* node_response_buffer) {
-  Eigen::VectorXd lower_bound_witness =
-    FreezeMap_expand_vector(node->get_lower_bound_witness(),
-                            node->get_freeze_map());
+                        std::vector<char>& buffer) {
+  pack_work_response(N, node, buffer);
+  MPI_Send(buffer.data(), buffer.size(), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
+}
+
+bool probe_work_request() {
+  int flag;
+  MPI_Status status;
+  MPI_Iprobe(0, 0, MPI_COMM_WORLD, &flag, &status);
+  return flag != 0;
+}
+
+MessageType unpack_work_request(Node* node, const std::vector<char>& buffer) {
+  MessageReader reader{buffer.data()};
+  check_protocol_version(reader);
+  MessageType message_type =
+    static_cast<MessageType>(reader.get<unsigned char>());
+
+  if (message_type == MESSAGE_WORK) {
+    // Rebuild a path to the node with one decision per frozen index, so
+    // that its children can be branched on by the worker
+    QueuedNode record;
+    record.upper_bound = std::numeric_limits<double>::infinity();
+    record.lower_bound = -std::numeric_limits<double>::infinity();
+    record.depth = reader.get_varint();
+    int v = 0;
+    for (int d = 0; d < record.depth; d++) {
+      v += reader.get_varint();
+      int rep = reader.get_varint();
+      record.path.reset(new BranchPath{record.path,
+                                       v,
+                                       rep >> 1,
+                                       rep & 1 ? -1 : 1});
+    }
+    std::shared_ptr<NodeInheritance> inheritance(new NodeInheritance());
+    get_cuts(reader, &inheritance->inequalities);
+    record.inheritance = inheritance;
+
+    *node = Node(node->get_initial_A(), record);
+  }
+
+  return message_type;
+}
+
+MessageType receive_work_request(Node* node,
+                                 std::vector<char>& buffer,
+                                 MPI_Status* status) {
+  receive_message(0, buffer, status);
+  return unpack_work_request(node, buffer);
+}
 
-  for (int i = 0; i < N; i++) {
-    node_response_buffer[i] = lower_bound_witness(i);
+void pack_warm_start(int N,
+                     int R,
+                     const SdpWarmStart* warm_start,
+                     const CutList& ineqs,
+                     std::vector<char>& buffer) {
+  buffer.clear();
+  put<unsigned char>(buffer, MESSAGE_PROTOCOL_VERSION);
+  put<unsigned char>(buffer, warm_start != NULL ? 1 : 0);
+  if (warm_start == NULL) {
+    return;
   }
 
-  node_response_buffer[N] = node->get_lower_bound();
-  node_response_buffer[N + 1] = node->get_upper_bound();
-  node_response_buffer[N + 2] = node->get_branch_i() + 0.5;
-  node_response_buffer[N + 3] = node->get_branch_j() + 0.5;
+  int cols = std::min<int>(R, warm_start->V.cols());
+  put<int>(buffer, cols);
+  for (int c = 0; c < cols; c++) {
+    for (int i = 0; i < N; i++) {
+      put<double>(buffer, warm_start->V(i, c));
+    }
+  }
 
-  int ineq_ix = 0;
-  for (std::shared_ptr<TriangleInequality> ineq : node->get_post_inequalities()) {
-    ineq->serialize(node_response_buffer + N + 4 + 6*ineq_ix);
-    ineq_ix++;
+  Eigen::VectorXd multipliers =
+    SdpWarmStart_match_multipliers(warm_start, ineqs);
+  put<int>(buffer, multipliers.size());
+  for (int i = 0; i < multipliers.size(); i++) {
+    put<double>(buffer, multipliers(i));
   }
-  for (int i = N + 4 + 6*ineq_ix; i < N + 4 + 6*M; i++) {
-    node_response_buffer[i] = -1;
+}
+
+std::shared_ptr<const SdpWarmStart> unpack_warm_start(
+    int N,
+    int R,
+    const CutList& ineqs,
+    const std::vector<char>& buffer) {
+  MessageReader reader{buffer.data()};
+  check_protocol_version(reader);
+  if (reader.get<unsigned char>() == 0) {
+    return std::shared_ptr<const SdpWarmStart>();
+  }
+
+  std::shared_ptr<SdpWarmStart> warm_start(new SdpWarmStart());
+  int cols = reader.get<int>();
+  warm_start->V = Eigen::MatrixXd::Zero(N, R);
+  for (int c = 0; c < cols; c++) {
+    for (int i = 0; i < N; i++) {
+      warm_start->V(i, c) = reader.get<double>();
+    }
+  }
+
+  warm_start->inequalities = ineqs;
+  warm_start->multipliers = Eigen::VectorXd(reader.get<int>());
+  for (int i = 0; i < warm_start->multipliers.size(); i++) {
+    warm_start->multipliers(i) = reader.get<double>();
   }
 
-  MPI_Send(node_response_buffer,
-           N + 4 + 6*M,
+  return warm_start;
+}
+
+void send_warm_start(int N,
+                     int R,
+                     int target_rank,
+                     const Node* node,
+                     std::vector<char>& buffer) {
+  pack_warm_start(N,
+                  R,
+                  node->get_warm_start().get(),
+                  node->get_inequalities(),
+                  buffer);
+
+  send_from_root(buffer.data(), buffer.size(), MPI_BYTE, target_rank);
+}
+
+void receive_warm_start(int N,
+                        int R,
+                        Node* node,
+                        std::vector<char>& buffer,
+                        MPI_Status* status) {
+  receive_message(0, buffer, status);
+  node->set_warm_start(unpack_warm_start(N,
+                                         R,
+                                         node->get_inequalities(),
+                                         buffer));
+}
+
+void send_solution(int N,
+                   int R,
+                   const Node* node,
+                   std::vector<char>& buffer) {
+  pack_warm_start(N,
+                  R,
+                  node->get_solution().get(),
+                  node->get_inequalities(),
+                  buffer);
+
+  MPI_Send(buffer.data(), buffer.size(), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
+}
+
+void receive_solution(int N,
+                      int R,
+                      int target_rank,
+                      Node* node,
+                      std::vector<char>& buffer,
+                      MPI_Status* status) {
+  receive_message(target_rank, buffer, status);
+  node->set_solution(unpack_warm_start(N,
+                                       R,
+                                       node->get_inequalities(),
+                                       buffer));
+}
+
+void send_steal_request(int victim, double incumbent) {
+  MPI_Send(&incumbent,
+           1,
            MPI_DOUBLE,
-           0,
-           0,
+           victim,
+           STEAL_TAG_REQUEST,
            MPI_COMM_WORLD);
 }
 
-MessageType receive_work_request(int N,
-                                 int M,
-                                 Node* node,
-                                 int* node_request_buffer,
-                                 MPI_Status* status) {
-  FreezeMap freeze_map;
+void receive_steal_request(int source, double* incumbent) {
+  MPI_Recv(incumbent,
+           1,
+           MPI_DOUBLE,
+           source,
+           STEAL_TAG_REQUEST,
+           MPI_COMM_WORLD,
+           MPI_STATUS_IGNORE);
+}
+
+// Ints taken by a double in the buffers of queued nodes
+static const int INTS_PER_DOUBLE = sizeof(double) / sizeof(int);
 
-  MPI_Recv(node_request_buffer,
-           3*N + 6*M + 1,
+// Writes the number of nodes to buffer from pos on, then for each node its
+// bounds, its depth, its length as serialized and the serialized node,
+// resizing buffer to fit.
+static void pack_queued_nodes(const std::vector<QueuedNode>& nodes,
+                              int pos,
+                              std::vector<int>& buffer) {
+  int size = pos + 1;
+  for (const QueuedNode& node : nodes) {
+    size += 2 * INTS_PER_DOUBLE + 2 + QueuedNode_int_size(node);
+  }
+  buffer.resize(size);
+
+  buffer[pos++] = nodes.size();
+  for (const QueuedNode& node : nodes) {
+    std::memcpy(&buffer[pos], &node.upper_bound, sizeof(double));
+    pos += INTS_PER_DOUBLE;
+    std::memcpy(&buffer[pos], &node.lower_bound, sizeof(double));
+    pos += INTS_PER_DOUBLE;
+    buffer[pos++] = node.depth;
+    buffer[pos++] = QueuedNode_int_size(node);
+    QueuedNode_serialize(node, &buffer[pos]);
+    pos += buffer[pos - 1];
+  }
+}
+
+// Inverse of pack_queued_nodes.
+static void unpack_queued_nodes(const std::vector<int>& buffer,
+                                int pos,
+                                std::vector<QueuedNode>* nodes) {
+  nodes->resize(buffer[pos++]);
+  for (QueuedNode& node : *nodes) {
+    std::memcpy(&node.upper_bound, &buffer[pos], sizeof(double));
+    pos += INTS_PER_DOUBLE;
+    std::memcpy(&node.lower_bound, &buffer[pos], sizeof(double));
+    pos += INTS_PER_DOUBLE;
+    node.depth = buffer[pos++];
+    int length = buffer[pos++];
+    QueuedNode_deserialize(&buffer[pos], &node);
+    pos += length;
+  }
+}
+
+// Receives a message of ints of unknown length from source into buffer.
+static void receive_ints(int source,
+                         int tag,
+                         const MPI_Status* status,
+                         std::vector<int>& buffer) {
+  int size;
+  MPI_Get_count(status, MPI_INT, &size);
+  buffer.resize(size);
+  MPI_Recv(buffer.data(),
+           size,
            MPI_INT,
-           0,
-           0,
+           source,
+           tag,
            MPI_COMM_WORLD,
-           status);
+           MPI_STATUS_IGNORE);
+}
 
-  MessageType message_type = 
-    static_cast<MessageType>(node_request_buffer[3*N + 6*M]);
+void send_stolen_nodes(int thief,
+                       double incumbent,
+                       const std::vector<QueuedNode>& nodes,
+                       std::vector<int>& buffer) {
+  pack_queued_nodes(nodes, INTS_PER_DOUBLE, buffer);
+  std::memcpy(&buffer[0], &incumbent, sizeof(double));
 
-  if (message_type == MESSAGE_WORK) {
-    FreezeMap_deserialize(N, node_request_buffer, &freeze_map);
-    std::list<std::shared_ptr<TriangleInequality>> inequalities{};
-    for (int i = 3*N; i < 3*N + 6*M; i += 6) {
-      if (node_request_buffer[i] != -1) {
-        inequalities.push_back(std::shared_ptr<TriangleInequality>(new TriangleInequality(node_request_buffer + i)));
-      }
-    }
+  MPI_Send(buffer.data(),
+           buffer.size(),
+           MPI_INT,
+           thief,
+           STEAL_TAG_NODES,
+           MPI_COMM_WORLD);
+}
+
+void receive_stolen_nodes(const MPI_Status* status,
+                          double* incumbent,
+                          std::vector<QueuedNode>* nodes,
+                          std::vector<int>& buffer) {
+  receive_ints(status->MPI_SOURCE, STEAL_TAG_NODES, status, buffer);
+  std::memcpy(incumbent, &buffer[0], sizeof(double));
+  unpack_queued_nodes(buffer, INTS_PER_DOUBLE, nodes);
+}
+
+void send_frontier(int num_created,
+                   int num_pruned,
+                   const std::vector<QueuedNode>& nodes,
+                   std::vector<int>& buffer) {
+  pack_queued_nodes(nodes, 2, buffer);
+  buffer[0] = num_created;
+  buffer[1] = num_pruned;
+
+  MPI_Send(buffer.data(), buffer.size(), MPI_INT, 0, 0, MPI_COMM_WORLD);
+}
+
+void receive_frontier(int source,
+                      int* num_created,
+                      int* num_pruned,
+                      std::vector<QueuedNode>* nodes,
+                      std::vector<int>& buffer) {
+  MPI_Status status;
+  MPI_Probe(source, 0, MPI_COMM_WORLD, &status);
+  receive_ints(source, 0, &status, buffer);
+  *num_created = buffer[0];
+  *num_pruned = buffer[1];
+  unpack_queued_nodes(buffer, 2, nodes);
+}
 
-    *node = Node(node->get_initial_A(), freeze_map, inequalities);
+void send_termination_token(int target_rank, const TerminationToken& token) {
+  double buffer[3] = {(double) token.count,
+                      token.black ? 1.0 : 0.0,
+                      token.incumbent};
+  MPI_Send(buffer,
+           3,
+           MPI_DOUBLE,
+           target_rank,
+           STEAL_TAG_TOKEN,
+           MPI_COMM_WORLD);
+}
+
+void receive_termination_token(int source, TerminationToken* token) {
+  double buffer[3];
+  MPI_Recv(buffer,
+           3,
+           MPI_DOUBLE,
+           source,
+           STEAL_TAG_TOKEN,
+           MPI_COMM_WORLD,
+           MPI_STATUS_IGNORE);
+  token->count = buffer[0];
+  token->black = buffer[1] != 0;
+  token->incumbent = buffer[2];
+}
+
+void send_steal_finish(int target_rank) {
+  MPI_Send(NULL, 0, MPI_INT, target_rank, STEAL_TAG_FINISH, MPI_COMM_WORLD);
+}
+
+void receive_steal_finish(int source) {
+  MPI_Recv(NULL,
+           0,
+           MPI_INT,
+           source,
+           STEAL_TAG_FINISH,
+           MPI_COMM_WORLD,
+           MPI_STATUS_IGNORE);
+}
+
+void gather_witness(int N,
+                    int holder,
+                    const Eigen::VectorXd& local,
+                    Eigen::VectorXd* witness) {
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  if (rank == 0 && holder == 0) {
+    *witness = local;
+  } else if (rank == 0) {
+    witness->resize(N);
+    MPI_Recv(witness->data(),
+             N,
+             MPI_DOUBLE,
+             holder,
+             WITNESS_TAG,
+             MPI_COMM_WORLD,
+             MPI_STATUS_IGNORE);
+  } else if (rank == holder) {
+    MPI_Send(local.data(), N, MPI_DOUBLE, 0, WITNESS_TAG, MPI_COMM_WORLD);
   }
+}
 
-  return message_type;
+void reduce_sdp_solver_stats(const SdpSolverStats& local,
+                             SdpSolverStats* total) {
+  double local_buffer[4] = {(double) local.solves,
+                            local.setup_time,
+                            local.solve_time,
+                            local.uncached_setup_time};
+  double total_buffer[4];
+
+  MPI_Reduce(local_buffer,
+             total_buffer,
+             4,
+             MPI_DOUBLE,
+             MPI_SUM,
+             0,
+             MPI_COMM_WORLD);
+
+  total->solves = (int) total_buffer[0];
+  total->setup_time = total_buffer[1];
+  total->solve_time = total_buffer[2];
+  total->uncached_setup_time = total_buffer[3];
 }
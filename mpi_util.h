@@ -1,45 +1,207 @@
+#include <deque>
 #include <memory>
 #include <mpi.h>
+#include <vector>
 #include "node.h"
 #include "message.h"
+#include "cut.h"
+#include "sdp.h"
 
 
-// Sends a request to process `target_rank` to handle `node`.
-// Assumes node_request_buffer has length 3*N + 1.
+// Requests, responses, warm starts and solutions between the root and a
+// worker are variable-length byte messages starting with
+// MESSAGE_PROTOCOL_VERSION, which are sized on arrival and received into a
+// buffer resized to fit.
+
+// Largest length in bytes of a work request for N variables and up to M
+// inequalities per node.
+int work_request_size(int N, int M);
+
+// Sends a request to process `target_rank` to handle `node`: the message
+// type, then the frozen indices in increasing order, each as its gap from
+// the previous one and its representative with the sign in the lowest bit,
+// all as varints, and the inequalities, each as its type, number of points
+// and signs in a byte each followed by its points.
 void send_work_request(int N,
-		       int M,
                        int target_rank,
                        const Node* node,
-                       int* node_request_buffer);
+                       std::vector<char>& buffer);
 
 
+// Attaches a buffer for up to `count` messages from the root to be in flight
+// at once, each a work request followed by a warm start if R > 0, or a
+// finish request. Until detach_work_request_buffer is called, the root's
+// sends then return at once, even to workers that are still busy.
+void attach_work_request_buffer(int N, int M, int R, int count);
+void detach_work_request_buffer();
+
 // Sends a request to process `target_rank` to terminate.
-// Assumes node_request_buffer has length 3*N + 1.
-void send_finish_request(int N,
-			 int M,
-                         int target_rank,
-                         int* node_request_buffer);
+void send_finish_request(int target_rank);
 
 void receive_work_response(int N,
-			   int M,
                            int target_rank,
                            Node* node,
-                           double* node_response_buffer,
+                           std::vector<char>& buffer,
                            MPI_Status* status);
 
-void receive_work_response(int N,
-			   int M,
-                           std::map<int, std::shared_ptr<Node>>& node_map,
-                           double* node_response_buffer,
-                           MPI_Status* status);
+// Receives the response of any worker into the oldest of the nodes pending
+// on it, pending[rank].front().
+void receive_work_response(
+    int N,
+    std::vector<std::deque<std::shared_ptr<Node>>>& pending,
+    std::vector<char>& buffer,
+    MPI_Status* status);
+
+// Returns whether a request from the root is waiting on a worker.
+bool probe_work_request();
 
-MessageType receive_work_request(int N,
-				 int M,
-                                 Node* node,
-                                 int* node_request_buffer,
+// Receives a request on a worker. For a work request, the node is written to
+// `node`.
+MessageType receive_work_request(Node* node,
+                                 std::vector<char>& buffer,
                                  MPI_Status* status);
 
+// Sends the results of an executed node to the root: the bounds, the
+// branching pair, the SDP statistics, the lower bound witness as the bits
+// of its negative entries and the post inequalities, followed by the values
+// of the post inequalities and the slacks of the node's inequalities in its
+// SDP solution, which feed the cut pool.
 void send_work_response(int N,
-			int M,
                         const Node* node,
-                        double* node_response_buffer);
+                        std::vector<char>& buffer);
+
+// Sends the warm start of `node` (its parent's solution) to `target_rank`,
+// following a work request: its factor truncated to R columns and its
+// multipliers matched to the node's inequalities, or only a flag if it has
+// none.
+void send_warm_start(int N,
+                     int R,
+                     int target_rank,
+                     const Node* node,
+                     std::vector<char>& buffer);
+
+// Receives the message sent by send_warm_start on a worker.
+void receive_warm_start(int N,
+                        int R,
+                        Node* node,
+                        std::vector<char>& buffer,
+                        MPI_Status* status);
+
+// Sends the records of the nodes left unexplored by a worker's dive (see
+// McbbOptions::dive_nodes) to the root, following its work response and
+// solution, along with the number of nodes the dive created and of those
+// pruned during their SDP. Warm starts are not sent, and buffer is resized
+// as needed.
+void send_frontier(int num_created,
+                   int num_pruned,
+                   const std::vector<QueuedNode>& nodes,
+                   std::vector<int>& buffer);
+
+// Receives the message sent by send_frontier from `source`.
+void receive_frontier(int source,
+                      int* num_created,
+                      int* num_pruned,
+                      std::vector<QueuedNode>* nodes,
+                      std::vector<int>& buffer);
+
+// Sends the solution of an executed node back to the root, following a work
+// response, in the same format as send_warm_start.
+void send_solution(int N,
+                   int R,
+                   const Node* node,
+                   std::vector<char>& buffer);
+
+// Receives the message sent by send_solution from `target_rank`.
+void receive_solution(int N,
+                      int R,
+                      int target_rank,
+                      Node* node,
+                      std::vector<char>& buffer,
+                      MPI_Status* status);
+
+// The encodings of the messages above, on which their send and receive
+// functions are built.
+
+// Writes the work request of send_work_request for `node` to buffer.
+void pack_work_request(int N, const Node* node, std::vector<char>& buffer);
+
+// Reads a request written by pack_work_request or send_finish_request. For
+// a work request, the node is written to `node`.
+MessageType unpack_work_request(Node* node, const std::vector<char>& buffer);
+
+// Writes the response of send_work_response for `node` to buffer.
+void pack_work_response(int N, const Node* node, std::vector<char>& buffer);
+
+// Reads the results of an executed node from a response written by
+// pack_work_response into node.
+void unpack_work_response(int N, Node* node, const std::vector<char>& buffer);
+
+// Writes a warm start or solution message to buffer: the version, a flag
+// for whether a warm start is present, and if so the number of columns of
+// its factor (truncated to R), the factor by columns and the multipliers
+// matched to `ineqs`.
+void pack_warm_start(int N,
+                     int R,
+                     const SdpWarmStart* warm_start,
+                     const CutList& ineqs,
+                     std::vector<char>& buffer);
+
+// Inverse of pack_warm_start, where `ineqs` are the inequalities the
+// multipliers belong to. The factor is padded with zero columns to R.
+std::shared_ptr<const SdpWarmStart> unpack_warm_start(
+    int N,
+    int R,
+    const CutList& ineqs,
+    const std::vector<char>& buffer);
+
+// Token of the Dijkstra-Safra termination detection in the work-stealing
+// mode, passed around the ring of processes: the sum of the message counts
+// (node messages sent minus received) of the processes it has visited,
+// whether any of them received nodes since the token last passed, and the
+// best incumbent it has seen.
+struct TerminationToken {
+  long count;
+  bool black;
+  double incumbent;
+};
+
+// Sends a steal request to `victim`, along with the sender's incumbent.
+void send_steal_request(int victim, double incumbent);
+
+// Receives a steal request from `source` and the incumbent sent with it.
+void receive_steal_request(int source, double* incumbent);
+
+// Sends nodes taken from the sender's queue to `thief`, or none to refuse,
+// along with the sender's incumbent. Warm starts are not sent, and buffer is
+// resized as needed.
+void send_stolen_nodes(int thief,
+                       double incumbent,
+                       const std::vector<QueuedNode>& nodes,
+                       std::vector<int>& buffer);
+
+// Receives the message sent by send_stolen_nodes, whose envelope was found
+// by probing into status.
+void receive_stolen_nodes(const MPI_Status* status,
+                          double* incumbent,
+                          std::vector<QueuedNode>* nodes,
+                          std::vector<int>& buffer);
+
+void send_termination_token(int target_rank, const TerminationToken& token);
+void receive_termination_token(int source, TerminationToken* token);
+
+// Tells process `target_rank` that the work-stealing search is over.
+void send_steal_finish(int target_rank);
+void receive_steal_finish(int source);
+
+// Copies the witness of the incumbent, local on `holder`, into `witness` on
+// the root. Must be called by every process with the same holder; the
+// others' local witnesses are not read.
+void gather_witness(int N,
+                    int holder,
+                    const Eigen::VectorXd& local,
+                    Eigen::VectorXd* witness);
+
+// Sums the solver statistics of all processes into `total` on the root.
+// Must be called by every process; the root passes empty statistics.
+void reduce_sdp_solver_stats(const SdpSolverStats& local,
+                             SdpSolverStats* total);
@@ -1,29 +1,41 @@
+#include <cassert>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <limits>
-#include <list>
-#include <map>
 #include <memory>
 #include <set>
+#include <string>
 #include <utility>
+#include <vector>
 #include <Eigen/Dense>
+#include "bit_laplacian.h"
 #include "freeze_map.h"
+#include "reduced_matrix_cache.h"
 #include "branch.h"
 #include "node.h"
 #include "sdp.h"
 #include "round.h"
 #include "brute_force.h"
-#include "triangle_inequality.h"
+#include "cut.h"
+#include "cutting_plane.h"
+#include "separation.h"
 
 
 Node::Node(const Eigen::MatrixXd* A,
            FreezeMap f,
-           std::list<std::shared_ptr<TriangleInequality>> ineqs) {
+           CutList ineqs) {
   this->initial_A = A;
-  this->freezes = f;
+  this->freezes = std::move(f);
+  this->depth = 0;
   this->executed = false;
   this->upper_bound = std::numeric_limits<double>::infinity();
-  this->inequalities_post = std::list<std::shared_ptr<TriangleInequality>>{};
-  this->inequalities = ineqs;
+  this->lower_bound = -std::numeric_limits<double>::infinity();
+  this->inequalities_post = CutList();
+  this->inequalities = std::move(ineqs);
+  this->sdp_iterations = 0;
+  this->sdp_warm_starts = 0;
+  this->pruned = false;
 }
 
 
@@ -31,62 +43,209 @@ Node::Node(const Eigen::MatrixXd* A) {
   initial_A = A;
   int N = (*A).rows();
 
-  inequalities = std::list<std::shared_ptr<TriangleInequality>>{};
-  inequalities_post = std::list<std::shared_ptr<TriangleInequality>>{};
+  inequalities = CutList();
+  inequalities_post = CutList();
 
-  freezes = FreezeMap{};
-  for (int i = 0; i < N; i++) {
-    freezes.insert(std::make_pair(i, std::map<int, int>()));
-  }
+  freezes = FreezeMap(N);
+  depth = 0;
 
   upper_bound = std::numeric_limits<double>::infinity();
+  lower_bound = -std::numeric_limits<double>::infinity();
+  sdp_iterations = 0;
+  sdp_warm_starts = 0;
+  pruned = false;
+}
+
+Node::Node(const Eigen::MatrixXd* A, const QueuedNode& record) {
+  initial_A = A;
+  freezes = BranchPath_freeze_map(record.path.get(), A->rows());
+  path = record.path;
+  depth = record.depth;
+  if (record.inheritance) {
+    inequalities = record.inheritance->inequalities;
+    warm_start = record.inheritance->warm_start;
+  }
+
+  executed = false;
+  upper_bound = record.upper_bound;
+  lower_bound = -std::numeric_limits<double>::infinity();
+  sdp_iterations = 0;
+  sdp_warm_starts = 0;
+  pruned = false;
+}
+
+FreezeMap BranchPath_freeze_map(const BranchPath* path, int N) {
+  std::vector<const BranchPath*> decisions;
+  for (; path != NULL; path = path->parent.get()) {
+    decisions.push_back(path);
+  }
+
+  FreezeMap ret(N);
+  for (std::vector<const BranchPath*>::const_reverse_iterator it =
+         decisions.rbegin();
+       it != decisions.rend();
+       ++it) {
+    ret.freeze((*it)->i, (*it)->j, (*it)->sign);
+  }
+  return ret;
+}
+
+int QueuedNode_int_size(const QueuedNode& node) {
+  int num_inequalities =
+    node.inheritance ? node.inheritance->inequalities.size() : 0;
+  return 3 * node.depth + CutList_int_size(num_inequalities);
+}
+
+void QueuedNode_serialize(const QueuedNode& node, int* s) {
+  int pos = 3 * node.depth;
+  for (const BranchPath* path = node.path.get();
+       path != NULL;
+       path = path->parent.get()) {
+    pos -= 3;
+    s[pos] = path->i;
+    s[pos + 1] = path->j;
+    s[pos + 2] = path->sign;
+  }
+
+  if (node.inheritance) {
+    CutList_serialize(node.inheritance->inequalities, s + 3 * node.depth);
+  } else {
+    CutList_serialize(CutList(), s + 3 * node.depth);
+  }
+}
+
+void QueuedNode_deserialize(const int* s, QueuedNode* node) {
+  node->path.reset();
+  for (int d = 0; d < node->depth; d++) {
+    node->path.reset(new BranchPath{node->path,
+                                    s[3 * d],
+                                    s[3 * d + 1],
+                                    s[3 * d + 2]});
+  }
+
+  std::shared_ptr<NodeInheritance> inheritance(new NodeInheritance());
+  CutList_deserialize(s + 3 * node->depth, &inheritance->inequalities);
+  node->inheritance = inheritance;
+}
+
+std::pair<QueuedNode, QueuedNode> Node::branch(int i, int j) {
+  // Pruned and brute-forced nodes have no branching pair
+  int sign;
+  int N = freezes.get_num_indices();
+  assert(i >= 0 && i < N && j >= 0 && j < N && i != j);
+  assert(freezes.find(i, &sign) == i && freezes.find(j, &sign) == j);
+  (void) sign;
+  (void) N;
+
+  // Children differ from this node by one identification, so this node's
+  // solution is a good starting point for theirs, unless they carry post
+  // inequalities it was not solved with. Those are chosen because the
+  // solution violates them, and starting there costs more iterations than a
+  // random start.
+  std::shared_ptr<NodeInheritance> inheritance(new NodeInheritance());
+  inheritance->inequalities = inequalities_post;
+  if (solution && SdpWarmStart_contains(solution.get(), inequalities_post)) {
+    inheritance->warm_start = solution;
+  }
+
+  // Propagate current node's bounds to children
+  QueuedNode pos;
+  pos.upper_bound = upper_bound;
+  pos.lower_bound = lower_bound;
+  pos.depth = depth + 1;
+  pos.path.reset(new BranchPath{path, i, j, +1});
+  pos.inheritance = inheritance;
+
+  QueuedNode neg = pos;
+  neg.path.reset(new BranchPath{path, i, j, -1});
+
+  return std::make_pair(pos, neg);
+}
+
+QueuedNode Node::get_record() const {
+  std::shared_ptr<NodeInheritance> inheritance(new NodeInheritance());
+  inheritance->inequalities = inequalities;
+  inheritance->warm_start = warm_start;
+
+  QueuedNode ret;
+  ret.upper_bound = upper_bound;
+  ret.lower_bound = lower_bound;
+  ret.depth = depth;
+  ret.path = path;
+  ret.inheritance = inheritance;
+  return ret;
+}
+
+Eigen::VectorXd SdpWarmStart_match_multipliers(
+    const SdpWarmStart* warm_start,
+    const CutList& ineqs) {
+  Eigen::VectorXd ret = Eigen::VectorXd::Zero(ineqs.size());
+
+  int ix = 0;
+  for (const Cut& ineq : ineqs) {
+    int ws_ix = 0;
+    for (const Cut& ws_ineq :
+           warm_start->inequalities) {
+      if (ws_ix >= warm_start->multipliers.size()) {
+        break;
+      }
+      if (ineq.get_key() == ws_ineq.get_key()) {
+        ret(ix) = warm_start->multipliers(ws_ix);
+        break;
+      }
+      ws_ix++;
+    }
+    ix++;
+  }
+
+  return ret;
 }
 
-std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>> Node::branch(int i,
-                                                                     int j) {
-  std::pair<FreezeMap, FreezeMap> freeze_maps =
-    FreezeMap_branch(&freezes, i, j);
-
-  // BranchMap of adding xi = xj
-  FreezeMap freezes_pos = freezes;
-  freezes_pos[j].insert(freezes_pos[i].begin(), freezes_pos[i].end());
-  freezes_pos[j].insert(std::make_pair(i, +1));
-  freezes_pos.erase(i);
-
-  // BranchMap of adding xi = -xj
-  FreezeMap freezes_neg = freezes;
-  std::for_each(freezes_neg[i].begin(),
-                freezes_neg[i].end(),
-                [](std::pair<const int, int>& p) {
-                  p.second = -p.second;
-                });
-  freezes_neg[j].insert(freezes_neg[i].begin(), freezes_neg[i].end());
-  freezes_neg[j].insert(std::make_pair(i, -1));
-  freezes_neg.erase(i);
-
-  std::shared_ptr<Node> pnode_pos(new Node(initial_A,
-                                           freezes_pos,
-                                           inequalities_post));
-  std::shared_ptr<Node> pnode_neg(new Node(initial_A,
-                                           freezes_neg,
-                                           inequalities_post));
-
-  // Propagate current node's upper bound to children
-  pnode_pos->set_upper_bound(upper_bound);
-  pnode_neg->set_upper_bound(upper_bound);
-
-  return std::make_pair(pnode_pos, pnode_neg);
+bool SdpWarmStart_contains(const SdpWarmStart* warm_start,
+                           const CutList& ineqs) {
+  for (const Cut& ineq : ineqs) {
+    bool found = false;
+    for (const Cut& ws_ineq : warm_start->inequalities) {
+      if (ineq.get_key() == ws_ineq.get_key()) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return true;
 }
 
-void Node::execute(int num_post_ineqs) {
+void Node::execute(int num_post_ineqs,
+                   const CutFamilies& cut_families,
+                   SdpSolver* solver,
+                   Incumbent* incumbent,
+                   int leaf_size,
+                   int tabu_budget,
+                   CuttingPlaneTuner* cutting_planes,
+                   const BitLaplacian* laplacian,
+                   ReducedMatrixCache* matrices) {
   // Compute number of active variables
   int N = initial_A->rows();
   int M = N - FreezeMap_num_frozen(&freezes);
 
   // Compute "effective" A matrix at this node
-  Eigen::MatrixXd node_A = FreezeMap_transform_matrix(*initial_A, &freezes);
+  Eigen::MatrixXd node_A = matrices != NULL ?
+    matrices->get(*initial_A, &freezes) :
+    FreezeMap_transform_matrix(*initial_A, &freezes);
+
+  std::vector<int> key_to_ix(N);
+  freezes.get_key_indices(key_to_ix.data());
+  std::vector<int> ix_to_key(freezes.get_keys(), freezes.get_keys() + M);
+
+  this->inequality_slacks =
+    Eigen::VectorXd::Constant(inequalities.size(),
+                              std::numeric_limits<double>::quiet_NaN());
+  this->post_inequality_values = Eigen::VectorXd(0);
 
-  if (M <= 6) {
+  if (M <= leaf_size) {
     Eigen::VectorXd optimizer(M);
     brute_force(node_A, optimizer);
     double value = optimizer.dot(node_A * optimizer);
@@ -96,45 +255,114 @@ void Node::execute(int num_post_ineqs) {
     this->y = optimizer;
     this->Y = optimizer * optimizer.transpose();
   } else {
+    std::shared_ptr<BitLaplacianView> bits;
+    if (laplacian != NULL && M * M >= BIT_LAPLACIAN_CROSSOVER * N) {
+      bits.reset(new BitLaplacianView(laplacian, &freezes));
+    }
+
     // Run the SDP for upper bound
 
-    // Translate inequalities to local indices
-    std::map<int, int> key_to_ix;
-    int key_ix = 0;
-    for (FreezeMap::const_iterator it=freezes.begin(); it != freezes.end(); ++it) {
-      key_to_ix[it->first] = key_ix;
-      key_ix++;
-    }
+    // Translate inequalities to local indices. They only involve keys of
+    // freezes (see Node::branch and CutPool::attach).
+    CutList converted_inequalities = this->inequalities;
+    bool translated =
+      CutList_transform(&converted_inequalities, key_to_ix, NULL);
+    assert(translated);
+    (void) translated;
 
-    std::list<std::shared_ptr<TriangleInequality>> converted_inequalities{};
-    for (std::shared_ptr<TriangleInequality> ineq : this->inequalities) {
-      converted_inequalities.push_back(std::shared_ptr<TriangleInequality>(new TriangleInequality(key_to_ix[ineq->get_i()], key_to_ix[ineq->get_j()], key_to_ix[ineq->get_k()], ineq->get_sign_ij(), ineq->get_sign_ik(), ineq->get_sign_jk())));
+    // Restrict the parent's solution to the active indices of this node
+    SdpState start;
+    if (warm_start) {
+      start.V = FreezeMap_restrict_rows(warm_start->V, &freezes);
+      start.multipliers =
+        SdpWarmStart_match_multipliers(warm_start.get(), this->inequalities);
     }
 
+    std::chrono::steady_clock::time_point solve_start =
+      std::chrono::steady_clock::now();
+
     Y = Eigen::MatrixXd(M, M);
-    sdp(node_A, converted_inequalities, Y);
-    this->upper_bound = (Y * node_A).trace();
+    SdpState state;
+    this->pruned = solver->solve(node_A,
+                                 converted_inequalities,
+                                 warm_start ? &start : NULL,
+                                 incumbent->get(),
+                                 Y,
+                                 this->upper_bound,
+                                 state);
 
-    // Run rounding for lower bound
-    round_iter(node_A, Y, y, 0.5);
-    this->lower_bound = y.dot(node_A * y);
-  }
+    std::chrono::steady_clock::time_point solve_end =
+      std::chrono::steady_clock::now();
 
-  std::pair<int, int> branch_pair = branch_easy(Y);
-  int ix = 0;
-  for (FreezeMap::const_iterator it=freezes.begin();
-       it != freezes.end();
-       ++it) {
-    int i = it->first;
+    this->sdp_iterations = state.iterations;
+    if (warm_start) {
+      this->sdp_warm_starts = 1;
+    }
 
-    if (ix == branch_pair.first) {
-      this->branch_i = i;
-    } else if (ix == branch_pair.second) {
-      this->branch_j = i;
+    // Tighten the bound with further inequalities before branching
+    CutList sdp_inequalities = converted_inequalities;
+    if (!this->pruned && cutting_planes != NULL) {
+      this->pruned = cutting_plane_rounds(
+        node_A,
+        solver,
+        incumbent->get(),
+        std::chrono::duration<double>(solve_end - solve_start).count(),
+        cutting_planes,
+        cut_families,
+        sdp_inequalities,
+        Y,
+        this->upper_bound,
+        state,
+        this->sdp_iterations);
     }
 
-    ix++;
+    // Another process may have found a solution as good as this bound
+    // meanwhile, making rounding and branching pointless
+    if (!this->pruned && this->upper_bound <= incumbent->get()) {
+      this->pruned = true;
+    }
+
+    if (!this->pruned) {
+      int ineq_ix = 0;
+      for (const Cut& ineq : converted_inequalities) {
+        this->inequality_slacks(ineq_ix) = ineq.eval(Y);
+        ineq_ix++;
+      }
+    }
+    if (this->pruned) {
+      // No children will be created, so there is nothing to round, branch on
+      // or pass on. The all-ones cut is reported as a trivial lower bound.
+      this->y = Eigen::VectorXd::Ones(M);
+      this->lower_bound = bits ? bits->value(y) : y.dot(node_A * y);
+      this->branch_i = -1;
+      this->branch_j = -1;
+      executed = true;
+      return;
+    }
+
+    if (state.V.rows() == M) {
+      std::shared_ptr<SdpWarmStart> sol(new SdpWarmStart());
+      sol->V = FreezeMap_expand_rows(state.V, &freezes);
+      // The multipliers belong to the inequalities of the last solve, which
+      // are translated back to original indices
+      sol->inequalities.swap(sdp_inequalities);
+      CutList_transform(&sol->inequalities, ix_to_key, NULL);
+      sol->multipliers = state.multipliers;
+      this->solution = sol;
+    }
+
+    // Run rounding for lower bound
+    // Seed from the freezes, so that each node draws its own hyperplanes
+    // whichever worker executes it
+    unsigned seed =
+      std::hash<std::string>()(FreezeMap_to_string(&freezes));
+    round_iter(node_A, Y, y, 0.5, bits.get(), tabu_budget, seed);
+    this->lower_bound = bits ? bits->value(y) : y.dot(node_A * y);
   }
+
+  std::pair<int, int> branch_pair = branch_easy(Y);
+  this->branch_i = freezes.get_key(branch_pair.first);
+  this->branch_j = freezes.get_key(branch_pair.second);
   if (this->branch_i > this->branch_j) {
     int tmp = branch_i;
     branch_i = branch_j;
@@ -142,11 +370,21 @@ void Node::execute(int num_post_ineqs) {
   }
 
   std::set<int> avoid_ixs = { branch_pair.first, branch_pair.second };
-  choose_best_ineqs(Y,
-                    this->freezes,
-                    avoid_ixs,
-                    num_post_ineqs,
-                    this->inequalities_post);
+  choose_best_cuts(Y,
+                   this->freezes,
+                   avoid_ixs,
+                   num_post_ineqs,
+                   cut_families,
+                   this->inequalities_post);
+
+  this->post_inequality_values = Eigen::VectorXd(inequalities_post.size());
+  int post_ix = 0;
+  Cut converted;
+  for (const Cut& ineq : inequalities_post) {
+    ineq.transform(key_to_ix, NULL, converted);
+    this->post_inequality_values(post_ix) = converted.eval(Y);
+    post_ix++;
+  }
 
   executed = true;
 }
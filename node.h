@@ -1,25 +1,100 @@
 #ifndef __NODE_H__
 #define __NODE_H__
 
-#include <list>
 #include <limits>
 #include <map>
 #include <memory>
 #include <set>
 #include <utility>
+#include <vector>
 #include <Eigen/Dense>
+#include "bit_laplacian.h"
+#include "cut.h"
+#include "cutting_plane.h"
 #include "freeze_map.h"
-#include "triangle_inequality.h"
+#include "incumbent.h"
+#include "reduced_matrix_cache.h"
+#include "sdp.h"
+#include "separation.h"
+
+// Solver state of a node in the original indices, where the factor row of a
+// frozen index is the signed copy of its representative's row. Restricting
+// the rows to the keys of a descendant's FreezeMap gives a warm start for the
+// descendant.
+struct SdpWarmStart {
+  Eigen::MatrixXd V;
+  CutList inequalities;
+  Eigen::VectorXd multipliers;
+};
+
+// Returns the multipliers of warm_start for each of ineqs (in the same
+// indices), or zero for those that warm_start does not contain.
+Eigen::VectorXd SdpWarmStart_match_multipliers(
+    const SdpWarmStart* warm_start,
+    const CutList& ineqs);
+
+// Returns whether every one of ineqs is among the inequalities of
+// warm_start.
+bool SdpWarmStart_contains(const SdpWarmStart* warm_start,
+                           const CutList& ineqs);
+
+// A branching decision x_i = sign * x_j, linked to the decisions above it,
+// so that the path from the root is shared by all the nodes below.
+struct BranchPath {
+  std::shared_ptr<const BranchPath> parent;
+  int i;
+  int j;
+  int sign;
+};
+
+// What the children of a node inherit from it besides their paths: its post
+// inequalities and its solution as a warm start. Shared by both children.
+struct NodeInheritance {
+  CutList inequalities;
+  std::shared_ptr<const SdpWarmStart> warm_start;
+};
+
+// Compact record of a node waiting in the queue, which becomes a Node only
+// when it is dispatched.
+struct QueuedNode {
+  double upper_bound;
+  // Lower bound found at the parent, or -infinity at the root
+  double lower_bound;
+  int depth;
+  std::shared_ptr<const BranchPath> path;
+  std::shared_ptr<const NodeInheritance> inheritance;
+};
+
+// Returns the FreezeMap on N indices reached by the decisions of path.
+FreezeMap BranchPath_freeze_map(const BranchPath* path, int N);
+
+// Length in ints of the path and inherited inequalities of a queued node, as
+// written by QueuedNode_serialize.
+int QueuedNode_int_size(const QueuedNode& node);
+
+// Writes the (i, j, sign) decisions of a queued node's path from the root
+// down, then its inherited inequalities as serialized by CutList_serialize.
+// The bounds, depth and warm start are left to the caller.
+void QueuedNode_serialize(const QueuedNode& node, int* s);
+
+// Inverse of QueuedNode_serialize, for a node whose depth is already set.
+void QueuedNode_deserialize(const int* s, QueuedNode* node);
 
 class Node
 {
  private:
   const Eigen::MatrixXd* initial_A;
-  std::list<std::shared_ptr<TriangleInequality>> inequalities;
-  std::list<std::shared_ptr<TriangleInequality>> inequalities_post;
+  CutList inequalities;
+  CutList inequalities_post;
   FreezeMap freezes;
+  // Decisions from the root, only known to the coordinator
+  std::shared_ptr<const BranchPath> path;
+  int depth;
   bool executed;
 
+  // Solver state of the parent, used to warm-start this node
+  std::shared_ptr<const SdpWarmStart> warm_start;
+
   // Post-execution data
   int branch_i;
   int branch_j;
@@ -28,6 +103,22 @@ class Node
   Eigen::MatrixXd Y;
   Eigen::VectorXd y;
   Eigen::VectorXd x;
+  std::shared_ptr<const SdpWarmStart> solution;
+  int sdp_iterations;
+  int sdp_warm_starts;
+  // Whether the SDP proved the node cannot beat the incumbent, in which case
+  // no lower bound, branching pair or inequalities were computed
+  bool pruned;
+  // Slack of each inequality in the node's SDP solution, or NaN where no SDP
+  // solution was computed
+  Eigen::VectorXd inequality_slacks;
+  // Value of each post inequality in the node's SDP solution, negative for
+  // violated inequalities
+  Eigen::VectorXd post_inequality_values;
+
+  // Cut pool entry that each inequality was translated from, or
+  // CutPool::no_source() for those not attached from the pool (see CutPool)
+  std::vector<CutKey> inequality_sources;
 
  public:
   // Constructor of root node
@@ -35,27 +126,43 @@ class Node
   // Constructor of child nodes
   Node(const Eigen::MatrixXd* A, 
        FreezeMap f, 
-       std::list<std::shared_ptr<TriangleInequality>> ineqs);
+       CutList ineqs);
+  // Constructor of a node from its queue record
+  Node(const Eigen::MatrixXd* A, const QueuedNode& record);
 
-  std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>> branch(int i, int j);
+  // Returns the queue records of the children on x_i = x_j and x_i = -x_j,
+  // where i and j must be distinct keys of this node.
+  std::pair<QueuedNode, QueuedNode> branch(int i, int j);
 
-  std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>> branch_on_suggested() {
+  std::pair<QueuedNode, QueuedNode> branch_on_suggested() {
     return branch(this->branch_i, this->branch_j);
   }
 
-  const std::list<std::shared_ptr<TriangleInequality>>& get_inequalities() 
-    const {
+  // Returns whether the children of this executed node may beat the lower
+  // bound b, in which case it has a branching pair. Pruned nodes are never
+  // branched on, whatever their upper bound, since their SDP stopped
+  // before choosing a pair.
+  bool can_branch(double b) const { return !pruned && upper_bound > b; }
+
+  // Returns the queue record of this node, before execution.
+  QueuedNode get_record() const;
+
+  int get_depth() const { return depth; }
+
+  const CutList& get_inequalities() const {
     return inequalities;
   }
 
-  const std::list<std::shared_ptr<TriangleInequality>>& get_post_inequalities() 
-    const {
+  void set_inequalities(CutList ineqs) {
+    inequalities = std::move(ineqs);
+  }
+
+  const CutList& get_post_inequalities() const {
     return inequalities_post;
   }
 
-  void set_post_inequalities(std::list<std::shared_ptr<TriangleInequality>> 
-                             ineqs) {
-    inequalities_post = ineqs;
+  void set_post_inequalities(CutList ineqs) {
+    inequalities_post = std::move(ineqs);
   }
 
   const FreezeMap* get_freeze_map() const { return &freezes; }
@@ -63,10 +170,10 @@ class Node
   const Eigen::MatrixXd* get_initial_A() const { return initial_A; }
 
   int get_branch_i() const { return branch_i; }
-  int set_branch_i(int bi) { branch_i = bi; }
+  void set_branch_i(int bi) { branch_i = bi; }
 
   int get_branch_j() const { return branch_j; }
-  int set_branch_j(int bj) { branch_j = bj; }
+  void set_branch_j(int bj) { branch_j = bj; }
 
   double get_upper_bound() const { return upper_bound; }
   void set_upper_bound(double ub) { upper_bound = ub; }
@@ -77,9 +184,72 @@ class Node
   Eigen::VectorXd get_lower_bound_witness() const { return y; }
   void set_lower_bound_witness(const Eigen::VectorXd& lbw) { y = lbw; }
 
+  std::shared_ptr<const SdpWarmStart> get_warm_start() const {
+    return warm_start;
+  }
+  void set_warm_start(std::shared_ptr<const SdpWarmStart> ws) {
+    warm_start = ws;
+  }
+
+  std::shared_ptr<const SdpWarmStart> get_solution() const {
+    return solution;
+  }
+  void set_solution(std::shared_ptr<const SdpWarmStart> s) { solution = s; }
+
+  int get_sdp_iterations() const { return sdp_iterations; }
+  void set_sdp_iterations(int it) { sdp_iterations = it; }
+
+  // Number of this node's SDP solves that started from a warm start, which
+  // is at most one unless the node's statistics cover a dive below it
+  int get_sdp_warm_starts() const { return sdp_warm_starts; }
+  void set_sdp_warm_starts(int n) { sdp_warm_starts = n; }
+
+  bool is_pruned() const { return pruned; }
+  void set_pruned(bool p) { pruned = p; }
+
+  const Eigen::VectorXd& get_inequality_slacks() const {
+    return inequality_slacks;
+  }
+  void set_inequality_slacks(const Eigen::VectorXd& s) {
+    inequality_slacks = s;
+  }
+
+  const Eigen::VectorXd& get_post_inequality_values() const {
+    return post_inequality_values;
+  }
+  void set_post_inequality_values(const Eigen::VectorXd& v) {
+    post_inequality_values = v;
+  }
+
+  const std::vector<CutKey>& get_inequality_sources() const {
+    return inequality_sources;
+  }
+  void set_inequality_sources(const std::vector<CutKey>& s) {
+    inequality_sources = s;
+  }
+
   bool is_executed() const { return executed; }
 
-  void execute(int num_post_ineqs);
+  // Bounds the node with the given SDP solver, followed by cutting-plane
+  // rounds if cutting_planes is not null (see cutting_plane_rounds), rounds
+  // its solution for a lower bound with a tabu search of tabu_budget moves
+  // (see round_tabu), and chooses the branching pair and the num_post_ineqs
+  // inequalities of cut_families passed on to its children. Nodes with at
+  // most leaf_size free variables are instead solved exactly by brute force.
+  // The node is marked pruned, skipping the remaining steps, as soon as its
+  // upper bound cannot beat the incumbent, which is read afresh for each
+  // check. Optionally, laplacian represents the initial matrix and its bit
+  // kernels are used for rounding where they are cheaper, and matrices
+  // caches the transformed matrices, deriving the node's from its parent's.
+  void execute(int num_post_ineqs,
+               const CutFamilies& cut_families,
+               SdpSolver* solver,
+               Incumbent* incumbent,
+               int leaf_size,
+               int tabu_budget,
+               CuttingPlaneTuner* cutting_planes,
+               const BitLaplacian* laplacian,
+               ReducedMatrixCache* matrices);
 };
 
 #endif  // __NODE_H__
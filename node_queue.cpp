@@ -1,37 +1,442 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cut.h"
 #include "node.h"
 #include "node_queue.h"
 
 
-bool NodeQueue::empty() {
-  return (queue.empty() ||
-          queue[0]->get_upper_bound() < lower_bound);
+bool parse_node_selection(const std::string& name, NodeSelection* selection) {
+  if (name == "best-bound") {
+    *selection = NODE_SELECTION_BEST_BOUND;
+  } else if (name == "depth-first") {
+    *selection = NODE_SELECTION_DEPTH_FIRST;
+  } else if (name == "best-estimate") {
+    *selection = NODE_SELECTION_BEST_ESTIMATE;
+  } else if (name == "restarts") {
+    *selection = NODE_SELECTION_RESTARTS;
+  } else if (name == "hybrid") {
+    *selection = NODE_SELECTION_HYBRID;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::string node_selection_name(NodeSelection selection) {
+  switch (selection) {
+  case NODE_SELECTION_BEST_BOUND:
+    return "best-bound";
+  case NODE_SELECTION_DEPTH_FIRST:
+    return "depth-first";
+  case NODE_SELECTION_BEST_ESTIMATE:
+    return "best-estimate";
+  case NODE_SELECTION_RESTARTS:
+    return "restarts";
+  case NODE_SELECTION_HYBRID:
+    return "hybrid";
+  }
+  return "unknown";
+}
+
+bool LessThanBySelection::operator()(const QueuedNode& lhs,
+                                     const QueuedNode& rhs) const {
+  switch (selection) {
+  case NODE_SELECTION_DEPTH_FIRST:
+  case NODE_SELECTION_RESTARTS:
+  case NODE_SELECTION_HYBRID:
+    if (lhs.depth != rhs.depth) {
+      return lhs.depth < rhs.depth;
+    }
+    break;
+  case NODE_SELECTION_BEST_ESTIMATE:
+    // The root has no estimate, but is alone in the queue
+    return (lhs.lower_bound + lhs.upper_bound <
+            rhs.lower_bound + rhs.upper_bound);
+  default:
+    break;
+  }
+  return lhs.upper_bound < rhs.upper_bound;
+}
+
+
+// Header of a spilled record, followed by its size integers as written by
+// QueuedNode_serialize. best_upper_bound is the best upper bound of this
+// record and those after it in its run.
+struct SpillHeader {
+  double upper_bound;
+  double lower_bound;
+  double best_upper_bound;
+  int depth;
+  int size;
+};
+
+// Estimated memory held by a queued node: its record, its link of the path,
+// and half of the inheritance it shares with its sibling.
+static long queued_node_memory(const QueuedNode& node) {
+  long ret = sizeof(QueuedNode) + sizeof(BranchPath);
+  if (node.inheritance) {
+    long shared = sizeof(NodeInheritance) +
+      node.inheritance->inequalities.size() * sizeof(Cut);
+    if (node.inheritance->warm_start) {
+      const SdpWarmStart* ws = node.inheritance->warm_start.get();
+      shared += sizeof(SdpWarmStart) +
+        (ws->V.size() + ws->multipliers.size()) * sizeof(double) +
+        ws->inequalities.size() * sizeof(Cut);
+    }
+    ret += shared / 2;
+  }
+  return ret;
+}
+
+static void check_io(bool ok) {
+  if (!ok) {
+    perror("Node queue spill file");
+    std::exit(1);
+  }
+}
+
+
+NodeQueue::NodeQueue(NodeSelection selection, long memory_budget)
+  : by_max_bound(SlotOrder{&slots,
+                           LessThanBySelection{NODE_SELECTION_BEST_BOUND},
+                           false}),
+    by_min_bound(SlotOrder{&slots,
+                           LessThanBySelection{NODE_SELECTION_BEST_BOUND},
+                           true}),
+    by_selection(SlotOrder{&slots, LessThanBySelection{selection}, false}),
+    lower_bound(-std::numeric_limits<double>::infinity()),
+    selection(selection),
+    saturated(false),
+    num_pops(0),
+    memory_budget(memory_budget),
+    memory_used(0),
+    spilled_upper_bound(-std::numeric_limits<double>::infinity()),
+    spill_file(NULL),
+    num_spilled(0),
+    num_spilled_pruned(0) {
+  order.selection = selection;
+}
+
+NodeQueue::~NodeQueue() {
+  if (spill_file != NULL) {
+    fclose(spill_file);
+  }
+}
+
+void NodeQueue::insert(const QueuedNode& node) {
+  int slot;
+  if (free_slots.empty()) {
+    slot = slots.size();
+    slots.push_back(node);
+  } else {
+    slot = free_slots.back();
+    free_slots.pop_back();
+    slots[slot] = node;
+  }
+  by_max_bound.push(slot);
+  by_min_bound.push(slot);
+  if (selection != NODE_SELECTION_BEST_BOUND) {
+    by_selection.push(slot);
+  }
+  memory_used += queued_node_memory(node);
 }
 
-std::shared_ptr<Node> NodeQueue::pop() {
-  std::pop_heap(queue.begin(), queue.end(), comparator);
-  std::shared_ptr<Node> ret = queue[queue.size() - 1];
-  queue.pop_back();
+QueuedNode NodeQueue::take(int slot) {
+  by_max_bound.remove(slot);
+  by_min_bound.remove(slot);
+  if (selection != NODE_SELECTION_BEST_BOUND) {
+    by_selection.remove(slot);
+  }
+  memory_used -= queued_node_memory(slots[slot]);
+
+  QueuedNode ret = std::move(slots[slot]);
+  slots[slot] = QueuedNode();
+  free_slots.push_back(slot);
   return ret;
 }
 
-bool NodeQueue::push(std::shared_ptr<Node> node) {
-  if (queue.empty() || node->get_upper_bound() > lower_bound) {
-    queue.push_back(node);
-    std::push_heap(queue.begin(), queue.end(), comparator);
+void NodeQueue::prune() {
+  while (!by_min_bound.empty() &&
+         slots[by_min_bound.top()].upper_bound <= lower_bound) {
+    take(by_min_bound.top());
+  }
+  best_run();
+}
+
+void NodeQueue::spill() {
+  if (spill_file == NULL) {
+    spill_file = tmpfile();
+    check_io(spill_file != NULL);
+  }
+
+  // Keep the nodes to be popped first within half of the budget in memory,
+  // and write the rest in the order they would be popped
+  std::vector<bool> is_free(slots.size(), false);
+  for (int slot : free_slots) {
+    is_free[slot] = true;
+  }
+  std::vector<int> order_slots;
+  for (int slot = 0; slot < (int) slots.size(); slot++) {
+    if (!is_free[slot]) {
+      order_slots.push_back(slot);
+    }
+  }
+  std::sort(order_slots.begin(),
+            order_slots.end(),
+            SlotOrder{&slots, order, true});
+  int keep = 1;
+  long kept_memory = queued_node_memory(slots[order_slots[0]]);
+  while (keep < (int) order_slots.size()) {
+    kept_memory += queued_node_memory(slots[order_slots[keep]]);
+    if (kept_memory > memory_budget / 2) {
+      break;
+    }
+    keep++;
+  }
+
+  // Best upper bound from each spilled node to the end of the run
+  std::vector<double> best_upper_bounds(order_slots.size() - keep);
+  double best_upper_bound = -std::numeric_limits<double>::infinity();
+  for (int ix = order_slots.size() - 1; ix >= keep; ix--) {
+    best_upper_bound =
+      std::max(best_upper_bound, slots[order_slots[ix]].upper_bound);
+    best_upper_bounds[ix - keep] = best_upper_bound;
+  }
+
+  check_io(fseek(spill_file, 0, SEEK_END) == 0);
+  Run run;
+  run.next = ftell(spill_file);
+  run.count = order_slots.size() - keep;
+  run.live = run.count;
+  run.num_dominated = 0;
+  for (int ix = keep; ix < (int) order_slots.size(); ix++) {
+    run.upper_bounds.push_back(slots[order_slots[ix]].upper_bound);
+    run.by_upper_bound.push_back(ix - keep);
+  }
+  std::sort(run.by_upper_bound.begin(),
+            run.by_upper_bound.end(),
+            [&run](int a, int b) {
+              return run.upper_bounds[a] < run.upper_bounds[b];
+            });
+
+  std::vector<int> body;
+  for (int ix = keep; ix < (int) order_slots.size(); ix++) {
+    QueuedNode node = take(order_slots[ix]);
+
+    SpillHeader header;
+    header.upper_bound = node.upper_bound;
+    header.lower_bound = node.lower_bound;
+    header.best_upper_bound = best_upper_bounds[ix - keep];
+    header.depth = node.depth;
+    header.size = QueuedNode_int_size(node);
+    if (ix == keep) {
+      run.head.upper_bound = header.upper_bound;
+      run.head.lower_bound = header.lower_bound;
+      run.head.depth = header.depth;
+      run.head_size = header.size;
+      run.best_upper_bound = header.best_upper_bound;
+    }
+
+    body.resize(header.size);
+    QueuedNode_serialize(node, body.data());
+
+    check_io(fwrite(&header, sizeof(header), 1, spill_file) == 1);
+    check_io(fwrite(body.data(), sizeof(int), body.size(), spill_file) ==
+             body.size());
+  }
+  run.end = ftell(spill_file);
+  if (run.count > 0) {
+    num_spilled += run.count;
+    runs.push_back(std::move(run));
+    count_dominated(runs.size() - 1);
+  }
+  update_spilled_upper_bound();
+}
+
+int NodeQueue::best_run(bool by_bound) {
+  int best = -1;
+  for (int r = 0; r < (int) runs.size(); r++) {
+    count_dominated(r);
+    // Unless runs are sorted by bound, a dominated head can precede nodes
+    // that may still beat the lower bound
+    while (runs[r].next < runs[r].end &&
+           runs[r].head.upper_bound <= lower_bound &&
+           runs[r].best_upper_bound > lower_bound) {
+      advance_run(r);
+      num_spilled_pruned++;
+    }
+    if (runs[r].next >= runs[r].end ||
+        runs[r].best_upper_bound <= lower_bound) {
+      num_spilled_pruned += runs[r].count;
+      runs.erase(runs.begin() + r);
+      r--;
+      continue;
+    }
+    if (best == -1 ||
+        (by_bound ?
+         LessThanByUpperBound()(runs[best].head, runs[r].head) :
+         order(runs[best].head, runs[r].head))) {
+      best = r;
+    }
+  }
+
+  // Nothing is left on disk, so start the file over
+  if (runs.empty() && spill_file != NULL) {
+    fclose(spill_file);
+    spill_file = NULL;
+  }
+  update_spilled_upper_bound();
+  return best;
+}
+
+void NodeQueue::update_spilled_upper_bound() {
+  spilled_upper_bound = -std::numeric_limits<double>::infinity();
+  for (const Run& run : runs) {
+    if (run.next < run.end) {
+      spilled_upper_bound = std::max(spilled_upper_bound, run.best_upper_bound);
+    }
+  }
+}
+
+void NodeQueue::count_dominated(int r) {
+  Run& run = runs[r];
+
+  // Records before the next one were already counted out when read
+  long num_read = run.upper_bounds.size() - run.count;
+  while (run.num_dominated < (long) run.by_upper_bound.size() &&
+         run.upper_bounds[run.by_upper_bound[run.num_dominated]] <=
+         lower_bound) {
+    if (run.by_upper_bound[run.num_dominated] >= num_read) {
+      run.live--;
+    }
+    run.num_dominated++;
+  }
+}
+
+void NodeQueue::advance_run(int r) {
+  Run& run = runs[r];
+
+  // Dominated records were counted out when the lower bound was raised
+  if (run.head.upper_bound > lower_bound) {
+    run.live--;
+  }
+  run.next += sizeof(SpillHeader) + run.head_size * sizeof(int);
+  run.count--;
+  if (run.next < run.end) {
+    SpillHeader next;
+    check_io(fseek(spill_file, run.next, SEEK_SET) == 0);
+    check_io(fread(&next, sizeof(next), 1, spill_file) == 1);
+    run.head.upper_bound = next.upper_bound;
+    run.head.lower_bound = next.lower_bound;
+    run.head.depth = next.depth;
+    run.head_size = next.size;
+    run.best_upper_bound = next.best_upper_bound;
+  }
+}
+
+QueuedNode NodeQueue::read_head(int r) {
+  Run& run = runs[r];
+
+  std::vector<int> body(run.head_size);
+  SpillHeader header;
+  check_io(fseek(spill_file, run.next, SEEK_SET) == 0);
+  check_io(fread(&header, sizeof(header), 1, spill_file) == 1);
+  check_io(fread(body.data(), sizeof(int), body.size(), spill_file) ==
+           body.size());
+
+  QueuedNode ret;
+  ret.upper_bound = header.upper_bound;
+  ret.lower_bound = header.lower_bound;
+  ret.depth = header.depth;
+  QueuedNode_deserialize(body.data(), &ret);
+
+  advance_run(r);
+  update_spilled_upper_bound();
+  return ret;
+}
+
+
+bool NodeQueue::empty() {
+  prune();
+  return by_max_bound.empty() && best_run() == -1;
+}
+
+QueuedNode NodeQueue::pop() {
+  num_pops++;
+  bool by_bound =
+    selection == NODE_SELECTION_BEST_BOUND ||
+    (selection == NODE_SELECTION_RESTARTS &&
+     num_pops % NODE_SELECTION_RESTART_PERIOD == 0) ||
+    (selection == NODE_SELECTION_HYBRID && !saturated);
+  return pop_by(by_bound);
+}
+
+QueuedNode NodeQueue::steal() {
+  return pop_by(true);
+}
+
+QueuedNode NodeQueue::pop_by(bool by_bound) {
+  int slot = -1;
+  if (!by_max_bound.empty()) {
+    slot = by_bound ? by_max_bound.top() : by_selection.top();
+  }
+
+  int r = best_run(by_bound);
+  assert(slot != -1 || r != -1);
+  if (r != -1 &&
+      (slot == -1 ||
+       (by_bound ?
+        LessThanByUpperBound()(slots[slot], runs[r].head) :
+        order(slots[slot], runs[r].head)))) {
+    return read_head(r);
+  }
+  return take(slot);
+}
+
+bool NodeQueue::push(const QueuedNode& node) {
+  if (by_max_bound.empty() || node.upper_bound > lower_bound) {
+    insert(node);
+    if (memory_budget > 0 &&
+        memory_used > memory_budget &&
+        by_max_bound.size() > 1) {
+      spill();
+    }
     return true;
   }
   return false;
 }
 
 void NodeQueue::clean() {
-  std::sort_heap(queue.begin(), queue.end(), comparator);
-  std::reverse(queue.begin(), queue.end());
-  int i;
-  for (i = 0; i < queue.size(); i++) {
-    if (queue[i]->get_upper_bound() <= lower_bound) {
-      break;
-    }
+  prune();
+}
+
+int NodeQueue::size() {
+  long ret = slots.size() - free_slots.size();
+  for (const Run& run : runs) {
+    ret += run.live;
   }
-  queue.resize(i);
-  std::make_heap(queue.begin(), queue.end(), comparator);
+  return ret;
+}
+
+bool NodeQueue::aggregate_lower_bound(double b) {
+  if (lower_bound < b) {
+    lower_bound = b;
+    prune();
+    return true;
+  }
+  return false;
+}
+
+double NodeQueue::get_upper_bound() const {
+  double ret = spilled_upper_bound;
+  if (!by_max_bound.empty()) {
+    ret = std::max(ret, slots[by_max_bound.top()].upper_bound);
+  }
+  return ret;
 }
@@ -1,43 +1,218 @@
 // This defines a class that reimplements part of the interface of a priority
-// queue on std::shared_ptr<Node>, but that tracks the best lower bound seen
-// so far and ignores nodes with upper bound smaller than that.
+// queue on the records of queued nodes (see QueuedNode), but that tracks the
+// best lower bound seen so far and ignores nodes that cannot beat it, those
+// with upper bound at most that bound. The order in which nodes are popped
+// is set by a NodeSelection policy.
+//
+// Nodes in memory are indexed by their largest and smallest upper bounds, so
+// that the best upper bound and the gap are known in O(1), and the nodes
+// that can no longer beat a raised lower bound are freed right away.
+//
+// With a memory budget, the queue keeps the nodes to be popped first in
+// memory and spills the rest in runs sorted by the policy's order to an
+// append-only temporary file. Runs are merged back as the heap drains, so
+// that the policy's order holds across spills, and every record stores the
+// best upper bound from it to the end of its run, so that a run is dropped
+// without being read as soon as its remaining nodes cannot beat the lower
+// bound. Pops by upper bound under another policy (steals, and the
+// best-bound pops of restarts and hybrid) only see the head of each run.
+// Spilled nodes keep their path and inherited inequalities, but lose their
+// warm start.
 
 #ifndef __NODE_QUEUE_H__
 #define __NODE_QUEUE_H__
 
+#include <algorithm>
+#include <cstdio>
+#include <limits>
 #include <memory>
+#include <string>
+#include <vector>
+#include "indexed_heap.h"
 #include "node.h"
 
+// Policies for choosing the next node to process:
+//   best-bound: the node with the largest upper bound
+//   depth-first: the deepest node, diving until a node is pruned and then
+//     backtracking to the deepest remaining one, with ties by upper bound
+//   best-estimate: the node with the largest estimate of its best solution,
+//     halfway between its parent's lower bound and its upper bound
+//   restarts: depth-first, but every NODE_SELECTION_RESTART_PERIOD-th node
+//     is chosen by best bound
+//   hybrid: depth-first while all workers are busy (see set_saturated), and
+//     best-bound otherwise
+enum NodeSelection {
+  NODE_SELECTION_BEST_BOUND,
+  NODE_SELECTION_DEPTH_FIRST,
+  NODE_SELECTION_BEST_ESTIMATE,
+  NODE_SELECTION_RESTARTS,
+  NODE_SELECTION_HYBRID
+};
+
+const int NODE_SELECTION_RESTART_PERIOD = 32;
+
+// Parses a policy name ("best-bound", "depth-first", "best-estimate",
+// "restarts" or "hybrid"). Returns false if the name is unknown.
+bool parse_node_selection(const std::string& name, NodeSelection* selection);
+
+// Returns the name of a policy, as accepted by parse_node_selection.
+std::string node_selection_name(NodeSelection selection);
 
 struct LessThanByUpperBound {
-  bool operator()(const std::shared_ptr<Node>& lhs,
-                  const std::shared_ptr<Node>& rhs) const {
-    return lhs->get_upper_bound() < rhs->get_upper_bound();
+  bool operator()(const QueuedNode& lhs, const QueuedNode& rhs) const {
+    return lhs.upper_bound < rhs.upper_bound;
+  }
+};
+
+// Orders nodes so that the one popped first by a policy is the largest,
+// leaving best-bound pops of the restarts and hybrid policies aside.
+struct LessThanBySelection {
+  NodeSelection selection;
+
+  bool operator()(const QueuedNode& lhs, const QueuedNode& rhs) const;
+};
+
+// Orders the slots of a NodeQueue by a LessThanBySelection, or by its reverse.
+struct SlotOrder {
+  const std::vector<QueuedNode>* slots;
+  LessThanBySelection order;
+  bool reverse;
+
+  bool operator()(int a, int b) const {
+    return reverse ?
+      order((*slots)[b], (*slots)[a]) :
+      order((*slots)[a], (*slots)[b]);
   }
 };
 
 class NodeQueue
 {
  private:
-  std::vector<std::shared_ptr<Node>> queue;
+  // Nodes in memory by slot, and the free slots
+  std::vector<QueuedNode> slots;
+  std::vector<int> free_slots;
+  // Slots by largest and by smallest upper bound, so that the best bound is
+  // found in O(1) and dominated nodes are dropped in O(log n) each, and by
+  // the policy's order unless that is best-bound
+  IndexedHeap<SlotOrder> by_max_bound;
+  IndexedHeap<SlotOrder> by_min_bound;
+  IndexedHeap<SlotOrder> by_selection;
   double lower_bound;
 
+  NodeSelection selection;
+  LessThanBySelection order;
+  // Whether all workers were busy at the last dispatch, for the hybrid
+  // policy
+  bool saturated;
+  long num_pops;
+
+  // Budget of the nodes in memory in bytes, or 0 for no limit, and their
+  // estimated size
+  long memory_budget;
+  long memory_used;
+
+  // A sorted run of spilled nodes, from the record at offset next to end,
+  // with the bounds and depth of the record at next, its body size and the
+  // best upper bound from it to the end. count is the number of records
+  // left, and live the number of those that can still beat the lower bound,
+  // which is kept from the upper bound of each record (in run order) and
+  // the records by increasing upper bound, the first num_dominated of which
+  // are at most the lower bound. That is 12 bytes in memory per spilled
+  // node, and each raise of the lower bound takes O(1) amortized per node
+  // it dominates.
+  struct Run {
+    long next;
+    long end;
+    QueuedNode head;
+    int head_size;
+    double best_upper_bound;
+    long count;
+    long live;
+    std::vector<double> upper_bounds;
+    std::vector<int> by_upper_bound;
+    long num_dominated;
+  };
+  std::vector<Run> runs;
+  // Best upper bound of the spilled nodes
+  double spilled_upper_bound;
+  FILE* spill_file;
+  long num_spilled;
+  long num_spilled_pruned;
+
+  void insert(const QueuedNode& node);
+
+  // Removes the node in a slot and returns it.
+  QueuedNode take(int slot);
+
+  // Drops the nodes in memory and the runs that cannot beat the lower bound,
+  // i.e. whose upper bound is at most the lower bound, as push does.
+  void prune();
+
+  // Moves the nodes to be popped last to a new run.
+  void spill();
+
+  // Drops the runs that are exhausted or cannot beat the lower bound, and
+  // the nodes at the heads of the others that cannot, and returns the index
+  // of the run with the best head by upper bound if by_bound is set and by
+  // the policy's order otherwise, or -1 if none is left.
+  int best_run(bool by_bound = false);
+
+  void update_spilled_upper_bound();
+
+  // Counts out of runs[r].live the records left that the lower bound has
+  // come to dominate.
+  void count_dominated(int r);
+
+  // Moves runs[r] past its head, reading the header of the next record.
+  void advance_run(int r);
+
+  // Reads the head of runs[r] and advances the run.
+  QueuedNode read_head(int r);
+
+  // Pops the next node by upper bound if by_bound is set, and by the
+  // policy's order otherwise.
+  QueuedNode pop_by(bool by_bound);
+
  public:
-  static LessThanByUpperBound comparator;
+  NodeQueue(NodeSelection selection = NODE_SELECTION_BEST_BOUND,
+            long memory_budget = 0);
+  ~NodeQueue();
+  NodeQueue(const NodeQueue&) = delete;
+  NodeQueue& operator=(const NodeQueue&) = delete;
 
   bool empty();
-  std::shared_ptr<Node> pop();
-  bool push(std::shared_ptr<Node>);
+  // Pops the next node by the policy. The queue must not be empty.
+  QueuedNode pop();
+  bool push(const QueuedNode& node);
   void clean();
-  int size() { return queue.size(); }
+  // Returns the number of nodes that can still be popped.
+  int size();
+
+  void set_saturated(bool s) { saturated = s; }
+
+  // Pops the node with the largest upper bound whatever the policy, to hand
+  // it to another process. The queue must not be empty.
+  QueuedNode steal();
+
+  // Number of nodes written to disk, and of those dropped there because
+  // they could not beat the lower bound.
+  long get_num_spilled() const { return num_spilled; }
+  long get_num_spilled_pruned() const { return num_spilled_pruned; }
 
   double get_lower_bound() { return lower_bound; }
-  bool aggregate_lower_bound(double b) {
-    if (lower_bound < b) {
-      lower_bound = b;
-      return true;
-    }
-    return false;
+
+  // Raises the lower bound to b if that is larger, dropping the nodes that
+  // can no longer beat it, and returns whether it did.
+  bool aggregate_lower_bound(double b);
+
+  // Returns the best upper bound of the queued nodes, or -infinity if there
+  // are none, in time O(1).
+  double get_upper_bound() const;
+
+  // Returns the gap between the best upper bound of the queued nodes and the
+  // lower bound, or 0 if no queued node can beat it.
+  double get_gap() const {
+    return std::max(0.0, get_upper_bound() - lower_bound);
   }
 };
 
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "freeze_map.h"
+#include "node.h"
+#include "node_worker.h"
+#include "sdp.h"
+
+NodeWorker::NodeWorker(const Eigen::MatrixXd* A,
+                       const McbbOptions& options,
+                       Incumbent* incumbent)
+  : A(A),
+    options(options),
+    incumbent(incumbent),
+    solver(make_sdp_solver(options.sdp_backend,
+                           options.measure_uncached_setup)),
+    leaf_size(options.leaf_size),
+    cutting_planes(options.cut_rounds, options.num_ineqs),
+    laplacian(make_bit_laplacian(*A)),
+    best_lower_bound(-std::numeric_limits<double>::infinity()) {}
+
+void NodeWorker::execute(Node* node) {
+  int N = A->rows();
+  int num_free = N - FreezeMap_num_frozen(node->get_freeze_map());
+
+  // The root is solved to the default tolerance, since its solution
+  // guides the branching of the whole tree
+  if (num_free == N) {
+    solver->set_tolerance(0);
+  } else {
+    solver->set_tolerance(options.sdp_tolerance);
+  }
+
+  int node_leaf_size = leaf_size.get_leaf_size();
+  SdpSolverStats stats_before = solver->get_stats();
+  double execute_start = MPI_Wtime();
+  node->execute(options.num_ineqs,
+                options.cut_families,
+                solver.get(),
+                incumbent,
+                node_leaf_size,
+                options.tabu_iterations,
+                options.cut_rounds > 0 ? &cutting_planes : NULL,
+                laplacian.get(),
+                &matrices);
+  if (num_free <= node_leaf_size) {
+    leaf_size.record(num_free, true, MPI_Wtime() - execute_start);
+  } else if (!node->is_pruned()) {
+    // Only the solver's own time, and only of solves that ran to the end,
+    // measure the cost of an SDP of this size
+    SdpSolverStats stats_after = solver->get_stats();
+    int solves = stats_after.solves - stats_before.solves;
+    if (solves > 0) {
+      double seconds = stats_after.setup_time - stats_before.setup_time +
+        stats_after.solve_time - stats_before.solve_time;
+      leaf_size.record(num_free, false, seconds / solves);
+    }
+  }
+  if (node->get_lower_bound() > best_lower_bound) {
+    best_lower_bound = node->get_lower_bound();
+    best_witness = FreezeMap_expand_vector(node->get_lower_bound_witness(),
+                                           node->get_freeze_map());
+  }
+  incumbent->publish(node->get_lower_bound());
+}
+
+void NodeWorker::dive(Node* root,
+                      std::vector<QueuedNode>* frontier,
+                      int* num_created,
+                      int* num_pruned) {
+  double dive_start = MPI_Wtime();
+  frontier->clear();
+  *num_created = 0;
+  *num_pruned = 0;
+
+  execute(root);
+  if (!options.warm_start) {
+    root->set_solution(std::shared_ptr<const SdpWarmStart>());
+  }
+  if (!root->can_branch(incumbent->get())) {
+    return;
+  }
+
+  double best_lower_bound = root->get_lower_bound();
+  Eigen::VectorXd best_witness;
+  int sdp_iterations = root->get_sdp_iterations();
+  int sdp_warm_starts = root->get_sdp_warm_starts();
+
+  // Nodes to explore, the next one last
+  std::vector<QueuedNode>& stack = *frontier;
+  std::pair<QueuedNode, QueuedNode> children = root->branch_on_suggested();
+  stack.push_back(children.second);
+  stack.push_back(children.first);
+  *num_created += 2;
+
+  int num_explored = 0;
+  while (!stack.empty() &&
+         num_explored < options.dive_nodes &&
+         (options.dive_seconds <= 0 ||
+          MPI_Wtime() - dive_start < options.dive_seconds)) {
+    QueuedNode record = std::move(stack.back());
+    stack.pop_back();
+    if (record.upper_bound <= incumbent->get()) {
+      continue;
+    }
+
+    Node node(A, record);
+    execute(&node);
+    num_explored++;
+    if (!options.warm_start) {
+      node.set_solution(std::shared_ptr<const SdpWarmStart>());
+    }
+    sdp_iterations += node.get_sdp_iterations();
+    sdp_warm_starts += node.get_sdp_warm_starts();
+    if (node.is_pruned()) {
+      (*num_pruned)++;
+    }
+    if (node.get_lower_bound() > best_lower_bound) {
+      best_lower_bound = node.get_lower_bound();
+      best_witness = FreezeMap_expand_vector(node.get_lower_bound_witness(),
+                                             node.get_freeze_map());
+    }
+
+    if (node.can_branch(incumbent->get())) {
+      children = node.branch_on_suggested();
+      stack.push_back(children.second);
+      stack.push_back(children.first);
+      *num_created += 2;
+    }
+  }
+
+  // The frontier only needs the decisions and inequalities, and its warm
+  // starts are not sent
+  double bound = incumbent->get();
+  stack.erase(std::remove_if(stack.begin(),
+                             stack.end(),
+                             [bound](const QueuedNode& record) {
+                               return record.upper_bound <= bound;
+                             }),
+              stack.end());
+
+  // A witness found below root is consistent with its freezes, so its
+  // restriction to root's keys expands back to it
+  if (best_witness.size() > 0) {
+    root->set_lower_bound(best_lower_bound);
+    root->set_lower_bound_witness(
+      FreezeMap_restrict_rows(best_witness, root->get_freeze_map()));
+  }
+  root->set_sdp_iterations(sdp_iterations);
+  root->set_sdp_warm_starts(sdp_warm_starts);
+}
@@ -0,0 +1,66 @@
+// Implements the solver state a process keeps across the nodes it executes:
+// its SDP solver, leaf size and cutting-plane tuners, bit-packed Laplacian
+// and reduced matrix cache, with which every mode of mcbb executes a node or
+// dives below it.
+
+#ifndef __NODE_WORKER_H__
+#define __NODE_WORKER_H__
+
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+#include "bit_laplacian.h"
+#include "brute_force.h"
+#include "cutting_plane.h"
+#include "incumbent.h"
+#include "mcbb_options.h"
+#include "node.h"
+#include "reduced_matrix_cache.h"
+#include "sdp.h"
+
+// Solver state kept by a process across the nodes it executes.
+class NodeWorker
+{
+ private:
+  const Eigen::MatrixXd* A;
+  const McbbOptions& options;
+  Incumbent* incumbent;
+  std::shared_ptr<SdpSolver> solver;
+  LeafSizeTuner leaf_size;
+  CuttingPlaneTuner cutting_planes;
+  std::shared_ptr<const BitLaplacian> laplacian;
+  ReducedMatrixCache matrices;
+  // Best lower bound found by this process and its witness on all N
+  // indices, which the root fetches at the end if this process holds the
+  // incumbent
+  double best_lower_bound;
+  Eigen::VectorXd best_witness;
+
+ public:
+  NodeWorker(const Eigen::MatrixXd* A,
+             const McbbOptions& options,
+             Incumbent* incumbent);
+
+  // Executes a node and publishes its lower bound.
+  void execute(Node* node);
+
+  // Executes root, then explores its subtree depth-first within the budget
+  // of options.dive_nodes and options.dive_seconds, skipping the nodes that
+  // cannot beat the incumbent. The best lower bound and witness found, and
+  // the SDP iterations and warm starts of the whole dive, are set on root.
+  // Without options.warm_start, no node of the dive, root included, passes
+  // its solution on to its children.
+  // The records of the nodes left unexplored are stored in frontier, along
+  // with the number of nodes created below root and of those pruned during
+  // their SDP.
+  void dive(Node* root,
+            std::vector<QueuedNode>* frontier,
+            int* num_created,
+            int* num_pruned);
+
+  SdpSolverStats get_stats() const { return solver->get_stats(); }
+
+  const Eigen::VectorXd& get_best_witness() const { return best_witness; }
+};
+
+#endif  // __NODE_WORKER_H__
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <utility>
+#include <vector>
+#include <Eigen/Dense>
+#include "cut.h"
+#include "odd_cycle.h"
+
+// Finds a closed walk of weight less than 1 from (s, 0) to (s, 1) among the n
+// variables with weights X as in odd_cycle.h, by Dijkstra's algorithm on the
+// dense graph of pairs. Writes its vertices (starting and ending at s) and
+// the signs of its edges, and returns false if there is none.
+static bool shortest_odd_walk(const Eigen::MatrixXd& X,
+                              int s,
+                              std::vector<double>& dist,
+                              std::vector<int>& pred,
+                              std::vector<char>& done,
+                              std::vector<int>& walk,
+                              std::vector<int>& signs) {
+  int n = X.rows();
+
+  std::fill(dist.begin(), dist.end(), std::numeric_limits<double>::infinity());
+  std::fill(done.begin(), done.end(), 0);
+  dist[2 * s] = 0;
+  pred[2 * s] = -1;
+
+  int target = 2 * s + 1;
+  while (true) {
+    int node = -1;
+    for (int v = 0; v < 2 * n; v++) {
+      if (!done[v] && (node == -1 || dist[v] < dist[node])) {
+        node = v;
+      }
+    }
+    if (node == -1 || dist[node] >= 1.0) {
+      return false;
+    }
+    if (node == target) {
+      break;
+    }
+    done[node] = 1;
+
+    int u = node / 2;
+    int parity = node % 2;
+    const double* X_u = X.data() + (long) u * n;
+    for (int w = 0; w < n; w++) {
+      if (w == u) {
+        continue;
+      }
+      double neg = std::max(0.0, 0.5 * (1 - X_u[w]));
+      double pos = std::max(0.0, 0.5 * (1 + X_u[w]));
+      int same = 2 * w + parity;
+      int flip = 2 * w + 1 - parity;
+      if (!done[same] && dist[node] + neg < dist[same]) {
+        dist[same] = dist[node] + neg;
+        pred[same] = node;
+      }
+      if (!done[flip] && dist[node] + pos < dist[flip]) {
+        dist[flip] = dist[node] + pos;
+        pred[flip] = node;
+      }
+    }
+  }
+
+  walk.clear();
+  signs.clear();
+  for (int node = target; node != -1; node = pred[node]) {
+    walk.push_back(node / 2);
+    if (pred[node] != -1) {
+      signs.push_back(pred[node] % 2 != node % 2 ? 1 : -1);
+    }
+  }
+  std::reverse(walk.begin(), walk.end());
+  std::reverse(signs.begin(), signs.end());
+  return true;
+}
+
+// Reduces a closed walk with an odd number of +1 edges to a cycle with the
+// same property, by splitting it at repeated vertices and keeping the odd
+// part. Since weights are nonnegative, the cycle weighs at most the walk.
+static void walk_to_cycle(std::vector<int>& walk, std::vector<int>& signs) {
+  while (true) {
+    int L = signs.size();
+    int p = -1;
+    int q = -1;
+    for (int b = 1; b < L && p == -1; b++) {
+      for (int a = 0; a < b; a++) {
+        if (walk[a] == walk[b]) {
+          p = a;
+          q = b;
+          break;
+        }
+      }
+    }
+    if (p == -1) {
+      break;
+    }
+
+    int inner_positive = 0;
+    for (int t = p; t < q; t++) {
+      inner_positive += signs[t] > 0;
+    }
+
+    if (inner_positive % 2 == 1) {
+      walk = std::vector<int>(walk.begin() + p, walk.begin() + q + 1);
+      signs = std::vector<int>(signs.begin() + p, signs.begin() + q);
+    } else {
+      walk.erase(walk.begin() + p, walk.begin() + q);
+      signs.erase(signs.begin() + p, signs.begin() + q);
+    }
+  }
+}
+
+void choose_odd_cycles(const Eigen::MatrixXd& X,
+                       const std::set<int>& avoid_ixs,
+                       int min_length,
+                       int M,
+                       CutList& cuts) {
+  int N = X.rows();
+
+  cuts.clear();
+  if (M <= 0) {
+    return;
+  }
+
+  std::vector<int> ixs;
+  for (int i = 0; i < N; i++) {
+    if (avoid_ixs.find(i) == avoid_ixs.end()) {
+      ixs.push_back(i);
+    }
+  }
+  int n = ixs.size();
+  Eigen::MatrixXd Xa(n, n);
+  for (int b = 0; b < n; b++) {
+    for (int a = 0; a < n; a++) {
+      Xa(a, b) = X(ixs[a], ixs[b]);
+    }
+  }
+
+  // (value, key) of the cycle found from each source, or a value of +inf
+  std::vector<std::pair<double, CutKey>> found(n);
+
+#pragma omp parallel if (n >= ODD_CYCLE_PARALLEL_MIN)
+  {
+    std::vector<double> dist(2 * n);
+    std::vector<int> pred(2 * n);
+    std::vector<char> done(2 * n);
+    std::vector<int> walk;
+    std::vector<int> signs;
+
+#pragma omp for schedule(dynamic)
+    for (int s = 0; s < n; s++) {
+      found[s].first = std::numeric_limits<double>::infinity();
+      if (!shortest_odd_walk(Xa, s, dist, pred, done, walk, signs)) {
+        continue;
+      }
+      walk_to_cycle(walk, signs);
+
+      int length = signs.size();
+      if (length < min_length || length > CUT_MAX_VERTICES) {
+        continue;
+      }
+      for (int t = 0; t < length; t++) {
+        walk[t] = ixs[walk[t]];
+      }
+      Cut cut = Cut::odd_cycle(length, walk.data(), signs.data());
+      double value = cut.eval(X);
+      if (value < -ODD_CYCLE_MIN_VIOLATION) {
+        found[s] = std::make_pair(value, cut.get_key());
+      }
+    }
+  }
+
+  // Different sources can find the same cycle
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+  while (!found.empty() && found.back().first > 0) {
+    found.pop_back();
+  }
+  if ((int) found.size() > M) {
+    found.resize(M);
+  }
+
+  // Report from least to most violated
+  for (std::vector<std::pair<double, CutKey>>::const_reverse_iterator it =
+         found.rbegin();
+       it != found.rend();
+       ++it) {
+    cuts.push_back(Cut(it->second.data()));
+  }
+}
@@ -0,0 +1,32 @@
+// Implements the separation of odd-cycle inequalities (see cut.h), following
+// Barahona and Mahjoub. Writing the inequality as
+// sum_t (1 + s_t X_{v_t v_{t+1}}) / 2 >= 1, a violated one is a closed walk
+// of weight less than 1 with an odd number of +1 edges, in the complete graph
+// where an edge {u, w} weighs (1 + X_uw) / 2 with sign +1 and (1 - X_uw) / 2
+// with sign -1. These are found by shortest paths from (v, 0) to (v, 1) in
+// the graph on pairs (vertex, parity of the number of +1 edges so far).
+
+#ifndef __ODD_CYCLE_H__
+#define __ODD_CYCLE_H__
+
+#include <set>
+#include <Eigen/Dense>
+#include "cut.h"
+
+// Cycles are kept if X violates them by more than this.
+const double ODD_CYCLE_MIN_VIOLATION = 1e-6;
+
+// Separation is split across OpenMP threads from this many variables.
+const int ODD_CYCLE_PARALLEL_MIN = 32;
+
+// Chooses up to M odd-cycle inequalities violated by X, on cycles of
+// min_length to CUT_MAX_VERTICES variables not in avoid_ixs, and writes them
+// to cuts, in the indices of X, from least to most violated. At most one
+// cycle is found through each variable.
+void choose_odd_cycles(const Eigen::MatrixXd& X,
+                       const std::set<int>& avoid_ixs,
+                       int min_length,
+                       int M,
+                       CutList& cuts);
+
+#endif  // __ODD_CYCLE_H__
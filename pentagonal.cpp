@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <utility>
+#include <vector>
+#include <Eigen/Dense>
+#include "cut.h"
+#include "freeze_map.h"
+#include "pentagonal.h"
+#include "triangle_inequality.h"
+
+void choose_pentagonal_ineqs(const Eigen::MatrixXd& X,
+                             const std::set<int>& avoid_ixs,
+                             int M,
+                             CutList& cuts) {
+  int N = X.rows();
+
+  cuts.clear();
+  if (M <= 0) {
+    return;
+  }
+
+  FreezeMap identity(N);
+  CutList seeds;
+  choose_best_ineqs(X, identity, avoid_ixs, M, seeds);
+
+  std::vector<std::pair<double, CutKey>> found;
+  std::vector<double> sums(N);
+  for (const Cut& seed : seeds) {
+    int v[5];
+    int b[5];
+    for (int t = 0; t < 3; t++) {
+      v[t] = seed.get_vertex(t);
+      b[t] = seed.get_sign(t);
+    }
+
+    // sums[l] = sum_t b_t X_{v_t l} over the points so far; adding l with
+    // sign -sign(sums[l]) decreases the left hand side by |sums[l]|
+    for (int l = 0; l < N; l++) {
+      sums[l] = b[0] * X(v[0], l) + b[1] * X(v[1], l) + b[2] * X(v[2], l);
+    }
+    bool complete = true;
+    for (int t = 3; t < 5 && complete; t++) {
+      int best = -1;
+      for (int l = 0; l < N; l++) {
+        if (avoid_ixs.count(l) != 0 || std::find(v, v + t, l) != v + t) {
+          continue;
+        }
+        if (best == -1 || std::abs(sums[l]) > std::abs(sums[best])) {
+          best = l;
+        }
+      }
+      if (best == -1) {
+        complete = false;
+        break;
+      }
+      v[t] = best;
+      b[t] = sums[best] > 0 ? -1 : 1;
+      for (int l = 0; l < N; l++) {
+        sums[l] += b[t] * X(best, l);
+      }
+    }
+    if (!complete) {
+      continue;
+    }
+
+    Cut cut = Cut::hypermetric(5, v, b);
+    double value = cut.eval(X);
+    if (value < -PENTAGONAL_MIN_VIOLATION) {
+      found.push_back(std::make_pair(value, cut.get_key()));
+    }
+  }
+
+  // Different seeds can grow to the same inequality
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+  if ((int) found.size() > M) {
+    found.resize(M);
+  }
+
+  // Report from least to most violated
+  for (std::vector<std::pair<double, CutKey>>::const_reverse_iterator it =
+         found.rbegin();
+       it != found.rend();
+       ++it) {
+    cuts.push_back(Cut(it->second.data()));
+  }
+}
@@ -0,0 +1,25 @@
+// Implements a heuristic separation of pentagonal inequalities, the
+// hypermetric inequalities on five points (see cut.h). Exact separation would
+// take time O(n^5), so each of the most violated triangle inequalities is
+// instead extended greedily by the two points that most decrease its left
+// hand side.
+
+#ifndef __PENTAGONAL_H__
+#define __PENTAGONAL_H__
+
+#include <set>
+#include <Eigen/Dense>
+#include "cut.h"
+
+// Inequalities are kept if X violates them by more than this.
+const double PENTAGONAL_MIN_VIOLATION = 1e-6;
+
+// Chooses up to M pentagonal inequalities violated by X among the variables
+// not in avoid_ixs, grown from the M most violated triangle inequalities, and
+// writes them to cuts, in the indices of X, from least to most violated.
+void choose_pentagonal_ineqs(const Eigen::MatrixXd& X,
+                             const std::set<int>& avoid_ixs,
+                             int M,
+                             CutList& cuts);
+
+#endif  // __PENTAGONAL_H__
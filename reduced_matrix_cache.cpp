@@ -0,0 +1,41 @@
+#include <deque>
+#include <utility>
+#include <vector>
+#include <Eigen/Dense>
+#include "freeze_map.h"
+#include "reduced_matrix_cache.h"
+
+ReducedMatrixCache::ReducedMatrixCache(int capacity) {
+  this->capacity = capacity;
+  num_folded = 0;
+  num_rebuilt = 0;
+}
+
+Eigen::MatrixXd ReducedMatrixCache::get(const Eigen::MatrixXd& A,
+                                        const FreezeMap* f) {
+  Eigen::MatrixXd ret;
+  bool found = false;
+  for (const std::pair<FreezeMap, Eigen::MatrixXd>& entry : entries) {
+    int i, j, s;
+    if (FreezeMap_find_branch(&entry.first, f, &i, &j, &s)) {
+      std::vector<int> key_to_ix(f->get_num_indices());
+      entry.first.get_key_indices(key_to_ix.data());
+      ret = FreezeMap_fold_matrix(entry.second, key_to_ix[i], key_to_ix[j], s);
+      num_folded++;
+      found = true;
+      break;
+    }
+  }
+  if (!found) {
+    ret = FreezeMap_transform_matrix(A, f);
+    num_rebuilt++;
+  }
+
+  if (capacity > 0) {
+    if ((int) entries.size() >= capacity) {
+      entries.pop_back();
+    }
+    entries.push_front(std::make_pair(*f, ret));
+  }
+  return ret;
+}
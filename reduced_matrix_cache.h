@@ -0,0 +1,38 @@
+// Implements a cache of the transformed matrices of the nodes most recently
+// executed by a process (see FreezeMap_transform_matrix). A child differs
+// from its parent by freezing one key to another, so when the parent's
+// matrix is cached the child's is found by folding one row and column into
+// another instead of being rebuilt from the original matrix.
+
+#ifndef __REDUCED_MATRIX_CACHE_H__
+#define __REDUCED_MATRIX_CACHE_H__
+
+#include <deque>
+#include <utility>
+#include <Eigen/Dense>
+#include "freeze_map.h"
+
+// Default number of matrices kept, from most to least recently used.
+const int REDUCED_MATRIX_CACHE_SIZE = 4;
+
+class ReducedMatrixCache
+{
+ private:
+  int capacity;
+  std::deque<std::pair<FreezeMap, Eigen::MatrixXd>> entries;
+  long num_folded;
+  long num_rebuilt;
+
+ public:
+  ReducedMatrixCache(int capacity = REDUCED_MATRIX_CACHE_SIZE);
+
+  // Returns FreezeMap_transform_matrix(A, f), and caches it. A must be the
+  // same for every call.
+  Eigen::MatrixXd get(const Eigen::MatrixXd& A, const FreezeMap* f);
+
+  // Number of matrices derived from a cached one, and built from A.
+  long get_num_folded() const { return num_folded; }
+  long get_num_rebuilt() const { return num_rebuilt; }
+};
+
+#endif  // __REDUCED_MATRIX_CACHE_H__
@@ -1,78 +1,206 @@
-#include <random>
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
 #include <Eigen/Dense>
 #include "round.h"
 
 
-void round_gw(const Eigen::MatrixXd& Y,
-              Eigen::VectorXd& y) {
+void round_factor(const Eigen::MatrixXd& Y, Eigen::MatrixXd& V) {
   int N = Y.rows();
 
-  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(Y);
-  Eigen::MatrixXd gram_vector_cols =
-    solver.eigenvectors() *
-    solver.eigenvalues().cwiseSqrt().asDiagonal();
+  // Pivoted Cholesky, stopping once the residual diagonal is negligible, so
+  // that a Y of rank r costs O(N r^2)
+  Eigen::VectorXd d = Y.diagonal();
+  V.resize(N, N);
+  int r = 0;
+  while (r < N) {
+    int p;
+    double pivot = d.maxCoeff(&p);
+    if (pivot <= ROUND_FACTOR_TOLERANCE) {
+      break;
+    }
+
+    V.col(r) = Y.col(p) - V.leftCols(r) * V.row(p).head(r).transpose();
+    V.col(r) /= std::sqrt(pivot);
+    d -= V.col(r).cwiseAbs2();
+    d(p) = 0;
+    r++;
+  }
+  V.conservativeResize(N, r);
+}
 
-  std::default_random_engine generator;
+void round_gw(const Eigen::MatrixXd& V,
+              int K,
+              std::mt19937& generator,
+              Eigen::MatrixXd& candidates) {
   std::normal_distribution<double> distribution;
-  auto gaussian = [&] (int) {return distribution(generator);};
+  auto gaussian = [&] (int, int) {return distribution(generator);};
+
+  candidates =
+    (V * Eigen::MatrixXd::NullaryExpr(V.cols(), K, gaussian)).cwiseSign();
+
+  // A zero inner product with the hyperplane can be put on either side
+  candidates = (candidates.array() == 0).select(1.0, candidates);
+}
+
+// Flips y(i) and updates g = Ay accordingly. Returns the index of the best
+// flip from the new point among those with allowed[j] (all if null), and
+// writes its gain to best_gain, or returns -1 if there is none.
+static int flip_and_find_best(const Eigen::MatrixXd& A,
+                              int i,
+                              Eigen::VectorXd& y,
+                              Eigen::VectorXd& g,
+                              const std::vector<char>* allowed,
+                              double& best_gain) {
+  int N = A.rows();
+
+  double* g_data = g.data();
+  const double* y_data = y.data();
+
+  if (i >= 0) {
+    double step = -2.0 * y(i);
+    const double* A_col = A.data() + (long) i * N;
+    for (int j = 0; j < N; j++) {
+      g_data[j] += step * A_col[j];
+    }
+    y(i) = -y(i);
+  }
 
-  y =
-    (gram_vector_cols * Eigen::VectorXd::NullaryExpr(N, gaussian))
-    .cwiseSign();
+  // Flipping y(j) changes y'Ay by 4 (A_jj - y_j (Ay)_j)
+  int best = -1;
+  best_gain = -std::numeric_limits<double>::infinity();
+  for (int j = 0; j < N; j++) {
+    if (allowed != NULL && !(*allowed)[j]) {
+      continue;
+    }
+    double gain = 4.0 * (A(j, j) - y_data[j] * g_data[j]);
+    if (gain > best_gain) {
+      best_gain = gain;
+      best = j;
+    }
+  }
+
+  return best;
 }
 
 void round_local(const Eigen::MatrixXd& A, Eigen::VectorXd& y) {
+  // Every flip changes every entry of Ay for a dense A, so a heap of gains
+  // would cost O(N log N) per flip; a fused O(N) scan is cheaper
+  Eigen::VectorXd g = A * y;
+
+  double gain;
+  int best = flip_and_find_best(A, -1, y, g, NULL, gain);
+  while (best >= 0 && gain > ROUND_LOCAL_THRESHOLD) {
+    best = flip_and_find_best(A, best, y, g, NULL, gain);
+  }
+}
+
+void round_tabu(const Eigen::MatrixXd& A, Eigen::VectorXd& y, int budget) {
   int N = A.rows();
+  if (N < 2 || budget <= 0) {
+    return;
+  }
 
-  double current_value = y.transpose() * A * y;
-  double prev_value = -1e10;
-
-  int i = 0;
-
-  // While an improvement is achieved
-  while (current_value >= prev_value + ROUND_LOCAL_THRESHOLD) {
-    for (int i = 0; i < N; i++) {
-      // Calculate effect of flipping y(i)
-      double diff =
-        4.0 * (-copysign(1.0, y(i)) * y.dot(A.col(i)) + A(i, i));
-      // Apply if positive
-      if (diff > 0) {
-        y(i) *= -1;
-        current_value += diff;
-      }
+  int tenure = std::max(ROUND_TABU_MIN_TENURE, N / ROUND_TABU_TENURE_DIVISOR);
+  tenure = std::min(tenure, N - 1);
+
+  Eigen::VectorXd g = A * y;
+  double value = y.dot(g);
+  double best_value = value;
+  Eigen::VectorXd best_y = y;
+
+  // Moves after which each variable may be flipped again
+  std::vector<int> tabu_until(N, 0);
+  std::vector<char> allowed(N, 1);
+
+  double gain;
+  int move = flip_and_find_best(A, -1, y, g, &allowed, gain);
+  for (int it = 0; it < budget && move >= 0; it++) {
+    value += gain;
+    tabu_until[move] = it + tenure;
+
+    if (value > best_value + ROUND_LOCAL_THRESHOLD) {
+      best_value = value;
+      best_y = y;
+      best_y(move) = -best_y(move);
+    }
+
+    for (int j = 0; j < N; j++) {
+      allowed[j] = tabu_until[j] <= it;
     }
-    prev_value = current_value;
-    current_value = y.transpose() * A * y;
+    move = flip_and_find_best(A, move, y, g, &allowed, gain);
   }
+
+  y = best_y;
 }
 
 void round_iter(const Eigen::MatrixXd& A,
                 const Eigen::MatrixXd& Y,
                 Eigen::VectorXd& y,
-                double alpha) {
+                double alpha,
+                const BitLaplacianView* bits,
+                int tabu_budget,
+                unsigned seed) {
   int N = A.rows();
+  int K = ROUND_NUM_HYPERPLANES;
+
+  std::mt19937 generator(seed);
 
-  Eigen::MatrixXd Y_mod = Y;
-  Eigen::VectorXd previous_y = Eigen::VectorXd(N);
+  // Y_mod = (1 - alpha) Y_mod + alpha y y' is kept as the factor
+  // V = [sqrt(1 - alpha) V, sqrt(alpha) y], which grows by a column per
+  // iteration instead of being factored again
+  Eigen::MatrixXd V;
+  round_factor(Y, V);
 
-  y = Eigen::VectorXd(N);
+  Eigen::MatrixXd candidates;
+  std::vector<double> values(K);
 
-  round_gw(Y_mod, y);
+  round_gw(V, K, generator, candidates);
+  for (int k = 0; k < K; k++) {
+    values[k] = bits ? bits->value(candidates.col(k)) :
+      candidates.col(k).dot(A * candidates.col(k));
+  }
+  int best = std::max_element(values.begin(), values.end()) - values.begin();
+
+  y = candidates.col(best);
+  Eigen::VectorXd previous_y = y;
   double previous_obj = -std::numeric_limits<double>::infinity();
-  double obj = y.dot(A * y);
+  double obj = values[best];
 
   while (obj > previous_obj) {
     previous_y = y;
 
-    Y_mod = (1 - alpha) * Y_mod + alpha * y * y.transpose();
-    round_gw(Y_mod, y);
-    round_local(A, y);
+    V.conservativeResize(N, V.cols() + 1);
+    V.leftCols(V.cols() - 1) *= std::sqrt(1 - alpha);
+    V.col(V.cols() - 1) = std::sqrt(alpha) * y;
+
+    round_gw(V, K, generator, candidates);
+
+#pragma omp parallel for schedule(dynamic) if (N >= ROUND_PARALLEL_MIN)
+    for (int k = 0; k < K; k++) {
+      Eigen::VectorXd candidate = candidates.col(k);
+      if (bits) {
+        values[k] = bits->local_search(candidate);
+      } else {
+        round_local(A, candidate);
+        values[k] = candidate.dot(A * candidate);
+      }
+      candidates.col(k) = candidate;
+    }
+
+    // Ties go to the lowest candidate, so that results do not depend on the
+    // number of threads
+    best = std::max_element(values.begin(), values.end()) - values.begin();
+    y = candidates.col(best);
 
     previous_obj = obj;
-    obj = y.dot(A * y);
+    obj = values[best];
   }
 
   // `previous_y` is the last iteration that made an improvement
   y = previous_y;
+
+  round_tabu(A, y, tabu_budget);
 }
@@ -1,17 +1,58 @@
+#include <random>
 #include <Eigen/Dense>
+#include "bit_laplacian.h"
 
 // Threshold for improvement in local rounding search.
 const double ROUND_LOCAL_THRESHOLD = 1e-6;
 
-// Performs the Goemans-Williamson random hyperplane rounding.
-void round_gw(const Eigen::MatrixXd& Y, Eigen::VectorXd& y);
+// Minimum number of moves for which a flipped variable stays tabu.
+const int ROUND_TABU_MIN_TENURE = 5;
 
-// Does a greedy search for a local maximum of y'Ay.
+// The tabu tenure grows as N / ROUND_TABU_TENURE_DIVISOR for larger N.
+const int ROUND_TABU_TENURE_DIVISOR = 10;
+
+// Residual diagonal below which round_factor stops adding columns.
+const double ROUND_FACTOR_TOLERANCE = 1e-8;
+
+// Number of random hyperplanes drawn per rounding iteration.
+const int ROUND_NUM_HYPERPLANES = 8;
+
+// Candidates are searched in parallel from this many variables.
+const int ROUND_PARALLEL_MIN = 64;
+
+// Writes a factor V with Y = VV', for PSD Y, with as many columns as the
+// numerical rank of Y.
+void round_factor(const Eigen::MatrixXd& Y, Eigen::MatrixXd& V);
+
+// Performs the Goemans-Williamson random hyperplane rounding of the Gram
+// matrix VV' with K hyperplanes at once, writing the sign vectors to the
+// columns of candidates.
+void round_gw(const Eigen::MatrixXd& V,
+              int K,
+              std::mt19937& generator,
+              Eigen::MatrixXd& candidates);
+
+// Does a greedy search for a local maximum of y'Ay, taking the best single
+// flip at each step. The products g = Ay are kept up to date in O(N) per
+// flip, and the best flip is found in the same pass.
 void round_local(const Eigen::MatrixXd& A, Eigen::VectorXd& y);
 
+// Continues from a local maximum with a tabu search of `budget` moves: each
+// move takes the best flip of a variable that was not flipped in the last
+// few moves, even if it decreases y'Ay, which lets the search leave local
+// maxima. y is set to the best point visited.
+void round_tabu(const Eigen::MatrixXd& A, Eigen::VectorXd& y, int budget);
+
 // Iterates the Goemans-Williamson rounding, greedy search, and adjustment
-// of the pseudomoment matrix.
+// of the pseudomoment matrix, and finishes with a tabu search of
+// tabu_budget moves from the best point found (none if 0). Each iteration
+// keeps the best of ROUND_NUM_HYPERPLANES candidates, drawn from a generator
+// seeded with seed. If bits is not null, it must represent A, and is used
+// for the greedy search and objective evaluations.
 void round_iter(const Eigen::MatrixXd& A,
                 const Eigen::MatrixXd& Y,
                 Eigen::VectorXd& y,
-                double alpha);
+                double alpha,
+                const BitLaplacianView* bits,
+                int tabu_budget,
+                unsigned seed);
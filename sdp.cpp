@@ -1,39 +1,241 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
 #include <Eigen/Dense>
+#ifndef MCBB_NO_MOSEK
 #include "fusion.h"
+#endif
+#include "eigen_util.h"
 #include "sdp.h"
+#include "sdp_low_rank.h"
+#include "sdp_mosek_cached.h"
 
-void sdp(const Eigen::MatrixXd& A,
-         const std::list<std::shared_ptr<TriangleInequality>>& inequalities,
-         Eigen::MatrixXd& X) {
+double sdp_certify_upper_bound(
+    const Eigen::MatrixXd& A,
+    const CutList& inequalities,
+    const Eigen::VectorXd& multipliers,
+    const Eigen::VectorXd& y) {
   int N = A.rows();
 
+  Eigen::MatrixXd G = A;
+  double rhs_sum = 0;
+  int a[CUT_MAX_TERMS];
+  int b[CUT_MAX_TERMS];
+  double coef[CUT_MAX_TERMS];
+  int t = 0;
+  for (const Cut& ineq : inequalities) {
+    double mu = std::max(0.0, multipliers(t));
+    rhs_sum += mu * ineq.get_rhs();
+    int num_terms = ineq.get_terms(a, b, coef);
+    for (int u = 0; u < num_terms; u++) {
+      G(a[u], b[u]) += 0.5 * mu * coef[u];
+      G(b[u], a[u]) += 0.5 * mu * coef[u];
+    }
+    t++;
+  }
+  G.diagonal() -= y;
+
+  if (!G.allFinite()) {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  return y.sum() - rhs_sum + N * max_eigenvalue_upper_bound(G);
+}
+
+#ifndef MCBB_NO_MOSEK
+mosek::fusion::Model::t sdp_mosek_model(
+    int N,
+    const CutList& inequalities,
+    mosek::fusion::Variable::t& X_var,
+    mosek::fusion::Constraint::t& diag_con,
+    std::vector<mosek::fusion::Constraint::t>& ineq_cons) {
   mosek::fusion::Model::t model = new mosek::fusion::Model();
 
-  mosek::fusion::Variable::t X_var =
-    model->variable("X", mosek::fusion::Domain::inPSDCone(N));
-  model->constraint(X_var->diag(), mosek::fusion::Domain::equalsTo(1.0));
+  X_var = model->variable("X", mosek::fusion::Domain::inPSDCone(N));
+  diag_con =
+    model->constraint(X_var->diag(), mosek::fusion::Domain::equalsTo(1.0));
 
-  for (const std::shared_ptr<TriangleInequality>& ineq : inequalities) {
-    ineq->add_to_model(model, X_var);
+  ineq_cons.clear();
+  for (const Cut& ineq : inequalities) {
+    ineq_cons.push_back(ineq.add_to_model(model, X_var));
   }
 
+  return model;
+}
+
+mosek::fusion::Matrix::t sdp_mosek_matrix(const Eigen::MatrixXd& A) {
+  int N = A.rows();
+
   double* A_ptr = new double[N * N];
   Eigen::Map<Eigen::MatrixXd>(A_ptr, A.rows(), A.cols()) = A;
   std::shared_ptr<monty::ndarray<double, 1>>
     A_monty_ptr(new monty::ndarray<double, 1>(A_ptr, monty::shape(N * N)));
-  mosek::fusion::Matrix::t A_mat =
-    mosek::fusion::Matrix::dense(N, N, A_monty_ptr);
+
+  return mosek::fusion::Matrix::dense(N, N, A_monty_ptr);
+}
+
+bool sdp_mosek_solve(
+    mosek::fusion::Model::t model,
+    mosek::fusion::Variable::t X_var,
+    mosek::fusion::Constraint::t diag_con,
+    const std::vector<mosek::fusion::Constraint::t>& ineq_cons,
+    const CutList& inequalities,
+    const Eigen::MatrixXd& A,
+    double tolerance,
+    double cutoff,
+    Eigen::MatrixXd& X,
+    double& upper_bound) {
+  int N = A.rows();
+  int K = ineq_cons.size();
+
+  double mosek_tolerance = tolerance > 0 ? tolerance : MOSEK_DEFAULT_TOLERANCE;
+  model->setSolverParam("intpntCoTolRelGap", mosek_tolerance);
+  model->setSolverParam("intpntCoTolPfeas", mosek_tolerance);
+  model->setSolverParam("intpntCoTolDfeas", mosek_tolerance);
+  // MOSEK treats cuts below -5e29 as infinite
+  model->setSolverParam("lowerObjCut", std::max(cutoff, -1e30));
+
+  // The bound is certified below, so whatever point MOSEK stops at is usable
+  model->acceptedSolutionStatus(mosek::fusion::AccSolutionStatus::Anything);
+  model->solve();
+
+  // Retrieve optimizer
+  X = Eigen::Map<Eigen::MatrixXd>(X_var->level().get()->raw(), N, N);
+
+  // Retrieve duals. For a maximization, Fusion reports duals y_i with -y_i
+  // in the dual cone of each constraint, so the diagonal duals are y as they
+  // are and the duals of the inequalities lhs >= rhs are nonpositive, the
+  // negated multipliers.
+  Eigen::VectorXd y = Eigen::Map<Eigen::VectorXd>(diag_con->dual()->raw(), N);
+  Eigen::VectorXd multipliers(K);
+  for (int t = 0; t < K; t++) {
+    multipliers(t) = -ineq_cons[t]->dual()->raw()[0];
+  }
+
+  upper_bound = sdp_certify_upper_bound(A, inequalities, multipliers, y);
+
+  return upper_bound < cutoff;
+}
+
+bool MosekSdpSolver::solve(
+    const Eigen::MatrixXd& A,
+    const CutList& inequalities,
+    const SdpState* warm_start,
+    double cutoff,
+    Eigen::MatrixXd& X,
+    double& upper_bound,
+    SdpState& state) {
+  int N = A.rows();
+
+  std::chrono::steady_clock::time_point setup_start =
+    std::chrono::steady_clock::now();
+
+  mosek::fusion::Variable::t X_var;
+  mosek::fusion::Constraint::t diag_con;
+  std::vector<mosek::fusion::Constraint::t> ineq_cons;
+  mosek::fusion::Model::t model =
+    sdp_mosek_model(N, inequalities, X_var, diag_con, ineq_cons);
+  mosek::fusion::Matrix::t A_mat = sdp_mosek_matrix(A);
 
   model
     ->objective(mosek::fusion::ObjectiveSense::Maximize,
                 mosek::fusion::Expr::sum(mosek::fusion::Expr::mulElm(A_mat,
                                                                      X_var)));
 
-  model->solve();
+  std::chrono::steady_clock::time_point solve_start =
+    std::chrono::steady_clock::now();
 
-  // Retrieve optimizer
-  X = Eigen::Map<Eigen::MatrixXd>(X_var->level().get()->raw(), N, N);
+  bool pruned = sdp_mosek_solve(model,
+                                X_var,
+                                diag_con,
+                                ineq_cons,
+                                inequalities,
+                                A,
+                                tolerance,
+                                cutoff,
+                                X,
+                                upper_bound);
+
+  std::chrono::steady_clock::time_point solve_end =
+    std::chrono::steady_clock::now();
 
   model->dispose();
+
+  state = SdpState();
+
+  stats.solves++;
+  stats.setup_time +=
+    std::chrono::duration<double>(solve_start - setup_start).count();
+  stats.solve_time +=
+    std::chrono::duration<double>(solve_end - solve_start).count();
+
+  return pruned;
+}
+#endif
+
+SdpBackend default_sdp_backend() {
+#ifndef MCBB_NO_MOSEK
+  return SDP_BACKEND_MOSEK;
+#else
+  return SDP_BACKEND_LOW_RANK;
+#endif
+}
+
+bool parse_sdp_backend(const std::string& name, SdpBackend* backend) {
+  if (name == "lowrank") {
+    *backend = SDP_BACKEND_LOW_RANK;
+    return true;
+  }
+#ifndef MCBB_NO_MOSEK
+  if (name == "mosek") {
+    *backend = SDP_BACKEND_MOSEK;
+    return true;
+  }
+#endif
+#ifdef MCBB_MOSEK_PARAMETERS
+  if (name == "mosek-cached") {
+    *backend = SDP_BACKEND_MOSEK_CACHED;
+    return true;
+  }
+#endif
+  return false;
+}
+
+std::string sdp_backend_name(SdpBackend backend) {
+  switch (backend) {
+  case SDP_BACKEND_MOSEK:
+    return "mosek";
+  case SDP_BACKEND_MOSEK_CACHED:
+    return "mosek-cached";
+  case SDP_BACKEND_LOW_RANK:
+    return "lowrank";
+  }
+  return "unknown";
+}
+
+std::shared_ptr<SdpSolver> make_sdp_solver(SdpBackend backend,
+                                           bool measure_uncached) {
+#ifndef MCBB_MOSEK_PARAMETERS
+  (void) measure_uncached;
+#endif
+  switch (backend) {
+#ifndef MCBB_NO_MOSEK
+  case SDP_BACKEND_MOSEK:
+    return std::shared_ptr<SdpSolver>(new MosekSdpSolver());
+#endif
+#ifdef MCBB_MOSEK_PARAMETERS
+  case SDP_BACKEND_MOSEK_CACHED:
+    return std::shared_ptr<SdpSolver>(
+        new CachedMosekSdpSolver(measure_uncached));
+#endif
+  case SDP_BACKEND_LOW_RANK:
+    return std::shared_ptr<SdpSolver>(new LowRankSdpSolver());
+  default:
+    return std::shared_ptr<SdpSolver>();
+  }
 }
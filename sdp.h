@@ -1,8 +1,13 @@
-#include <list>
+#ifndef __SDP_H__
+#define __SDP_H__
+
+#include <memory>
+#include <string>
+#include <vector>
 #include <Eigen/Dense>
-#include "triangle_inequality.h"
+#include "cut.h"
 
-// Solves the Goemans-Williamson SDP and retrieves primal and dual optimizers:
+// Solvers of the Goemans-Williamson SDP, whose primal and dual are:
 //
 // Primal
 //   maximize     <X, A>
@@ -11,6 +16,164 @@
 // Dual
 //   minimize     \sum_{i = 1}^N y_i
 //   subject to   diag(y) = \sum_{i = 1}^N y_i E_{ii} - A >= 0
-void sdp(const Eigen::MatrixXd& A,
-         const std::list<std::shared_ptr<TriangleInequality>>& inequalities,
-         Eigen::MatrixXd& X);
+
+enum SdpBackend {
+  SDP_BACKEND_MOSEK,
+  SDP_BACKEND_MOSEK_CACHED,
+  SDP_BACKEND_LOW_RANK
+};
+
+// Wall clock time spent by a solver, accumulated over its solves.
+struct SdpSolverStats {
+  int solves;
+  // Building the model, or updating a cached one
+  double setup_time;
+  // The optimization itself
+  double solve_time;
+  // Time building a fresh model would have taken, when measured by a caching
+  // solver for comparison
+  double uncached_setup_time;
+
+  SdpSolverStats()
+    : solves(0),
+      setup_time(0),
+      solve_time(0),
+      uncached_setup_time(0) {}
+};
+
+// State of a solver at the end of a solve, in the local indices of the
+// problem, which can be used to warm-start a related solve. The diagonal
+// duals are not stored, since they are determined by V and the multipliers.
+struct SdpState {
+  // Factor with X = VV' (empty if the solver does not produce one)
+  Eigen::MatrixXd V;
+  // Multipliers of the inequalities, in the order they were given
+  Eigen::VectorXd multipliers;
+  int iterations;
+
+  SdpState() : iterations(0) {}
+};
+
+// Interface to a solver of the SDP above, strengthened by the given
+// inequalities (in local indices of A).
+class SdpSolver
+{
+ protected:
+  SdpSolverStats stats;
+  // Relative tolerance of the solves, or 0 for the backend's default
+  double tolerance;
+
+ public:
+  SdpSolver() : tolerance(0) {}
+  virtual ~SdpSolver() {}
+
+  const SdpSolverStats& get_stats() const { return stats; }
+
+  // Sets the tolerance of subsequent solves. Since upper bounds are
+  // certified, a loose tolerance only weakens the bounds, never invalidates
+  // them.
+  void set_tolerance(double t) { tolerance = t; }
+
+  // Writes an (approximate) primal optimizer to X and an upper bound on the
+  // optimal value of the SDP to upper_bound. The upper bound must be valid
+  // even if X is not exactly optimal. If warm_start is not null, the solver
+  // may start from it. The final state is written to state.
+  //
+  // The solver may stop as soon as it proves an upper bound below cutoff, in
+  // which case it returns true, writes that bound to upper_bound and leaves X
+  // unset. Otherwise it returns false.
+  virtual bool solve(
+      const Eigen::MatrixXd& A,
+      const CutList& inequalities,
+      const SdpState* warm_start,
+      double cutoff,
+      Eigen::MatrixXd& X,
+      double& upper_bound,
+      SdpState& state) = 0;
+};
+
+// Certifies an upper bound on the SDP from approximate dual variables: the
+// multipliers of the inequalities (negative entries are treated as 0) and
+// the diagonal dual y. For any such y and multipliers mu >= 0 and any
+// feasible X,
+//   <A, X> <= <A + \sum_t mu_t T_t - diag(y), X> + \sum_i y_i
+//             - \sum_t mu_t rhs_t
+//          <= N lambda_max(A + \sum_t mu_t T_t - diag(y)) + \sum_i y_i
+//             - \sum_t mu_t rhs_t,
+// where <T_t, X> >= rhs_t is inequality t, since tr(X) = N. This amounts to
+// shifting y until diag(y) - A - \sum_t mu_t T_t >= 0. Returns infinity if
+// the duals are not finite.
+double sdp_certify_upper_bound(
+    const Eigen::MatrixXd& A,
+    const CutList& inequalities,
+    const Eigen::VectorXd& multipliers,
+    const Eigen::VectorXd& y);
+
+#ifndef MCBB_NO_MOSEK
+// MOSEK's default tolerances on the relative gap and the infeasibilities of
+// the interior point method, restored when no tolerance is set.
+const double MOSEK_DEFAULT_TOLERANCE = 1e-8;
+
+// Builds a MOSEK Fusion model of the SDP for an N x N problem with the given
+// inequalities, leaving the objective unset. The constraints on the diagonal
+// and the inequalities are written to diag_con and ineq_cons.
+mosek::fusion::Model::t sdp_mosek_model(
+    int N,
+    const CutList& inequalities,
+    mosek::fusion::Variable::t& X_var,
+    mosek::fusion::Constraint::t& diag_con,
+    std::vector<mosek::fusion::Constraint::t>& ineq_cons);
+
+// Returns A as a dense Fusion matrix.
+mosek::fusion::Matrix::t sdp_mosek_matrix(const Eigen::MatrixXd& A);
+
+// Solves a model built by sdp_mosek_model, with the objective <A, X> set,
+// following the contract of SdpSolver::solve. ineq_cons holds the
+// constraints of `inequalities`, in order. The interior point method runs
+// to the given tolerance (0 for MOSEK's default) and is stopped early once
+// the optimal value is proven to be below cutoff. The upper bound is
+// certified from the duals, so the solve need not reach optimality.
+bool sdp_mosek_solve(
+    mosek::fusion::Model::t model,
+    mosek::fusion::Variable::t X_var,
+    mosek::fusion::Constraint::t diag_con,
+    const std::vector<mosek::fusion::Constraint::t>& ineq_cons,
+    const CutList& inequalities,
+    const Eigen::MatrixXd& A,
+    double tolerance,
+    double cutoff,
+    Eigen::MatrixXd& X,
+    double& upper_bound);
+
+// Interior point solver using MOSEK Fusion, building a fresh model for every
+// solve. The upper bound is certified from the duals. The interior point
+// method cannot be warm-started, so warm_start is ignored.
+class MosekSdpSolver : public SdpSolver
+{
+ public:
+  bool solve(const Eigen::MatrixXd& A,
+             const CutList& inequalities,
+             const SdpState* warm_start,
+             double cutoff,
+             Eigen::MatrixXd& X,
+             double& upper_bound,
+             SdpState& state);
+};
+#endif
+
+// Returns the default backend of this build.
+SdpBackend default_sdp_backend();
+
+// Parses a backend name ("mosek", "mosek-cached" or "lowrank"). Returns false
+// if the name is unknown or the backend is not available in this build.
+bool parse_sdp_backend(const std::string& name, SdpBackend* backend);
+
+// Returns the name of a backend, as accepted by parse_sdp_backend.
+std::string sdp_backend_name(SdpBackend backend);
+
+// Constructs a solver using the given backend. If measure_uncached is set, a
+// caching solver also times building each model from scratch.
+std::shared_ptr<SdpSolver> make_sdp_solver(SdpBackend backend,
+                                           bool measure_uncached);
+
+#endif  // __SDP_H__
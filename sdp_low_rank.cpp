@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+#include "sdp_low_rank.h"
+#include "cut.h"
+
+
+// Inequalities in flat form, inequality t reading
+//   \sum_{u = begin[t]}^{begin[t + 1] - 1} coef_u <v_{a_u}, v_{b_u}> >= rhs_t.
+struct LowRankConstraints {
+  std::vector<int> begin;
+  std::vector<int> a;
+  std::vector<int> b;
+  std::vector<double> coef;
+  std::vector<double> rhs;
+
+  LowRankConstraints() : begin(1, 0) {}
+
+  int size() const { return rhs.size(); }
+};
+
+int low_rank_sdp_rank(int N, int K) {
+  int r = (int) std::ceil(std::sqrt(2.0 * (N + K))) + 1;
+  return std::min(N, r);
+}
+
+static void normalize_rows(Eigen::MatrixXd& V) {
+  for (int i = 0; i < V.rows(); i++) {
+    double norm = V.row(i).norm();
+    if (norm > 0) {
+      V.row(i) /= norm;
+    } else {
+      V.row(i).setZero();
+      V(i, 0) = 1.0;
+    }
+  }
+}
+
+static void eval_constraints(const Eigen::MatrixXd& V,
+                             const LowRankConstraints& c,
+                             Eigen::VectorXd& g) {
+  g.resize(c.size());
+  for (int t = 0; t < c.size(); t++) {
+    g(t) = -c.rhs[t];
+    for (int u = c.begin[t]; u < c.begin[t + 1]; u++) {
+      g(t) += c.coef[u] * V.row(c.a[u]).dot(V.row(c.b[u]));
+    }
+  }
+}
+
+// Adds (\sum_t m_t T_t) V to GV, where T_t is the symmetric matrix with
+// <T_t, X> equal to the left hand side of inequality t.
+static void add_constraint_term(const Eigen::MatrixXd& V,
+                                const LowRankConstraints& c,
+                                const Eigen::VectorXd& m,
+                                Eigen::MatrixXd& GV) {
+  for (int t = 0; t < c.size(); t++) {
+    if (m(t) == 0) {
+      continue;
+    }
+    for (int u = c.begin[t]; u < c.begin[t + 1]; u++) {
+      double w = 0.5 * m(t) * c.coef[u];
+      GV.row(c.a[u]) += w * V.row(c.b[u]);
+      GV.row(c.b[u]) += w * V.row(c.a[u]);
+    }
+  }
+}
+
+// Evaluates the augmented Lagrangian (to be maximized)
+//   <A, VV'> - 1/(2 rho) \sum_t (max(0, mu_t - rho g_t)^2 - mu_t^2)
+// given AV, and writes the effective multipliers max(0, mu_t - rho g_t) to m.
+static double lagrangian(const Eigen::MatrixXd& V,
+                         const Eigen::MatrixXd& AV,
+                         const LowRankConstraints& c,
+                         const Eigen::VectorXd& mu,
+                         double rho,
+                         Eigen::VectorXd& g,
+                         Eigen::VectorXd& m) {
+  double value = AV.cwiseProduct(V).sum();
+
+  eval_constraints(V, c, g);
+  m = (mu - rho * g).cwiseMax(0.0);
+  if (c.size() > 0) {
+    value -= (m.squaredNorm() - mu.squaredNorm()) / (2.0 * rho);
+  }
+
+  return value;
+}
+
+// Projects the Euclidean gradient E onto the tangent space of the product of
+// spheres at V.
+static void riemannian_gradient(const Eigen::MatrixXd& V,
+                                const Eigen::MatrixXd& E,
+                                Eigen::MatrixXd& R) {
+  Eigen::VectorXd radial = E.cwiseProduct(V).rowwise().sum();
+  R = E - radial.asDiagonal() * V;
+}
+
+// Maximizes the augmented Lagrangian over V by Riemannian gradient ascent
+// with Barzilai-Borwein steps and an Armijo backtracking safeguard. Returns
+// the number of iterations performed, and sets `converged` if the gradient
+// tolerance was reached.
+static int maximize_lagrangian(const Eigen::MatrixXd& A,
+                               const LowRankConstraints& c,
+                               const Eigen::VectorXd& mu,
+                               double rho,
+                               double tolerance,
+                               int max_iterations,
+                               Eigen::MatrixXd& V,
+                               bool& converged) {
+  Eigen::MatrixXd AV = A * V;
+  Eigen::VectorXd g, m;
+  double value = lagrangian(V, AV, c, mu, rho, g, m);
+
+  Eigen::MatrixXd E = 2.0 * AV;
+  add_constraint_term(V, c, 2.0 * m, E);
+  Eigen::MatrixXd R;
+  riemannian_gradient(V, E, R);
+
+  double step =
+    0.5 / std::max(1.0, A.cwiseAbs().rowwise().sum().maxCoeff());
+
+  converged = false;
+  int iteration = 0;
+  while (iteration < max_iterations) {
+    double gradient_norm2 = R.squaredNorm();
+    if (std::sqrt(gradient_norm2) <= tolerance * std::max(1.0, E.norm())) {
+      converged = true;
+      break;
+    }
+
+    Eigen::MatrixXd V_new, AV_new;
+    Eigen::VectorXd g_new, m_new;
+    double value_new = value;
+    bool accepted = false;
+    for (int backtrack = 0; backtrack < 40; backtrack++) {
+      V_new = V + step * R;
+      normalize_rows(V_new);
+      AV_new = A * V_new;
+      value_new = lagrangian(V_new, AV_new, c, mu, rho, g_new, m_new);
+      if (value_new >= value + 1e-4 * step * gradient_norm2) {
+        accepted = true;
+        break;
+      }
+      step *= 0.5;
+    }
+    iteration++;
+    if (!accepted) {
+      // No further progress is possible at working precision
+      break;
+    }
+
+    Eigen::MatrixXd E_new = 2.0 * AV_new;
+    add_constraint_term(V_new, c, 2.0 * m_new, E_new);
+    Eigen::MatrixXd R_new;
+    riemannian_gradient(V_new, E_new, R_new);
+
+    // Barzilai-Borwein step for the next iteration
+    Eigen::MatrixXd S = V_new - V;
+    double sy = -S.cwiseProduct(R_new - R).sum();
+    if (sy > 0) {
+      step = S.squaredNorm() / sy;
+    } else {
+      step *= 2.0;
+    }
+
+    V.swap(V_new);
+    AV.swap(AV_new);
+    E.swap(E_new);
+    R.swap(R_new);
+    value = value_new;
+  }
+
+  return iteration;
+}
+
+// Certifies an upper bound on the SDP (see sdp_certify_upper_bound) from the
+// multipliers mu >= 0 of the inequalities and the diagonal dual read off
+// from V, y_i = <((A + \sum_t mu_t T_t) V)_i, v_i>, which is exact at a
+// stationary point.
+static double certify_upper_bound(
+    const Eigen::MatrixXd& A,
+    const CutList& inequalities,
+    const LowRankConstraints& c,
+    const Eigen::VectorXd& mu,
+    const Eigen::MatrixXd& V) {
+  Eigen::MatrixXd GV = A * V;
+  add_constraint_term(V, c, mu, GV);
+  Eigen::VectorXd y = GV.cwiseProduct(V).rowwise().sum();
+
+  return sdp_certify_upper_bound(A, inequalities, mu, y);
+}
+
+LowRankSdpSolver::LowRankSdpSolver(double default_tolerance,
+                                   unsigned int seed) {
+  this->default_tolerance = default_tolerance;
+  this->seed = seed;
+}
+
+bool LowRankSdpSolver::solve(
+    const Eigen::MatrixXd& A,
+    const CutList& inequalities,
+    const SdpState* warm_start,
+    double cutoff,
+    Eigen::MatrixXd& X,
+    double& upper_bound,
+    SdpState& state) {
+  int N = A.rows();
+
+  std::chrono::steady_clock::time_point setup_start =
+    std::chrono::steady_clock::now();
+
+  LowRankConstraints c;
+  int a[CUT_MAX_TERMS];
+  int b[CUT_MAX_TERMS];
+  double coef[CUT_MAX_TERMS];
+  for (const Cut& ineq : inequalities) {
+    int num_terms = ineq.get_terms(a, b, coef);
+    c.a.insert(c.a.end(), a, a + num_terms);
+    c.b.insert(c.b.end(), b, b + num_terms);
+    c.coef.insert(c.coef.end(), coef, coef + num_terms);
+    c.begin.push_back(c.a.size());
+    c.rhs.push_back(ineq.get_rhs());
+  }
+  int K = c.size();
+
+  double tol = tolerance > 0 ? tolerance : default_tolerance;
+  // Looser solves also stop at a larger violation of the inequalities
+  double feasibility_tolerance = std::max(LOW_RANK_FEASIBILITY_TOLERANCE, tol);
+
+  int r = low_rank_sdp_rank(N, K);
+
+  // Random values are seeded so that runs are reproducible
+  std::mt19937 generator(seed);
+  std::normal_distribution<double> distribution;
+
+  Eigen::MatrixXd V;
+  Eigen::VectorXd mu = Eigen::VectorXd::Zero(K);
+  if (warm_start != NULL && warm_start->V.rows() == N) {
+    V = warm_start->V;
+    if (warm_start->multipliers.size() == K) {
+      mu = warm_start->multipliers.cwiseMax(0.0);
+    }
+
+    // More inequalities call for a larger rank, so pad the factor with small
+    // random columns, which let the solver leave the warm start's rank
+    int cols = V.cols();
+    if (cols < r) {
+      V.conservativeResize(N, r);
+      for (int i = 0; i < N; i++) {
+        for (int l = cols; l < r; l++) {
+          V(i, l) = LOW_RANK_PADDING_SCALE * distribution(generator);
+        }
+      }
+    }
+  } else {
+    // Random initial point
+    V.resize(N, r);
+    for (int i = 0; i < N; i++) {
+      for (int l = 0; l < r; l++) {
+        V(i, l) = distribution(generator);
+      }
+    }
+  }
+  normalize_rows(V);
+
+  std::chrono::steady_clock::time_point solve_start =
+    std::chrono::steady_clock::now();
+
+  Eigen::VectorXd g;
+  double rho = 1.0;
+  double previous_violation = std::numeric_limits<double>::infinity();
+
+  bool pruned = false;
+  int iterations = 0;
+  for (int round = 0;
+       round < LOW_RANK_MAX_ROUNDS && iterations < LOW_RANK_MAX_ITERATIONS;
+       round++) {
+    // Early rounds only need rough solves, since the multipliers are still
+    // far from optimal
+    double round_tolerance =
+      std::max(tol, LOW_RANK_INITIAL_TOLERANCE * std::pow(0.1, round));
+    bool converged;
+    iterations += maximize_lagrangian(A, c, mu, rho, round_tolerance,
+                                      LOW_RANK_MAX_ITERATIONS - iterations,
+                                      V, converged);
+
+    // The certified bound is valid after every round, so the solve can stop
+    // as soon as it falls below the cutoff. Certifying costs a dense
+    // factorization, so it is only tried every few rounds, and only once the
+    // objective, which the bound cannot fall below at a feasible point, is
+    // itself below the cutoff.
+    if (cutoff > -std::numeric_limits<double>::infinity() &&
+        (round + 1) % LOW_RANK_CUTOFF_INTERVAL == 0 &&
+        (A * V).cwiseProduct(V).sum() < cutoff) {
+      upper_bound = certify_upper_bound(A, inequalities, c, mu, V);
+      if (upper_bound < cutoff) {
+        pruned = true;
+        break;
+      }
+    }
+
+    if (K == 0) {
+      if (round_tolerance <= tol || !converged) {
+        break;
+      }
+      continue;
+    }
+
+    eval_constraints(V, c, g);
+    Eigen::VectorXd mu_new = (mu - rho * g).cwiseMax(0.0);
+
+    // Measures both infeasibility and violation of complementary slackness
+    double violation = ((mu_new - mu) / rho).cwiseAbs().maxCoeff();
+    mu = mu_new;
+    if (violation <= feasibility_tolerance &&
+        round_tolerance <= tol &&
+        converged) {
+      break;
+    }
+    if (violation > 0.25 * previous_violation) {
+      rho *= LOW_RANK_PENALTY_GROWTH;
+    }
+    previous_violation = violation;
+  }
+
+  if (!pruned) {
+    X = V * V.transpose();
+    upper_bound = certify_upper_bound(A, inequalities, c, mu, V);
+  }
+
+  state.V = V;
+  state.multipliers = mu;
+  state.iterations = iterations;
+
+  std::chrono::steady_clock::time_point solve_end =
+    std::chrono::steady_clock::now();
+
+  stats.solves++;
+  stats.setup_time +=
+    std::chrono::duration<double>(solve_start - setup_start).count();
+  stats.solve_time +=
+    std::chrono::duration<double>(solve_end - solve_start).count();
+
+  return pruned;
+}
@@ -0,0 +1,72 @@
+// Implements a low-rank (Burer-Monteiro) solver for the SDP in sdp.h, which
+// does not depend on MOSEK. The solver optimizes over factorizations X = VV'
+// with V of size N x r and r ~ sqrt(2N), keeping the rows of V normalized so
+// that X_{ii} = 1, and handles the inequalities with an augmented
+// Lagrangian. The upper bound is certified from the dual variables at the
+// final iterate (see sdp_certify_upper_bound), so that it is valid however
+// loosely the solve converged.
+
+#ifndef __SDP_LOW_RANK_H__
+#define __SDP_LOW_RANK_H__
+
+#include <memory>
+#include <Eigen/Dense>
+#include "sdp.h"
+#include "cut.h"
+
+// Relative tolerance on the norm of the Riemannian gradient.
+const double LOW_RANK_TOLERANCE = 1e-6;
+
+// Gradient tolerance of the first augmented Lagrangian round, which is
+// tightened tenfold each round until it reaches the solver's tolerance.
+const double LOW_RANK_INITIAL_TOLERANCE = 1e-2;
+
+// Factor by which the penalty parameter grows when the constraint violation
+// does not decrease fast enough.
+const double LOW_RANK_PENALTY_GROWTH = 5.0;
+
+// Tolerance on the violation of the inequalities.
+const double LOW_RANK_FEASIBILITY_TOLERANCE = 1e-5;
+
+// Scale of the random columns added to a warm start whose factor has fewer
+// columns than the rank used for the current inequalities.
+const double LOW_RANK_PADDING_SCALE = 1e-2;
+
+// Maximum number of gradient iterations over all augmented Lagrangian rounds.
+const int LOW_RANK_MAX_ITERATIONS = 20000;
+
+// Maximum number of augmented Lagrangian rounds.
+const int LOW_RANK_MAX_ROUNDS = 40;
+
+// Number of augmented Lagrangian rounds between attempts to certify a bound
+// below the cutoff.
+const int LOW_RANK_CUTOFF_INTERVAL = 4;
+
+class LowRankSdpSolver : public SdpSolver
+{
+ private:
+  // Used unless a tolerance is set with set_tolerance
+  double default_tolerance;
+  unsigned int seed;
+
+ public:
+  LowRankSdpSolver(double default_tolerance = LOW_RANK_TOLERANCE,
+                   unsigned int seed = 0);
+
+  // Starts from warm_start if it is given with a factor of the right size,
+  // and from a random factor otherwise. The bound is compared to cutoff every
+  // LOW_RANK_CUTOFF_INTERVAL augmented Lagrangian rounds.
+  bool solve(const Eigen::MatrixXd& A,
+             const CutList& inequalities,
+             const SdpState* warm_start,
+             double cutoff,
+             Eigen::MatrixXd& X,
+             double& upper_bound,
+             SdpState& state);
+};
+
+// Returns the factorization rank used for an N x N problem with K
+// inequalities, which is the Barvinok-Pataki bound plus one.
+int low_rank_sdp_rank(int N, int K);
+
+#endif  // __SDP_LOW_RANK_H__
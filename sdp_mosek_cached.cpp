@@ -0,0 +1,156 @@
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <Eigen/Dense>
+#include "sdp_mosek_cached.h"
+
+#ifdef MCBB_MOSEK_PARAMETERS
+CachedMosekSdpSolver::CachedMosekSdpSolver(bool measure_uncached) {
+  this->measure_uncached = measure_uncached;
+}
+
+CachedMosekSdpSolver::~CachedMosekSdpSolver() {
+  for (std::pair<const int, CachedModel>& entry : models) {
+    entry.second.model->dispose();
+  }
+}
+
+CachedMosekSdpSolver::CachedModel& CachedMosekSdpSolver::get_model(
+    int N,
+    const CutList& inequalities) {
+  std::map<int, CachedModel>::iterator it = models.find(N);
+
+  if (it != models.end()) {
+    // Count the inequalities that would have to be added, and those that
+    // would be switched off
+    int num_new = 0;
+    for (const Cut& ineq : inequalities) {
+      CutKey key = ineq.get_key();
+      if (it->second.inequalities.count(key) == 0) {
+        num_new++;
+      }
+    }
+    int num_inactive = it->second.inequalities.size() -
+      (inequalities.size() - num_new);
+
+    if (it->second.inequalities.size() + num_new <=
+          MOSEK_CACHED_MAX_INEQUALITIES &&
+        num_inactive <=
+          MOSEK_CACHED_INACTIVE_RATIO * (int) inequalities.size()) {
+      return it->second;
+    }
+
+    it->second.model->dispose();
+    models.erase(it);
+  }
+
+  CachedModel& cached = models[N];
+  cached.model = new mosek::fusion::Model();
+  cached.X_var =
+    cached.model->variable("X", mosek::fusion::Domain::inPSDCone(N));
+  cached.diag_con =
+    cached.model->constraint(cached.X_var->diag(),
+                             mosek::fusion::Domain::equalsTo(1.0));
+
+  return cached;
+}
+
+bool CachedMosekSdpSolver::solve(
+    const Eigen::MatrixXd& A,
+    const CutList& inequalities,
+    const SdpState* warm_start,
+    double cutoff,
+    Eigen::MatrixXd& X,
+    double& upper_bound,
+    SdpState& state) {
+  int N = A.rows();
+
+  if (measure_uncached) {
+    std::chrono::steady_clock::time_point uncached_start =
+      std::chrono::steady_clock::now();
+
+    mosek::fusion::Variable::t X_fresh;
+    mosek::fusion::Constraint::t diag_fresh;
+    std::vector<mosek::fusion::Constraint::t> ineq_fresh;
+    mosek::fusion::Model::t fresh =
+      sdp_mosek_model(N, inequalities, X_fresh, diag_fresh, ineq_fresh);
+    fresh->objective(mosek::fusion::ObjectiveSense::Maximize,
+                     mosek::fusion::Expr::dot(sdp_mosek_matrix(A), X_fresh));
+
+    std::chrono::steady_clock::time_point uncached_end =
+      std::chrono::steady_clock::now();
+    fresh->dispose();
+
+    stats.uncached_setup_time +=
+      std::chrono::duration<double>(uncached_end - uncached_start).count();
+  }
+
+  std::chrono::steady_clock::time_point setup_start =
+    std::chrono::steady_clock::now();
+
+  CachedModel& cached = get_model(N, inequalities);
+
+  cached.model->objective(mosek::fusion::ObjectiveSense::Maximize,
+                          mosek::fusion::Expr::dot(sdp_mosek_matrix(A),
+                                                   cached.X_var));
+
+  // Enforce exactly the inequalities of this solve, adding those that are not
+  // in the model yet
+  std::set<CutKey> active;
+  std::vector<mosek::fusion::Constraint::t> ineq_cons;
+  for (const Cut& ineq : inequalities) {
+    CutKey key = ineq.get_key();
+    active.insert(key);
+
+    std::map<CutKey, CachedInequality>::iterator it =
+      cached.inequalities.find(key);
+    if (it == cached.inequalities.end()) {
+      CachedInequality entry;
+      entry.relaxation = cached.model->parameter();
+      entry.inactive = ineq.get_rhs() + ineq.get_num_terms() +
+        MOSEK_CACHED_INACTIVE_MARGIN;
+      entry.constraint =
+        ineq.add_to_model(cached.model, cached.X_var, entry.relaxation);
+      it = cached.inequalities.insert(std::make_pair(key, entry)).first;
+    }
+    it->second.relaxation->setValue(0.0);
+    ineq_cons.push_back(it->second.constraint);
+  }
+  for (std::pair<const CutKey, CachedInequality>& entry :
+         cached.inequalities) {
+    if (active.count(entry.first) == 0) {
+      entry.second.relaxation->setValue(entry.second.inactive);
+    }
+  }
+
+  std::chrono::steady_clock::time_point solve_start =
+    std::chrono::steady_clock::now();
+
+  bool pruned = sdp_mosek_solve(cached.model,
+                                cached.X_var,
+                                cached.diag_con,
+                                ineq_cons,
+                                inequalities,
+                                A,
+                                tolerance,
+                                cutoff,
+                                X,
+                                upper_bound);
+
+  std::chrono::steady_clock::time_point solve_end =
+    std::chrono::steady_clock::now();
+
+  state = SdpState();
+
+  stats.solves++;
+  stats.setup_time +=
+    std::chrono::duration<double>(solve_start - setup_start).count();
+  stats.solve_time +=
+    std::chrono::duration<double>(solve_end - solve_start).count();
+
+  return pruned;
+}
+#endif
@@ -0,0 +1,79 @@
+// Implements a MOSEK solver for the SDP in sdp.h that keeps one Fusion model
+// per problem size alive between solves. Each solve replaces the objective
+// and switches the inequalities on or off through scalar parameters, instead
+// of building the model from scratch, and the model is rebuilt once too many
+// of its inequalities are switched off. This requires Fusion parameters,
+// which are available from MOSEK 9.2.
+
+#ifndef __SDP_MOSEK_CACHED_H__
+#define __SDP_MOSEK_CACHED_H__
+
+#include "sdp.h"
+
+#ifdef MCBB_MOSEK_PARAMETERS
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include <Eigen/Dense>
+#include "fusion.h"
+#include "cut.h"
+
+// Maximum number of inequalities kept in a cached model. When a model would
+// grow beyond this, it is rebuilt with only the inequalities of the current
+// solve.
+const int MOSEK_CACHED_MAX_INEQUALITIES = 2000;
+
+// Switched-off inequalities still add to the cost of every interior point
+// solve of their model, so a model is also rebuilt with only the
+// inequalities of the current solve once the switched-off ones would
+// outnumber those by more than this factor.
+const int MOSEK_CACHED_INACTIVE_RATIO = 2;
+
+// Margin by which an inequality's parameter exceeds rhs + get_num_terms()
+// to make it vacuous, since every term is at least -1 for any feasible X.
+const double MOSEK_CACHED_INACTIVE_MARGIN = 1.0;
+
+class CachedMosekSdpSolver : public SdpSolver
+{
+ private:
+  struct CachedInequality {
+    mosek::fusion::Constraint::t constraint;
+    mosek::fusion::Parameter::t relaxation;
+    // Value of relaxation that makes the inequality vacuous
+    double inactive;
+  };
+
+  struct CachedModel {
+    mosek::fusion::Model::t model;
+    mosek::fusion::Variable::t X_var;
+    mosek::fusion::Constraint::t diag_con;
+    std::map<CutKey, CachedInequality> inequalities;
+  };
+
+  // Models keyed by the dimension of the problem
+  std::map<int, CachedModel> models;
+  bool measure_uncached;
+
+  CachedModel& get_model(
+      int N,
+      const CutList& inequalities);
+
+ public:
+  // If measure_uncached is set, every solve also builds (and discards) a
+  // fresh model, to record the setup time the cache saves.
+  CachedMosekSdpSolver(bool measure_uncached = false);
+  ~CachedMosekSdpSolver();
+
+  // warm_start is ignored, as for MosekSdpSolver.
+  bool solve(const Eigen::MatrixXd& A,
+             const CutList& inequalities,
+             const SdpState* warm_start,
+             double cutoff,
+             Eigen::MatrixXd& X,
+             double& upper_bound,
+             SdpState& state);
+};
+#endif
+
+#endif  // __SDP_MOSEK_CACHED_H__
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <Eigen/Dense>
+#include "cut.h"
+#include "freeze_map.h"
+#include "odd_cycle.h"
+#include "pentagonal.h"
+#include "separation.h"
+#include "triangle_inequality.h"
+
+bool parse_cut_families(const std::string& name, CutFamilies* families) {
+  CutFamilies parsed;
+  parsed.triangles = false;
+  for (char c : name) {
+    switch (c) {
+    case 't':
+      parsed.triangles = true;
+      break;
+    case 'c':
+      parsed.odd_cycles = true;
+      break;
+    case 'p':
+      parsed.pentagonal = true;
+      break;
+    default:
+      return false;
+    }
+  }
+  *families = parsed;
+  return true;
+}
+
+std::string cut_families_name(const CutFamilies& families) {
+  std::string name;
+  if (families.triangles) {
+    name += 't';
+  }
+  if (families.odd_cycles) {
+    name += 'c';
+  }
+  if (families.pentagonal) {
+    name += 'p';
+  }
+  return name;
+}
+
+void choose_best_cuts(const Eigen::MatrixXd& X,
+                      const FreezeMap& freezes,
+                      const std::set<int>& avoid_ixs,
+                      int M,
+                      const CutFamilies& families,
+                      CutList& cuts) {
+  if (!families.odd_cycles && !families.pentagonal) {
+    if (families.triangles) {
+      choose_best_ineqs(X, freezes, avoid_ixs, M, cuts);
+    } else {
+      cuts.clear();
+    }
+    return;
+  }
+
+  int N = X.rows();
+  cuts.clear();
+  if (M <= 0) {
+    return;
+  }
+
+  // Separate each family in the indices of X, from most to least violated
+  std::vector<std::pair<double, Cut>> candidates;
+  CutList found;
+  for (int family = 0; family < 3; family++) {
+    if (family == 0 && families.triangles) {
+      FreezeMap identity(N);
+      choose_best_ineqs(X, identity, avoid_ixs, M, found);
+    } else if (family == 1 && families.odd_cycles) {
+      choose_odd_cycles(X, avoid_ixs, families.triangles ? 4 : 3, M, found);
+    } else if (family == 2 && families.pentagonal) {
+      choose_pentagonal_ineqs(X, avoid_ixs, M, found);
+    } else {
+      continue;
+    }
+    for (CutList::const_reverse_iterator it = found.rbegin();
+         it != found.rend();
+         ++it) {
+      candidates.push_back(std::make_pair(it->eval(X), *it));
+    }
+  }
+
+  // Keep the M most violated overall, ties going to the earlier family
+  std::stable_sort(candidates.begin(),
+                   candidates.end(),
+                   [](const std::pair<double, Cut>& lhs,
+                      const std::pair<double, Cut>& rhs) {
+                     return lhs.first < rhs.first;
+                   });
+  if ((int) candidates.size() > M) {
+    candidates.resize(M);
+  }
+
+  std::vector<int> keys(freezes.get_keys(),
+                        freezes.get_keys() + freezes.get_num_keys());
+
+  // Report from least to most violated
+  cuts.reserve(candidates.size());
+  for (std::vector<std::pair<double, Cut>>::const_reverse_iterator it =
+         candidates.rbegin();
+       it != candidates.rend();
+       ++it) {
+    cuts.push_back(it->second);
+  }
+  CutList_transform(&cuts, keys, NULL);
+}
@@ -0,0 +1,42 @@
+// Combines the separation of the families of inequalities in cut.h, each of
+// which can be switched on or off on the command line of mcbb.
+
+#ifndef __SEPARATION_H__
+#define __SEPARATION_H__
+
+#include <set>
+#include <string>
+#include <Eigen/Dense>
+#include "cut.h"
+#include "freeze_map.h"
+
+// Families of inequalities to separate, named by the letters t (triangle),
+// c (odd cycles of length at least 4, or 3 without triangles) and p
+// (pentagonal).
+struct CutFamilies {
+  bool triangles;
+  bool odd_cycles;
+  bool pentagonal;
+
+  CutFamilies() : triangles(true), odd_cycles(false), pentagonal(false) {}
+};
+
+// Parses a string of family letters, such as "tc". Returns false if it
+// contains any other character.
+bool parse_cut_families(const std::string& name, CutFamilies* families);
+
+std::string cut_families_name(const CutFamilies& families);
+
+// Chooses the M inequalities of the enabled families most violated by X
+// among the variables not in avoid_ixs, and writes them to cuts, from least
+// to most violated, with indices translated to the original variables
+// through the keys of freezes. With only triangles enabled, this is
+// choose_best_ineqs.
+void choose_best_cuts(const Eigen::MatrixXd& X,
+                      const FreezeMap& freezes,
+                      const std::set<int>& avoid_ixs,
+                      int M,
+                      const CutFamilies& families,
+                      CutList& cuts);
+
+#endif  // __SEPARATION_H__
@@ -0,0 +1,45 @@
+// Checks that the asynchronous mode finds the maximum cut of a small random
+// graph, found here by enumeration, whether each worker holds one node or
+// several at once and whether or not it dives below them, and that every
+// process returns that value. Needs at least two processes.
+//
+// Usage: mpirun -np <p> test_async
+
+#include <cstdio>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "mcbb_impl.h"
+#include "mcbb_options.h"
+#include "sdp.h"
+#include "testing.h"
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  Eigen::MatrixXd A = random_laplacian(16);
+  double expected = max_cut(A);
+
+  McbbOptions options;
+  options.sdp_backend = SDP_BACKEND_LOW_RANK;
+  options.leaf_size = 4;
+
+  bool one_node = found_everywhere(mcbb_async(&A, options), expected);
+
+  options.prefetch_depth = 3;
+  bool prefetched = found_everywhere(mcbb_async(&A, options), expected);
+
+  options.dive_nodes = 5;
+  options.warm_start = true;
+  bool dived = found_everywhere(mcbb_async(&A, options), expected);
+
+  if (rank == 0) {
+    check(one_node, "one node per worker finds the maximum cut");
+    check(prefetched, "three nodes per worker find the maximum cut");
+    check(dived, "three diving nodes per worker find the maximum cut");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
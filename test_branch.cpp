@@ -0,0 +1,86 @@
+// Checks that the coordinators' branching decision skips nodes pruned
+// against the shared incumbent, whose upper bound may still be above the
+// lower bound of the coordinator's queue, and that the nodes it accepts have
+// a valid branching pair.
+//
+// Usage: test_branch
+
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "freeze_map.h"
+#include "incumbent.h"
+#include "node.h"
+#include "node_queue.h"
+#include "sdp.h"
+#include "separation.h"
+#include "testing.h"
+
+// Executes node without brute force, cuts or caches.
+static void execute(Node* node, SdpSolver* solver, Incumbent* incumbent) {
+  node->execute(0,
+                CutFamilies(),
+                solver,
+                incumbent,
+                0,
+                0,
+                NULL,
+                NULL,
+                NULL);
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  // Laplacian of the 10-cycle
+  int N = 10;
+  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(N, N);
+  for (int i = 0; i < N; i++) {
+    int j = (i + 1) % N;
+    A(i, i) += 1;
+    A(j, j) += 1;
+    A(i, j) -= 1;
+    A(j, i) -= 1;
+  }
+  std::shared_ptr<SdpSolver> solver =
+    make_sdp_solver(SDP_BACKEND_LOW_RANK, false);
+
+  {
+    // An incumbent no node can beat, ahead of the queue's lower bound
+    Incumbent incumbent;
+    incumbent.publish(1e9);
+    NodeQueue node_queue;
+
+    Node node(&A);
+    execute(&node, solver.get(), &incumbent);
+    check(node.is_pruned(), "node is pruned against the incumbent");
+    check(node.get_upper_bound() > node_queue.get_lower_bound(),
+          "pruned node's bound is above the queue's lower bound");
+    check(!node.can_branch(node_queue.get_lower_bound()),
+          "pruned node is not branched on");
+  }
+
+  {
+    Incumbent incumbent;
+    NodeQueue node_queue;
+
+    Node node(&A);
+    execute(&node, solver.get(), &incumbent);
+    node_queue.aggregate_lower_bound(node.get_lower_bound());
+    check(!node.is_pruned(), "node is not pruned without an incumbent");
+    check(node.can_branch(node_queue.get_lower_bound()),
+          "node above its lower bound is branched on");
+
+    std::pair<QueuedNode, QueuedNode> children = node.branch_on_suggested();
+    FreezeMap pos = BranchPath_freeze_map(children.first.path.get(), N);
+    FreezeMap neg = BranchPath_freeze_map(children.second.path.get(), N);
+    check(pos.get_num_keys() == N - 1 && neg.get_num_keys() == N - 1,
+          "children freeze one index");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
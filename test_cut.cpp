@@ -0,0 +1,150 @@
+// Checks the flat cut records: that a cut's key does not depend on how its
+// points are listed, that its terms add up to its slack, that a CutList
+// round-trips through its buffer, and that CutList_transform keeps the value
+// of each cut under the substitution and leaves the cuts it cannot translate
+// unchanged.
+//
+// Usage: test_cut
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "cut.h"
+#include "testing.h"
+
+static bool same_keys(const CutList& a, const CutList& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (int i = 0; i < (int) a.size(); i++) {
+    if (a[i].get_key() != b[i].get_key()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the cut matrix x x' of a random +/- 1 vector x on N points.
+static Eigen::MatrixXd random_cut_matrix(int N, std::mt19937& generator) {
+  std::uniform_int_distribution<int> bit(0, 1);
+  Eigen::VectorXd x(N);
+  for (int v = 0; v < N; v++) {
+    x(v) = bit(generator) ? 1 : -1;
+  }
+  return x * x.transpose();
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  std::mt19937 generator(0);
+  int N = 12;
+
+  CutList cuts;
+  cuts.push_back(Cut::triangle(4, 1, 9, -1, 1, -1));
+  int v5[5] = {7, 2, 11, 0, 5};
+  int b5[5] = {-1, 1, 1, -1, 1};
+  cuts.push_back(Cut::hypermetric(5, v5, b5));
+  int v7[7] = {6, 3, 10, 1, 8, 0, 4};
+  int s7[7] = {1, -1, -1, 1, 1, -1, 1};
+  cuts.push_back(Cut::odd_cycle(7, v7, s7));
+
+  {
+    // The same inequalities, listed from other points, the hypermetric one
+    // with all point signs flipped and the cycle reversed
+    int w5[5] = {0, 5, 7, 2, 11};
+    int c5[5] = {1, -1, 1, -1, -1};
+    int w7[7] = {4, 0, 8, 1, 10, 3, 6};
+    int r7[7] = {-1, 1, 1, -1, -1, 1, 1};
+    check(Cut::hypermetric(5, w5, c5).get_key() == cuts[1].get_key(),
+          "hypermetric key ignores point order and a global sign flip");
+    check(Cut::odd_cycle(7, w7, r7).get_key() == cuts[2].get_key(),
+          "odd-cycle key ignores the start and direction of the cycle");
+  }
+
+  {
+    Eigen::MatrixXd X = Eigen::MatrixXd::Random(N, N);
+    X = (X + X.transpose()) / 2;
+    bool sums = true;
+    for (const Cut& cut : cuts) {
+      int a[CUT_MAX_TERMS];
+      int b[CUT_MAX_TERMS];
+      double coef[CUT_MAX_TERMS];
+      int num_terms = cut.get_terms(a, b, coef);
+      double lhs = 0;
+      for (int t = 0; t < num_terms; t++) {
+        lhs += coef[t] * X(a[t], b[t]);
+      }
+      sums = sums && num_terms == cut.get_num_terms() &&
+        std::abs(lhs - cut.get_rhs() - cut.eval(X)) < 1e-12;
+    }
+    check(sums, "terms add up to the slack");
+  }
+
+  {
+    int M = 5;
+    std::vector<int> buffer(CutList_int_size(M), -7);
+    CutList_serialize(cuts, buffer.data());
+    CutList received;
+    CutList_deserialize(buffer.data(), &received);
+    check(same_keys(received, cuts), "cut list round-trips through a buffer");
+    CutList_serialize(CutList(), buffer.data());
+    CutList_deserialize(buffer.data(), &received);
+    check(received.empty(), "empty cut list round-trips through a buffer");
+  }
+
+  {
+    // x_v = sign[v] y_{map[v]}, onto 6 representatives
+    std::vector<int> map(N);
+    std::vector<int> sign(N);
+    std::uniform_int_distribution<int> bit(0, 1);
+    for (int v = 0; v < N; v++) {
+      map[v] = v < 6 ? v : -1;
+      sign[v] = bit(generator) ? 1 : -1;
+    }
+    CutList small;
+    small.push_back(Cut::triangle(0, 3, 5, 1, -1, -1));
+    int w5[5] = {2, 0, 4, 1, 3};
+    int c5[5] = {1, 1, -1, 1, -1};
+    small.push_back(Cut::hypermetric(5, w5, c5));
+    int v5c[5] = {5, 1, 3, 0, 2};
+    int s5c[5] = {-1, 1, -1, -1, -1};
+    small.push_back(Cut::odd_cycle(5, v5c, s5c));
+
+    CutList translated = small;
+    check(CutList_transform(&translated, map, &sign),
+          "cuts on representatives translate");
+    bool same_values = true;
+    for (int trial = 0; trial < 20; trial++) {
+      Eigen::MatrixXd Y = random_cut_matrix(6, generator);
+      Eigen::MatrixXd X(N, N);
+      for (int u = 0; u < N; u++) {
+        for (int w = 0; w < N; w++) {
+          X(u, w) = map[u] < 0 || map[w] < 0 ? 0 :
+            sign[u] * sign[w] * Y(map[u], map[w]);
+        }
+      }
+      for (int i = 0; i < (int) small.size(); i++) {
+        same_values = same_values &&
+          std::abs(small[i].eval(X) - translated[i].eval(Y)) < 1e-12;
+      }
+    }
+    check(same_values, "translated cuts keep their values");
+
+    // Map 5 onto 0, which the triangle and the odd cycle both use
+    map[5] = 0;
+    CutList partial = small;
+    check(!CutList_transform(&partial, map, &sign),
+          "cuts with two points on one representative fail");
+    check(partial[0].get_key() == small[0].get_key() &&
+          partial[2].get_key() == small[2].get_key() &&
+          partial[1].get_key() == translated[1].get_key(),
+          "only the cuts that fail are left unchanged");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
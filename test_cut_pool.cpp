@@ -0,0 +1,97 @@
+// Checks that the cut pool attaches as many inequalities as asked for when
+// several of its inequalities translate to the same one at a node, and that
+// the inequalities a node inherited count as no pool inequality's use, even
+// when they coincide with one.
+//
+// Usage: test_cut_pool
+
+#include <cstdio>
+#include <set>
+#include <vector>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "cut.h"
+#include "cut_pool.h"
+#include "freeze_map.h"
+#include "node.h"
+#include "testing.h"
+
+// Adds cuts to pool as the post inequalities of a node, violated by the
+// given amounts.
+static void add_cuts(const Eigen::MatrixXd* A,
+                     const CutList& cuts,
+                     const Eigen::VectorXd& violations,
+                     CutPool* pool) {
+  Node node(A);
+  node.set_post_inequalities(cuts);
+  node.set_post_inequality_values(-violations);
+  pool->update(&node);
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  int N = 6;
+  Eigen::MatrixXd A = Eigen::MatrixXd::Identity(N, N);
+
+  {
+    // With x_3 = x_0, the first two translate to the same triangle, and
+    // both score above the third
+    CutPool pool;
+    CutList cuts;
+    cuts.push_back(Cut::triangle(0, 1, 2, 1, 1, 1));
+    cuts.push_back(Cut::triangle(3, 1, 2, 1, 1, 1));
+    cuts.push_back(Cut::triangle(1, 2, 4, 1, 1, 1));
+    Eigen::VectorXd violations(3);
+    violations << 1, 0.9, 0.5;
+    add_cuts(&A, cuts, violations, &pool);
+    check(pool.size() == 3, "pool keeps violated post inequalities");
+
+    FreezeMap freezes(N);
+    freezes.freeze(3, 0, 1);
+    Node node(&A, freezes, CutList());
+    pool.attach(&node, 2);
+    const CutList& attached = node.get_inequalities();
+    std::set<CutKey> keys;
+    for (const Cut& ineq : attached) {
+      keys.insert(ineq.get_key());
+    }
+    check(attached.size() == 2 && keys.size() == 2,
+          "inequalities translating to the same one count once");
+    check(keys.count(Cut::triangle(1, 2, 4, 1, 1, 1).get_key()) == 1,
+          "count is filled from the next candidates");
+    const std::vector<CutKey>& sources = node.get_inequality_sources();
+    check(sources.size() == 2 &&
+          sources[0] == cuts[0].get_key() &&
+          sources[1] == cuts[2].get_key(),
+          "attached inequalities keep their pool keys as sources");
+  }
+
+  {
+    // A node inheriting the pool's only inequality
+    CutPool pool;
+    CutList cuts;
+    cuts.push_back(Cut::triangle(0, 1, 2, 1, 1, 1));
+    add_cuts(&A, cuts, Eigen::VectorXd::Ones(1), &pool);
+
+    bool not_attached = true;
+    bool no_source = true;
+    for (int t = 0; t < CUT_POOL_MAX_AGE; t++) {
+      Node node(&A, FreezeMap(N), cuts);
+      pool.attach(&node, 1);
+      not_attached = not_attached && node.get_inequalities().size() == 1;
+      no_source = no_source &&
+        node.get_inequality_sources().size() == 1 &&
+        node.get_inequality_sources()[0] == CutPool::no_source();
+      node.set_inequality_slacks(Eigen::VectorXd::Ones(1));
+      pool.update(&node);
+    }
+    check(not_attached, "inherited inequality is not attached again");
+    check(no_source, "inherited inequality has no pool source");
+    check(pool.size() == 1,
+          "slack inherited inequality does not age its pool entry");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
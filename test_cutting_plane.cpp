@@ -0,0 +1,99 @@
+// Checks that CuttingPlaneTuner keeps the number of inequalities per round
+// within its bounds as it adapts it to the time of rounds, and that
+// cutting-plane rounds tighten the bound of the 5-cycle, whose SDP bound is
+// above its maximum cut but which triangle inequalities cut down to it.
+//
+// Usage: test_cutting_plane
+
+#include <limits>
+#include <memory>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "cut.h"
+#include "cutting_plane.h"
+#include "sdp.h"
+#include "separation.h"
+#include "testing.h"
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  {
+    check(CuttingPlaneTuner(1, 0).get_cuts_per_round() ==
+            CUTTING_PLANE_MIN_CUTS &&
+          CuttingPlaneTuner(1, 1000000).get_cuts_per_round() ==
+            CUTTING_PLANE_MAX_CUTS,
+          "initial cuts per round are clamped");
+
+    CuttingPlaneTuner tuner(1, 40);
+    tuner.record(2.0 * CUTTING_PLANE_ROUND_TIME, 1.0);
+    check(tuner.get_cuts_per_round() == 20, "slow round halves the cuts");
+    tuner.record(0.75 * CUTTING_PLANE_ROUND_TIME, 1.0);
+    check(tuner.get_cuts_per_round() == 20, "on-target round keeps the cuts");
+    tuner.record(0.25 * CUTTING_PLANE_ROUND_TIME, 1.0);
+    check(tuner.get_cuts_per_round() == 30,
+          "fast round grows the cuts by half");
+
+    bool within_bounds = true;
+    for (int t = 0; t < 20; t++) {
+      tuner.record(0, 1.0);
+      within_bounds = within_bounds &&
+        tuner.get_cuts_per_round() <= CUTTING_PLANE_MAX_CUTS;
+    }
+    for (int t = 0; t < 20; t++) {
+      tuner.record(1.0, 0);
+      within_bounds = within_bounds &&
+        tuner.get_cuts_per_round() >= CUTTING_PLANE_MIN_CUTS;
+    }
+    check(within_bounds, "cuts per round stay within their bounds");
+  }
+
+  {
+    // Laplacian of the 5-cycle, whose maximum cut of 4 edges is 16 in
+    // x' A x
+    int N = 5;
+    Eigen::MatrixXd A = Eigen::MatrixXd::Zero(N, N);
+    for (int i = 0; i < N; i++) {
+      int j = (i + 1) % N;
+      A(i, i) += 1;
+      A(j, j) += 1;
+      A(i, j) -= 1;
+      A(j, i) -= 1;
+    }
+    std::shared_ptr<SdpSolver> solver =
+      make_sdp_solver(SDP_BACKEND_LOW_RANK, false);
+    double cutoff = -std::numeric_limits<double>::infinity();
+
+    CutList inequalities;
+    Eigen::MatrixXd X(N, N);
+    double upper_bound;
+    SdpState state;
+    solver->solve(A, inequalities, NULL, cutoff, X, upper_bound, state);
+    double first_bound = upper_bound;
+    check(first_bound > 16.5, "SDP bound of the 5-cycle is above its cut");
+
+    CuttingPlaneTuner tuner(10, 10);
+    int iterations = 0;
+    bool pruned = cutting_plane_rounds(A,
+                                       solver.get(),
+                                       cutoff,
+                                       1.0,
+                                       &tuner,
+                                       CutFamilies(),
+                                       inequalities,
+                                       X,
+                                       upper_bound,
+                                       state,
+                                       iterations);
+    check(!pruned, "rounds are not pruned without a cutoff");
+    check(!inequalities.empty() && iterations > 0,
+          "rounds add inequalities and solve again");
+    check(upper_bound < first_bound - 0.5 && upper_bound > 16 - 1e-3,
+          "rounds tighten the bound towards the cut");
+    check(state.multipliers.size() == (int) inequalities.size(),
+          "state has a multiplier per inequality");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
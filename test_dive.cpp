@@ -0,0 +1,65 @@
+// Checks that a dive warm-starts the SDPs of the nodes below its root only
+// with warm starts enabled, including those of the root's own children.
+//
+// Usage: test_dive
+
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "incumbent.h"
+#include "mcbb_options.h"
+#include "node.h"
+#include "node_worker.h"
+#include "sdp.h"
+#include "testing.h"
+
+// Dives below the root of A and returns the number of warm-started SDPs, or
+// -1 if the dive explored no node below the root.
+static int dive_warm_starts(const Eigen::MatrixXd* A, bool warm_start) {
+  McbbOptions options;
+  options.sdp_backend = SDP_BACKEND_LOW_RANK;
+  options.warm_start = warm_start;
+  options.leaf_size = 4;
+  options.dive_nodes = 20;
+
+  Incumbent incumbent;
+  NodeWorker worker(A, options, &incumbent);
+  Node root(A);
+  std::vector<QueuedNode> frontier;
+  int num_created, num_pruned;
+  worker.dive(&root, &frontier, &num_created, &num_pruned);
+  if (num_created == 0) {
+    return -1;
+  }
+  return root.get_sdp_warm_starts();
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  // Laplacian of a graph with random signed weights, so that the SDP bound
+  // leaves a gap to branch on
+  int N = 20;
+  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(N, N);
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> weight(-1, 1);
+  for (int i = 0; i < N; i++) {
+    for (int j = i + 1; j < N; j++) {
+      int w = weight(generator);
+      A(i, i) += w;
+      A(j, j) += w;
+      A(i, j) -= w;
+      A(j, i) -= w;
+    }
+  }
+
+  check(dive_warm_starts(&A, false) == 0,
+        "dive without warm starts solves every SDP cold");
+  check(dive_warm_starts(&A, true) > 0,
+        "dive with warm starts warm-starts the SDPs below its root");
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
@@ -0,0 +1,194 @@
+// Checks FreezeMap against a reference that stores the representative and
+// sign of every index and relabels a whole group at each freeze, under
+// random sequences of freezes: the representatives, the sorted keys, the
+// groups and the serializations, and that copies do not share state.
+//
+// Usage: test_freeze_map
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "freeze_map.h"
+#include "testing.h"
+
+// Representative and sign of every index.
+struct ReferenceFreezes {
+  std::vector<int> rep;
+  std::vector<int> sign;
+
+  explicit ReferenceFreezes(int N) : rep(N), sign(N, 1) {
+    for (int v = 0; v < N; v++) {
+      rep[v] = v;
+    }
+  }
+
+  void freeze(int i, int j, int s) {
+    for (int v = 0; v < (int) rep.size(); v++) {
+      if (rep[v] == i) {
+        rep[v] = j;
+        sign[v] *= s;
+      }
+    }
+  }
+
+  std::vector<int> keys() const {
+    std::vector<int> ret;
+    for (int v = 0; v < (int) rep.size(); v++) {
+      if (rep[v] == v) {
+        ret.push_back(v);
+      }
+    }
+    return ret;
+  }
+};
+
+// Returns whether f matches reference.
+static bool matches(const FreezeMap& f, const ReferenceFreezes& reference) {
+  int N = f.get_num_indices();
+  std::vector<int> rep(N), sign(N);
+  f.resolve(rep.data(), sign.data());
+  if (rep != reference.rep || sign != reference.sign) {
+    return false;
+  }
+  for (int v = 0; v < N; v++) {
+    int s;
+    if (f.find(v, &s) != reference.rep[v] || s != reference.sign[v]) {
+      return false;
+    }
+  }
+
+  std::vector<int> keys = reference.keys();
+  if (f.get_num_keys() != (int) keys.size() ||
+      !std::equal(keys.begin(), keys.end(), f.get_keys()) ||
+      FreezeMap_num_frozen(&f) != N - (int) keys.size()) {
+    return false;
+  }
+  std::vector<int> key_to_ix(N);
+  f.get_key_indices(key_to_ix.data());
+  for (int v = 0; v < N; v++) {
+    int ix = std::find(keys.begin(), keys.end(), v) - keys.begin();
+    if (key_to_ix[v] != (ix < (int) keys.size() ? ix : -1)) {
+      return false;
+    }
+  }
+
+  // Each group is its key followed by the indices frozen to it in order
+  std::vector<int> start, members, signs;
+  FreezeMap_groups(&f, start, members, signs);
+  for (int ix = 0; ix < (int) keys.size(); ix++) {
+    std::vector<int> group(1, keys[ix]);
+    for (int v = 0; v < N; v++) {
+      if (reference.rep[v] == keys[ix] && v != keys[ix]) {
+        group.push_back(v);
+      }
+    }
+    if (start[ix + 1] - start[ix] != (int) group.size()) {
+      return false;
+    }
+    for (int p = 0; p < (int) group.size(); p++) {
+      if (members[start[ix] + p] != group[p] ||
+          signs[start[ix] + p] != reference.sign[group[p]]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Freezes random keys of f and reference to others, num_freezes times, and
+// returns whether they always matched.
+static bool check_random_freezes(int N,
+                                 int num_freezes,
+                                 FreezeMap* f,
+                                 ReferenceFreezes* reference,
+                                 std::mt19937& generator) {
+  for (int t = 0; t < num_freezes; t++) {
+    std::vector<int> keys = reference->keys();
+    std::uniform_int_distribution<int> key(0, keys.size() - 1);
+    int i = keys[key(generator)];
+    int j;
+    do {
+      j = keys[key(generator)];
+    } while (j == i);
+    int s = std::uniform_int_distribution<int>(0, 1)(generator) ? 1 : -1;
+    f->freeze(i, j, s);
+    reference->freeze(i, j, s);
+    if (!matches(*f, *reference)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  std::mt19937 generator(0);
+  int N = 40;
+
+  {
+    FreezeMap f(N);
+    ReferenceFreezes reference(N);
+    check(matches(f, reference), "new FreezeMap has every index as a key");
+    check(check_random_freezes(N, N - 1, &f, &reference, generator),
+          "random freezes down to one key match the reference");
+  }
+
+  {
+    FreezeMap f(N);
+    ReferenceFreezes reference(N);
+    check_random_freezes(N, N / 2, &f, &reference, generator);
+
+    // A copy branches off without changing the original
+    FreezeMap copy = f;
+    ReferenceFreezes copy_reference = reference;
+    check(check_random_freezes(N, 5, &copy, &copy_reference, generator) &&
+          matches(f, reference),
+          "copies freeze independently");
+
+    std::vector<int> s(3 * N);
+    FreezeMap_serialize(&f, s.data());
+    FreezeMap received;
+    FreezeMap_deserialize(N, s.data(), &received);
+    check(matches(received, reference),
+          "FreezeMap round-trips through its serialization");
+    check(FreezeMap_to_string(&received) == FreezeMap_to_string(&f) &&
+          FreezeMap_to_string(&copy) != FreezeMap_to_string(&f),
+          "string serialization tells FreezeMaps apart");
+
+    Eigen::VectorXd y = Eigen::VectorXd::Random(f.get_num_keys());
+    Eigen::VectorXd z = FreezeMap_expand_vector(y, &f);
+    bool expanded = z.size() == N;
+    for (int v = 0; v < N && expanded; v++) {
+      int ix = std::lower_bound(f.get_keys(),
+                                f.get_keys() + f.get_num_keys(),
+                                reference.rep[v]) - f.get_keys();
+      expanded = z(v) == reference.sign[v] * y(ix);
+    }
+    check(expanded, "vectors expand to the indices frozen to each key");
+    Eigen::MatrixXd V = Eigen::MatrixXd::Random(f.get_num_keys(), 3);
+    check(FreezeMap_restrict_rows(FreezeMap_expand_rows(V, &f), &f) == V,
+          "restricting expanded rows gives them back");
+  }
+
+  {
+    // The same identifications, made in two orders
+    FreezeMap a(N);
+    a.freeze(5, 2, -1);
+    a.freeze(9, 2, 1);
+    a.freeze(2, 0, 1);
+    FreezeMap b(N);
+    b.freeze(9, 5, -1);
+    b.freeze(5, 0, -1);
+    b.freeze(2, 0, 1);
+    check(FreezeMap_to_string(&a) == FreezeMap_to_string(&b),
+          "string serialization does not depend on the order of freezes");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
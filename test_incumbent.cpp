@@ -0,0 +1,59 @@
+// Checks that the incumbent starts empty, keeps the best value published by
+// any process along with the rank holding it, and ignores worse values. Each
+// process publishes values that only it can have, so the checks hold for
+// any number of processes.
+//
+// Usage: test_incumbent, or mpirun -np <p> test_incumbent
+
+#include <cmath>
+#include <cstdio>
+#include <mpi.h>
+#include "incumbent.h"
+#include "testing.h"
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  int rank, p;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+  {
+    Incumbent incumbent;
+    check(std::isinf(incumbent.get()) && incumbent.get() < 0,
+          "incumbent starts at -infinity");
+    check(incumbent.get_holder() == -1, "incumbent starts without a holder");
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    incumbent.publish(10 + rank);
+    check(incumbent.get() >= 10 + rank,
+          "published value is visible to its process at once");
+    MPI_Barrier(MPI_COMM_WORLD);
+    check(incumbent.get() == 10 + p - 1,
+          "every process sees the best published value");
+    check(incumbent.get_holder() == p - 1,
+          "every process sees the rank that published it");
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    incumbent.publish(5 + rank);
+    MPI_Barrier(MPI_COMM_WORLD);
+    check(incumbent.get() == 10 + p - 1 && incumbent.get_holder() == p - 1,
+          "worse values leave the incumbent and its holder");
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // Equal values from every process, of which any may be skipped as no
+    // improvement
+    incumbent.publish(100);
+    MPI_Barrier(MPI_COMM_WORLD);
+    int holder = incumbent.get_holder();
+    int holders[2] = {holder, -holder};
+    MPI_Allreduce(MPI_IN_PLACE, holders, 2, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    check(incumbent.get() == 100 &&
+          holder >= 0 && holder < p &&
+          holders[0] == -holders[1],
+          "of equal values, one holder is seen by every process");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
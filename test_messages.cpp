@@ -0,0 +1,203 @@
+// Checks that the messages between the root and the workers decode to what
+// was encoded: work requests with no inequalities and with 8-point ones, on
+// frozen indices whose gaps take several varint bytes, responses whose
+// witness does not fill its last byte, warm starts padded to the rank and
+// solutions truncated to it.
+//
+// Usage: test_messages
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "cut.h"
+#include "freeze_map.h"
+#include "message.h"
+#include "mpi_util.h"
+#include "node.h"
+#include "testing.h"
+
+static bool same_cuts(const CutList& a, const CutList& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (int i = 0; i < (int) a.size(); i++) {
+    if (a[i].get_key() != b[i].get_key()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool same_freezes(const FreezeMap* a, const FreezeMap* b) {
+  int N = a->get_num_indices();
+  if (b->get_num_indices() != N) {
+    return false;
+  }
+  std::vector<int> rep_a(N), sign_a(N), rep_b(N), sign_b(N);
+  a->resolve(rep_a.data(), sign_a.data());
+  b->resolve(rep_b.data(), sign_b.data());
+  return rep_a == rep_b && sign_a == sign_b;
+}
+
+// Cuts on up to 8 points, with indices that do not fit in a byte
+static CutList make_cuts() {
+  CutList ret;
+  ret.push_back(Cut::triangle(0, 150, 202, 1, -1, -1));
+  int v5[5] = {3, 40, 77, 150, 201};
+  int b5[5] = {1, -1, 1, 1, -1};
+  ret.push_back(Cut::hypermetric(5, v5, b5));
+  int v8[8] = {0, 2, 31, 64, 127, 128, 199, 202};
+  int s8[8] = {1, -1, -1, 1, 1, -1, -1, -1};
+  ret.push_back(Cut::odd_cycle(8, v8, s8));
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  // Not a multiple of 8, and large enough for gaps of two varint bytes
+  int N = 203;
+  Eigen::MatrixXd A = Eigen::MatrixXd::Identity(N, N);
+  FreezeMap freezes(N);
+  freezes.freeze(1, 0, -1);
+  freezes.freeze(150, 0, -1);
+  freezes.freeze(202, 2, 1);
+  CutList cuts = make_cuts();
+  std::vector<char> buffer;
+
+  {
+    Node sent(&A, FreezeMap(N), CutList());
+    pack_work_request(N, &sent, buffer);
+    Node received(&A);
+    MessageType type = unpack_work_request(&received, buffer);
+    check(type == MESSAGE_WORK, "request of the root is a work request");
+    check(same_freezes(received.get_freeze_map(), sent.get_freeze_map()),
+          "request of the root has no frozen indices");
+    check(received.get_inequalities().empty(),
+          "request of the root has no inequalities");
+  }
+
+  {
+    Node sent(&A, freezes, cuts);
+    pack_work_request(N, &sent, buffer);
+    Node received(&A);
+    MessageType type = unpack_work_request(&received, buffer);
+    check(type == MESSAGE_WORK, "request with freezes is a work request");
+    check(same_freezes(received.get_freeze_map(), &freezes),
+          "request keeps frozen indices with large gaps");
+    check(received.get_depth() == FreezeMap_num_frozen(&freezes),
+          "request sets the depth to the number of frozen indices");
+    check(same_cuts(received.get_inequalities(), cuts),
+          "request keeps inequalities on up to 8 points");
+  }
+
+  {
+    std::vector<char> finish = {(char) MESSAGE_PROTOCOL_VERSION,
+                                (char) MESSAGE_FINISH};
+    Node received(&A);
+    check(unpack_work_request(&received, finish) == MESSAGE_FINISH,
+          "finish request is read as such");
+  }
+
+  // Responses with and without post inequalities
+  for (int with_cuts = 0; with_cuts < 2; with_cuts++) {
+    Node sent(&A, freezes, with_cuts ? cuts : CutList());
+    int M = freezes.get_num_keys();
+    Eigen::VectorXd witness = Eigen::VectorXd::Ones(M);
+    for (int r = 0; r < M; r += 3) {
+      witness(r) = -1;
+    }
+    witness(M - 1) = -1;
+    sent.set_lower_bound(123.25);
+    sent.set_upper_bound(130.5);
+    sent.set_branch_i(17);
+    sent.set_branch_j(201);
+    sent.set_sdp_iterations(4567);
+    sent.set_sdp_warm_starts(3);
+    sent.set_pruned(with_cuts == 1);
+    sent.set_lower_bound_witness(witness);
+    Eigen::VectorXd post_values = Eigen::VectorXd::Zero(0);
+    Eigen::VectorXd slacks = Eigen::VectorXd::Zero(0);
+    if (with_cuts) {
+      sent.set_post_inequalities(cuts);
+      post_values = Eigen::VectorXd::LinSpaced(cuts.size(), -1.5, 0.5);
+      slacks = Eigen::VectorXd::LinSpaced(cuts.size(), 0.25, 2);
+    }
+    sent.set_post_inequality_values(post_values);
+    sent.set_inequality_slacks(slacks);
+
+    pack_work_response(N, &sent, buffer);
+    Node received(&A);
+    unpack_work_response(N, &received, buffer);
+
+    const char* what[2] = {"response without post inequalities",
+                           "response with post inequalities"};
+    printf("%s\n", what[with_cuts]);
+    check(received.get_lower_bound() == 123.25 &&
+          received.get_upper_bound() == 130.5,
+          "  bounds");
+    check(received.get_branch_i() == 17 && received.get_branch_j() == 201,
+          "  branching pair");
+    check(received.get_sdp_iterations() == 4567 &&
+          received.get_sdp_warm_starts() == 3,
+          "  SDP statistics");
+    check(received.is_pruned() == (with_cuts == 1), "  pruned flag");
+    check(received.get_lower_bound_witness() ==
+          FreezeMap_expand_vector(witness, &freezes),
+          "  witness on all N indices");
+    check(same_cuts(received.get_post_inequalities(),
+                    sent.get_post_inequalities()),
+          "  post inequalities");
+    check(received.get_post_inequality_values() == post_values,
+          "  post inequality values");
+    check(received.get_inequality_slacks() == slacks, "  slacks");
+  }
+
+  int R = 5;
+  {
+    pack_warm_start(N, R, NULL, cuts, buffer);
+    check(!unpack_warm_start(N, R, cuts, buffer),
+          "missing warm start is read as none");
+  }
+
+  {
+    // A factor of rank below R, and multipliers of the inequalities in
+    // another order than the node's
+    SdpWarmStart sent;
+    sent.V = Eigen::MatrixXd::Random(N, 3);
+    sent.inequalities = CutList(cuts.rbegin(), cuts.rend());
+    sent.multipliers = Eigen::VectorXd::LinSpaced(cuts.size(), 1, 3);
+    pack_warm_start(N, R, &sent, cuts, buffer);
+    std::shared_ptr<const SdpWarmStart> received =
+      unpack_warm_start(N, R, cuts, buffer);
+    check(received && received->V.rows() == N && received->V.cols() == R,
+          "warm start is padded to rank R");
+    check(received->V.leftCols(3) == sent.V &&
+          received->V.rightCols(R - 3).isZero(0),
+          "warm start keeps its factor");
+    check(same_cuts(received->inequalities, cuts),
+          "warm start belongs to the node's inequalities");
+    check(received->multipliers ==
+          SdpWarmStart_match_multipliers(&sent, cuts),
+          "warm start matches multipliers to the node's inequalities");
+  }
+
+  {
+    // A solution of rank above R, without inequalities
+    SdpWarmStart sent;
+    sent.V = Eigen::MatrixXd::Random(N, R + 2);
+    pack_warm_start(N, R, &sent, CutList(), buffer);
+    std::shared_ptr<const SdpWarmStart> received =
+      unpack_warm_start(N, R, CutList(), buffer);
+    check(received && received->V == sent.V.leftCols(R),
+          "solution is truncated to rank R");
+    check(received->inequalities.empty() &&
+          received->multipliers.size() == 0,
+          "solution without inequalities has no multipliers");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
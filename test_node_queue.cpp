@@ -0,0 +1,341 @@
+// Checks IndexedHeap and NodeQueue against a sorted reference under random
+// interleavings of pushes, pops, removals and raises of the lower bound,
+// for each policy that orders all of its pops, with and without spilling to
+// disk, and that the restarts and hybrid policies switch to best-bound pops
+// when they should.
+//
+// Usage: test_node_queue
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+#include "indexed_heap.h"
+#include "node.h"
+#include "node_queue.h"
+#include "testing.h"
+
+// Orders ids by their value, as NodeQueue orders its slots.
+struct LessByValue {
+  const std::vector<double>* values;
+  bool reverse;
+
+  bool operator()(int a, int b) const {
+    return reverse ?
+      (*values)[b] < (*values)[a] :
+      (*values)[a] < (*values)[b];
+  }
+};
+
+// Runs random operations on a max-heap and a min-heap of the same ids, and
+// returns whether their tops always matched a sorted set of (value, id).
+static bool check_indexed_heap(int num_operations, std::mt19937& generator) {
+  std::vector<double> values;
+  IndexedHeap<LessByValue> by_max(LessByValue{&values, false});
+  IndexedHeap<LessByValue> by_min(LessByValue{&values, true});
+  std::set<std::pair<double, int>> reference;
+  std::vector<int> free_ids;
+  double lower_bound = 0;
+
+  std::uniform_int_distribution<int> operation(0, 9);
+  std::uniform_real_distribution<double> offset(0, 100);
+  for (int t = 0; t < num_operations; t++) {
+    int op = operation(generator);
+    if (op < 5 || reference.empty()) {
+      // Push, reusing freed ids as NodeQueue does with its slots
+      int id;
+      if (free_ids.empty()) {
+        id = values.size();
+        values.push_back(0);
+      } else {
+        id = free_ids.back();
+        free_ids.pop_back();
+      }
+      values[id] = lower_bound + offset(generator);
+      by_max.push(id);
+      by_min.push(id);
+      reference.insert(std::make_pair(values[id], id));
+    } else if (op < 7) {
+      // Pop the largest
+      int id = by_max.top();
+      if (id != std::prev(reference.end())->second) {
+        return false;
+      }
+      by_max.remove(id);
+      by_min.remove(id);
+      reference.erase(std::prev(reference.end()));
+      free_ids.push_back(id);
+    } else if (op < 9) {
+      // Remove an arbitrary id
+      std::set<std::pair<double, int>>::iterator it = reference.begin();
+      std::advance(it,
+                   std::uniform_int_distribution<int>(
+                     0, reference.size() - 1)(generator));
+      by_max.remove(it->second);
+      by_min.remove(it->second);
+      free_ids.push_back(it->second);
+      reference.erase(it);
+    } else {
+      // Raise the lower bound and drop the ids at or below it from the
+      // bottom, as NodeQueue::prune does
+      lower_bound += offset(generator) / 10;
+      while (!by_min.empty() && values[by_min.top()] <= lower_bound) {
+        int id = by_min.top();
+        if (id != reference.begin()->second) {
+          return false;
+        }
+        by_max.remove(id);
+        by_min.remove(id);
+        reference.erase(reference.begin());
+        free_ids.push_back(id);
+      }
+      if (!reference.empty() && reference.begin()->first <= lower_bound) {
+        return false;
+      }
+    }
+
+    if (by_max.size() != (int) reference.size() ||
+        by_min.size() != (int) reference.size()) {
+      return false;
+    }
+    if (!reference.empty() &&
+        (by_max.top() != std::prev(reference.end())->second ||
+         by_min.top() != reference.begin()->second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns a path of each depth up to max_depth, freezing index d to 0 at
+// depth d, so that spilled nodes have decisions to write.
+static std::vector<std::shared_ptr<const BranchPath>> make_paths(
+    int max_depth) {
+  std::vector<std::shared_ptr<const BranchPath>> paths(max_depth + 1);
+  for (int d = 1; d <= max_depth; d++) {
+    paths[d].reset(new BranchPath{paths[d - 1], d, 0, d % 2 ? 1 : -1});
+  }
+  return paths;
+}
+
+// Runs random operations on a NodeQueue with a memory budget in bytes, or 0
+// for none, and returns whether every pop, its upper bound and its size
+// always matched a reference of the queued nodes, and whether it spilled if
+// it had a budget.
+static bool check_node_queue(NodeSelection selection,
+                             long memory_budget,
+                             int num_operations,
+                             std::mt19937& generator) {
+  const int max_depth = 20;
+  std::vector<std::shared_ptr<const BranchPath>> paths =
+    make_paths(max_depth);
+
+  NodeQueue queue(selection, memory_budget);
+  LessThanBySelection order{selection};
+  std::vector<QueuedNode> reference;
+  double lower_bound = 0;
+
+  std::uniform_int_distribution<int> operation(0, 9);
+  std::uniform_int_distribution<int> depth(0, max_depth);
+  std::uniform_real_distribution<double> offset(0, 100);
+  for (int t = 0; t < num_operations; t++) {
+    int op = operation(generator);
+    if (op < 6 || reference.empty()) {
+      QueuedNode node;
+      node.upper_bound = lower_bound + offset(generator);
+      node.lower_bound = lower_bound - offset(generator);
+      node.depth = depth(generator);
+      node.path = paths[node.depth];
+      if (!queue.push(node)) {
+        return false;
+      }
+      reference.push_back(node);
+    } else if (op < 9) {
+      if (queue.empty()) {
+        return false;
+      }
+      int best = 0;
+      for (int i = 1; i < (int) reference.size(); i++) {
+        if (order(reference[best], reference[i])) {
+          best = i;
+        }
+      }
+      QueuedNode node = queue.pop();
+      if (node.upper_bound != reference[best].upper_bound ||
+          node.depth != reference[best].depth ||
+          BranchPath_freeze_map(node.path.get(), max_depth + 1).get_num_keys()
+            != max_depth + 1 - node.depth) {
+        return false;
+      }
+      reference.erase(reference.begin() + best);
+    } else {
+      lower_bound += offset(generator) / 10;
+      queue.aggregate_lower_bound(lower_bound);
+      std::vector<QueuedNode> kept;
+      for (const QueuedNode& node : reference) {
+        if (node.upper_bound > lower_bound) {
+          kept.push_back(node);
+        }
+      }
+      reference.swap(kept);
+    }
+
+    double best_upper_bound = -std::numeric_limits<double>::infinity();
+    for (const QueuedNode& node : reference) {
+      best_upper_bound = std::max(best_upper_bound, node.upper_bound);
+    }
+    if (queue.get_upper_bound() != best_upper_bound ||
+        queue.empty() != reference.empty() ||
+        queue.size() != (int) reference.size()) {
+      return false;
+    }
+  }
+  return memory_budget == 0 || queue.get_num_spilled() > 0;
+}
+
+// Spills most of num_nodes nodes, raises the lower bound above many of
+// them, and returns whether the size counts exactly the nodes above it and
+// steal() hands out those and no more.
+static bool check_steal_after_spill(NodeSelection selection,
+                                    int num_nodes,
+                                    double lower_bound,
+                                    std::mt19937& generator) {
+  const int max_depth = 20;
+  std::vector<std::shared_ptr<const BranchPath>> paths =
+    make_paths(max_depth);
+  NodeQueue queue(selection, 2000);
+  std::uniform_int_distribution<int> depth(0, max_depth);
+  std::uniform_real_distribution<double> upper_bound(0, 100);
+  int num_above = 0;
+  for (int i = 0; i < num_nodes; i++) {
+    QueuedNode node;
+    node.upper_bound = upper_bound(generator);
+    node.lower_bound = -std::numeric_limits<double>::infinity();
+    node.depth = depth(generator);
+    node.path = paths[node.depth];
+    queue.push(node);
+    if (node.upper_bound > lower_bound) {
+      num_above++;
+    }
+  }
+  queue.aggregate_lower_bound(lower_bound);
+  if (queue.get_num_spilled() == 0 || queue.size() != num_above) {
+    return false;
+  }
+
+  // As the work-stealing mode gives away nodes, by the size
+  int num_stolen = 0;
+  while (queue.size() > 0) {
+    if (queue.steal().upper_bound <= lower_bound) {
+      return false;
+    }
+    num_stolen++;
+  }
+  return num_stolen == num_above && queue.empty();
+}
+
+// Pops num_nodes random nodes from a queue of the restarts or hybrid policy,
+// telling the hybrid one that the workers are busy two pops in three, and
+// returns whether each pop was by upper bound exactly when the policy says
+// so and by its depth-first order otherwise.
+static bool check_mixed_policy(NodeSelection selection,
+                               int num_nodes,
+                               std::mt19937& generator) {
+  NodeQueue queue(selection);
+  LessThanBySelection order{selection};
+  std::vector<QueuedNode> reference;
+  std::uniform_int_distribution<int> depth(0, 20);
+  std::uniform_real_distribution<double> upper_bound(0, 100);
+  for (int i = 0; i < num_nodes; i++) {
+    QueuedNode node;
+    node.upper_bound = upper_bound(generator);
+    node.lower_bound = -std::numeric_limits<double>::infinity();
+    node.depth = depth(generator);
+    queue.push(node);
+    reference.push_back(node);
+  }
+
+  for (int t = 1; t <= num_nodes; t++) {
+    bool by_bound;
+    if (selection == NODE_SELECTION_RESTARTS) {
+      by_bound = t % NODE_SELECTION_RESTART_PERIOD == 0;
+    } else {
+      bool saturated = t % 3 != 0;
+      queue.set_saturated(saturated);
+      by_bound = !saturated;
+    }
+    int best = 0;
+    for (int i = 1; i < (int) reference.size(); i++) {
+      if (by_bound ?
+          reference[best].upper_bound < reference[i].upper_bound :
+          order(reference[best], reference[i])) {
+        best = i;
+      }
+    }
+    QueuedNode node = queue.pop();
+    if (node.upper_bound != reference[best].upper_bound ||
+        node.depth != reference[best].depth) {
+      return false;
+    }
+    reference.erase(reference.begin() + best);
+  }
+  return queue.empty();
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  std::mt19937 generator(0);
+  check(check_indexed_heap(20000, generator),
+        "indexed heaps match a sorted set");
+
+  NodeSelection selections[3] = {NODE_SELECTION_BEST_BOUND,
+                                 NODE_SELECTION_DEPTH_FIRST,
+                                 NODE_SELECTION_BEST_ESTIMATE};
+  for (NodeSelection selection : selections) {
+    std::string name = node_selection_name(selection);
+    check(check_node_queue(selection, 0, 20000, generator),
+          (name + " queue matches its reference").c_str());
+    // Room for a few dozen nodes, so that most operations meet spilled runs
+    check(check_node_queue(selection, 4096, 20000, generator),
+          (name + " queue matches its reference across spills").c_str());
+  }
+
+  NodeSelection mixed[2] = {NODE_SELECTION_RESTARTS, NODE_SELECTION_HYBRID};
+  for (NodeSelection selection : mixed) {
+    std::string name = node_selection_name(selection);
+    check(check_mixed_policy(selection, 200, generator),
+          (name + " queue pops by bound exactly when it should").c_str());
+  }
+
+  bool names = true;
+  for (NodeSelection selection : {NODE_SELECTION_BEST_BOUND,
+                                  NODE_SELECTION_DEPTH_FIRST,
+                                  NODE_SELECTION_BEST_ESTIMATE,
+                                  NODE_SELECTION_RESTARTS,
+                                  NODE_SELECTION_HYBRID}) {
+    NodeSelection parsed;
+    names = names &&
+      parse_node_selection(node_selection_name(selection), &parsed) &&
+      parsed == selection;
+  }
+  NodeSelection unknown;
+  check(names && !parse_node_selection("breadth-first", &unknown),
+        "policy names parse back to their policies");
+
+  for (NodeSelection selection : selections) {
+    std::string name = node_selection_name(selection);
+    check(check_steal_after_spill(selection, 200, 60, generator),
+          (name + " queue steals only live nodes after a spill").c_str());
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
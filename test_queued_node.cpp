@@ -0,0 +1,127 @@
+// Checks the compact records of queued nodes: that branching shares the
+// parent's path and inheritance between both children, that a record
+// materializes into the node it stands for, that a node's solution is only
+// passed on when it was solved with the children's inequalities, and that a
+// record round-trips through its serialization.
+//
+// Usage: test_queued_node
+
+#include <cstdio>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "cut.h"
+#include "freeze_map.h"
+#include "node.h"
+#include "testing.h"
+
+static bool same_cuts(const CutList& a, const CutList& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (int i = 0; i < (int) a.size(); i++) {
+    if (a[i].get_key() != b[i].get_key()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool same_freezes(const FreezeMap& a, const FreezeMap& b) {
+  return FreezeMap_to_string(&a) == FreezeMap_to_string(&b);
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  int N = 8;
+  Eigen::MatrixXd A = Eigen::MatrixXd::Identity(N, N);
+  CutList post;
+  post.push_back(Cut::triangle(1, 4, 6, 1, -1, -1));
+  post.push_back(Cut::triangle(0, 2, 7, -1, -1, 1));
+
+  Node root(&A);
+  root.set_upper_bound(20);
+  root.set_lower_bound(12);
+  root.set_post_inequalities(post);
+  std::shared_ptr<SdpWarmStart> solution(new SdpWarmStart());
+  solution->V = Eigen::MatrixXd::Random(N, 3);
+  solution->inequalities = post;
+  root.set_solution(solution);
+
+  std::pair<QueuedNode, QueuedNode> children = root.branch(3, 5);
+  const QueuedNode& pos = children.first;
+  const QueuedNode& neg = children.second;
+  check(pos.depth == 1 && neg.depth == 1 &&
+        pos.upper_bound == 20 && pos.lower_bound == 12 &&
+        neg.upper_bound == 20 && neg.lower_bound == 12,
+        "children carry the parent's bounds one level down");
+  check(pos.path->sign == 1 && neg.path->sign == -1 &&
+        pos.path->parent == NULL && neg.path->parent == NULL,
+        "children's decisions differ by sign and hang from the root");
+  check(pos.inheritance == neg.inheritance &&
+        pos.inheritance->warm_start == solution,
+        "children share one inheritance with the parent's solution");
+
+  Node child(&A, neg);
+  FreezeMap expected(N);
+  expected.freeze(3, 5, -1);
+  check(same_freezes(*child.get_freeze_map(), expected) &&
+        child.get_depth() == 1,
+        "record materializes its freezes and depth");
+  check(same_cuts(child.get_inequalities(), post) &&
+        child.get_warm_start() == solution,
+        "record materializes its inequalities and warm start");
+  check(child.get_upper_bound() == 20 && !child.is_executed(),
+        "materialized node keeps its bound and is not executed");
+
+  {
+    // A solution without the post inequalities is not passed on
+    std::shared_ptr<SdpWarmStart> cold(new SdpWarmStart());
+    cold->V = Eigen::MatrixXd::Random(N, 3);
+    root.set_solution(cold);
+    std::pair<QueuedNode, QueuedNode> cold_children = root.branch(3, 5);
+    check(!cold_children.first.inheritance->warm_start,
+          "solution without the post inequalities is not passed on");
+  }
+
+  // A grandchild, whose path extends its parent's
+  child.set_upper_bound(18);
+  child.set_lower_bound(13);
+  child.set_post_inequalities(CutList(1, post[0]));
+  std::pair<QueuedNode, QueuedNode> grandchildren = child.branch(0, 7);
+  const QueuedNode& grandchild = grandchildren.first;
+  check(grandchild.depth == 2 && grandchild.path->parent == neg.path,
+        "grandchild's path shares its parent's");
+  expected.freeze(0, 7, 1);
+  check(same_freezes(BranchPath_freeze_map(grandchild.path.get(), N),
+                     expected),
+        "grandchild's path replays both decisions");
+
+  {
+    std::vector<int> buffer(QueuedNode_int_size(grandchild));
+    QueuedNode_serialize(grandchild, buffer.data());
+    QueuedNode received;
+    received.depth = grandchild.depth;
+    QueuedNode_deserialize(buffer.data(), &received);
+    check(same_freezes(BranchPath_freeze_map(received.path.get(), N),
+                       expected) &&
+          same_cuts(received.inheritance->inequalities,
+                    grandchild.inheritance->inequalities),
+          "record round-trips through its serialization");
+  }
+
+  {
+    QueuedNode record = child.get_record();
+    Node again(&A, record);
+    check(same_freezes(*again.get_freeze_map(), *child.get_freeze_map()) &&
+          same_cuts(again.get_inequalities(), child.get_inequalities()) &&
+          again.get_depth() == child.get_depth(),
+          "node's own record materializes back to it");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
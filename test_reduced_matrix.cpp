@@ -0,0 +1,127 @@
+// Checks the reduced matrices of FreezeMaps: that the matrix built from
+// scratch gives x' A x on every +/- 1 vector consistent with the freezes,
+// that folding a parent's matrix gives its child's, that only children are
+// recognized as such, and that ReducedMatrixCache folds along a path of
+// branches and rebuilds when it leaves it.
+//
+// Usage: test_reduced_matrix
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "freeze_map.h"
+#include "reduced_matrix_cache.h"
+#include "testing.h"
+
+// Returns a random key of f other than avoid.
+static int random_key(const FreezeMap& f, int avoid, std::mt19937& generator) {
+  std::uniform_int_distribution<int> ix(0, f.get_num_keys() - 1);
+  int key;
+  do {
+    key = f.get_key(ix(generator));
+  } while (key == avoid);
+  return key;
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> bit(0, 1);
+  int N = 30;
+  Eigen::MatrixXd A = Eigen::MatrixXd::Random(N, N);
+  A = (A + A.transpose()).eval();
+
+  // Freezes down to 10 keys, checking every step
+  FreezeMap f(N);
+  bool quadratic_forms = true;
+  bool folds = true;
+  bool branches = true;
+  Eigen::MatrixXd B = FreezeMap_transform_matrix(A, &f);
+  while (f.get_num_keys() > 10) {
+    int i = random_key(f, -1, generator);
+    int j = random_key(f, i, generator);
+    int s = bit(generator) ? 1 : -1;
+    FreezeMap child = f;
+    child.freeze(i, j, s);
+
+    std::vector<int> key_to_ix(N);
+    f.get_key_indices(key_to_ix.data());
+    Eigen::MatrixXd folded =
+      FreezeMap_fold_matrix(B, key_to_ix[i], key_to_ix[j], s);
+    Eigen::MatrixXd rebuilt = FreezeMap_transform_matrix(A, &child);
+    folds = folds && (folded - rebuilt).cwiseAbs().maxCoeff() < 1e-9;
+
+    int found_i, found_j, found_s;
+    branches = branches &&
+      FreezeMap_find_branch(&f, &child, &found_i, &found_j, &found_s) &&
+      found_i == i && found_j == j && found_s == s &&
+      !FreezeMap_find_branch(&child, &f, &found_i, &found_j, &found_s) &&
+      !FreezeMap_find_branch(&f, &f, &found_i, &found_j, &found_s);
+
+    Eigen::VectorXd z(child.get_num_keys());
+    for (int k = 0; k < z.size(); k++) {
+      z(k) = bit(generator) ? 1 : -1;
+    }
+    Eigen::VectorXd x = FreezeMap_expand_vector(z, &child);
+    quadratic_forms = quadratic_forms &&
+      std::abs(x.dot(A * x) - z.dot(rebuilt * z)) < 1e-9;
+
+    f = child;
+    B = rebuilt;
+  }
+  check(quadratic_forms, "reduced matrix keeps the quadratic form");
+  check(folds, "folding the parent's matrix gives the child's");
+  check(branches, "only a parent and its child are a branch");
+
+  {
+    // Two freezes at once are not a branch
+    FreezeMap grandchild = f;
+    int i = random_key(f, -1, generator);
+    grandchild.freeze(i, random_key(f, i, generator), 1);
+    int k = random_key(grandchild, -1, generator);
+    grandchild.freeze(k, random_key(grandchild, k, generator), -1);
+    int found_i, found_j, found_s;
+    check(!FreezeMap_find_branch(&f, &grandchild,
+                                 &found_i, &found_j, &found_s),
+          "a grandchild is not a branch");
+  }
+
+  {
+    // A dive down one path, then a jump back to the root
+    ReducedMatrixCache cache;
+    FreezeMap node(N);
+    bool same = (cache.get(A, &node) -
+                 FreezeMap_transform_matrix(A, &node)).cwiseAbs().maxCoeff()
+      < 1e-9;
+    for (int depth = 0; depth < 8; depth++) {
+      int i = random_key(node, -1, generator);
+      node.freeze(i, random_key(node, i, generator), bit(generator) ? 1 : -1);
+      same = same && (cache.get(A, &node) -
+                      FreezeMap_transform_matrix(A, &node))
+        .cwiseAbs().maxCoeff() < 1e-9;
+    }
+    check(same, "cached matrices match those built from scratch");
+    check(cache.get_num_rebuilt() == 1 && cache.get_num_folded() == 8,
+          "cache folds every child along a path");
+
+    FreezeMap other(N);
+    other.freeze(0, 1, 1);
+    other.freeze(2, 3, 1);
+    cache.get(A, &other);
+    check(cache.get_num_rebuilt() == 2,
+          "cache rebuilds a node whose parent it does not hold");
+
+    ReducedMatrixCache disabled(0);
+    disabled.get(A, &node);
+    disabled.get(A, &node);
+    check(disabled.get_num_rebuilt() == 2,
+          "cache of capacity 0 keeps nothing");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
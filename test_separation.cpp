@@ -0,0 +1,143 @@
+// Checks the separation of odd-cycle and pentagonal inequalities on the SDP
+// optima of the 5-cycle, which violates the odd-cycle inequality of the
+// cycle, and of the complete graph on 5 points, which satisfies every
+// triangle inequality but violates the pentagonal one on its five points:
+// that the separators find violated inequalities, in increasing order of
+// violation, that hold at every cut.
+//
+// Usage: test_separation
+
+#include <cmath>
+#include <cstdio>
+#include <set>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "cut.h"
+#include "freeze_map.h"
+#include "odd_cycle.h"
+#include "pentagonal.h"
+#include "separation.h"
+#include "testing.h"
+#include "triangle_inequality.h"
+
+// Returns whether cut holds at the cut matrix x x' of every +/- 1 vector x
+// on N points.
+static bool holds_at_all_cuts(const Cut& cut, int N) {
+  for (int mask = 0; mask < (1 << N); mask++) {
+    Eigen::VectorXd x(N);
+    for (int v = 0; v < N; v++) {
+      x(v) = (mask >> v) & 1 ? -1 : 1;
+    }
+    if (cut.eval(x * x.transpose()) < -1e-9) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns whether cuts are nonempty, all violated by X, from least to most
+// violated, and hold at every cut.
+static bool valid_violated(const CutList& cuts, const Eigen::MatrixXd& X) {
+  if (cuts.empty()) {
+    return false;
+  }
+  double last_slack = 0;
+  for (const Cut& cut : cuts) {
+    double slack = cut.eval(X);
+    if (slack >= 0 || slack > last_slack + 1e-12 ||
+        !holds_at_all_cuts(cut, X.rows())) {
+      return false;
+    }
+    last_slack = slack;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+
+  int N = 5;
+  FreezeMap identity(N);
+
+  // Unit vectors at angles 4 pi / 5 apart along the 5-cycle
+  Eigen::MatrixXd cycle_X(N, N);
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      cycle_X(i, j) = std::cos(4 * M_PI * (i - j) / N);
+    }
+  }
+  // Unit vectors at the vertices of a simplex
+  Eigen::MatrixXd complete_X =
+    (N * Eigen::MatrixXd::Identity(N, N) - Eigen::MatrixXd::Ones(N, N)) /
+    (N - 1);
+
+  {
+    CutList triangles;
+    choose_best_ineqs(complete_X, identity, std::set<int>(), 10, triangles);
+    bool satisfied = !triangles.empty();
+    for (const Cut& cut : triangles) {
+      satisfied = satisfied && cut.eval(complete_X) >= -1e-9;
+    }
+    check(satisfied, "simplex satisfies the triangle inequalities");
+  }
+
+  {
+    CutList cuts;
+    choose_odd_cycles(cycle_X, std::set<int>(), 4, 10, cuts);
+    check(valid_violated(cuts, cycle_X),
+          "odd cycles of the 5-cycle are violated and valid");
+    bool lengths = true;
+    for (const Cut& cut : cuts) {
+      lengths = lengths && cut.get_type() == CUT_ODD_CYCLE &&
+        cut.get_num_vertices() >= 4 &&
+        cut.get_num_vertices() <= CUT_MAX_VERTICES;
+    }
+    check(lengths, "odd cycles have the requested lengths");
+
+    choose_odd_cycles(cycle_X, std::set<int>{2}, 4, 10, cuts);
+    bool avoided = true;
+    for (const Cut& cut : cuts) {
+      for (int t = 0; t < cut.get_num_vertices(); t++) {
+        avoided = avoided && cut.get_vertex(t) != 2;
+      }
+    }
+    check(avoided, "no odd cycle passes through an avoided point");
+  }
+
+  {
+    CutList cuts;
+    choose_pentagonal_ineqs(complete_X, std::set<int>(), 10, cuts);
+    check(valid_violated(cuts, complete_X),
+          "pentagonal inequalities of the simplex are violated and valid");
+    bool five_points = true;
+    for (const Cut& cut : cuts) {
+      five_points = five_points && cut.get_type() == CUT_HYPERMETRIC &&
+        cut.get_num_vertices() == 5;
+    }
+    check(five_points, "pentagonal inequalities have five points");
+  }
+
+  {
+    CutFamilies families;
+    families.triangles = false;
+    families.odd_cycles = true;
+    CutList cuts;
+    choose_best_cuts(cycle_X, identity, std::set<int>(), 10, families, cuts);
+    check(valid_violated(cuts, cycle_X),
+          "odd-cycle family is separated on its own");
+
+    families.odd_cycles = false;
+    families.pentagonal = true;
+    choose_best_cuts(complete_X,
+                     identity,
+                     std::set<int>(),
+                     10,
+                     families,
+                     cuts);
+    check(valid_violated(cuts, complete_X),
+          "pentagonal family is separated on its own");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
@@ -0,0 +1,47 @@
+// Checks that the work-stealing mode finds the maximum cut of a small random
+// graph, found here by enumeration, under the best-bound and depth-first
+// policies and with warm starts, and that every process returns that value,
+// so that the search ends only once all of them are out of work. Needs at
+// least two processes.
+//
+// Usage: mpirun -np <p> test_steal
+
+#include <cstdio>
+#include <Eigen/Dense>
+#include <mpi.h>
+#include "mcbb_impl.h"
+#include "mcbb_options.h"
+#include "node_queue.h"
+#include "sdp.h"
+#include "testing.h"
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  Eigen::MatrixXd A = random_laplacian(16);
+  double expected = max_cut(A);
+
+  McbbOptions options;
+  options.sdp_backend = SDP_BACKEND_LOW_RANK;
+  options.leaf_size = 4;
+
+  bool best_bound = found_everywhere(mcbb_steal(&A, options), expected);
+
+  options.node_selection = NODE_SELECTION_DEPTH_FIRST;
+  bool depth_first = found_everywhere(mcbb_steal(&A, options), expected);
+
+  options.node_selection = NODE_SELECTION_BEST_BOUND;
+  options.warm_start = true;
+  bool warm_started = found_everywhere(mcbb_steal(&A, options), expected);
+
+  if (rank == 0) {
+    check(best_bound, "best-bound stealing finds the maximum cut");
+    check(depth_first, "depth-first stealing finds the maximum cut");
+    check(warm_started, "warm-started stealing finds the maximum cut");
+  }
+
+  MPI_Finalize();
+  return testing_exit_code();
+}
@@ -0,0 +1,72 @@
+// Reporting shared by the test programs, each of which prints one line per
+// check and returns testing_exit_code() from main, and the small instances
+// on which the tests of whole runs compare against enumeration.
+
+#ifndef __TESTING_H__
+#define __TESTING_H__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <Eigen/Dense>
+#include <mpi.h>
+
+// Number of failed checks, counted by the one translation unit of a test
+// program that includes this header
+static int num_failures = 0;
+
+// Prints what was checked and whether it held.
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) {
+    num_failures++;
+  }
+}
+
+// Returns the exit status of a test program: 0 if every check held.
+static int testing_exit_code() { return num_failures == 0 ? 0 : 1; }
+
+// Returns the Laplacian of a graph on N points with random edge weights in
+// {-1, 0, 1}, the same on every process.
+static Eigen::MatrixXd random_laplacian(int N) {
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> weight(-1, 1);
+  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(N, N);
+  for (int i = 0; i < N; i++) {
+    for (int j = i + 1; j < N; j++) {
+      int w = weight(generator);
+      A(i, i) += w;
+      A(j, j) += w;
+      A(i, j) -= w;
+      A(j, i) -= w;
+    }
+  }
+  return A;
+}
+
+// Returns the largest x' A x over +/- 1 vectors x, by enumeration.
+static double max_cut(const Eigen::MatrixXd& A) {
+  int N = A.rows();
+  double best = -std::numeric_limits<double>::infinity();
+  Eigen::VectorXd x(N);
+  for (int mask = 0; mask < (1 << (N - 1)); mask++) {
+    for (int v = 0; v < N; v++) {
+      x(v) = v > 0 && (mask >> (v - 1)) & 1 ? -1 : 1;
+    }
+    best = std::max(best, x.dot(A * x));
+  }
+  return best;
+}
+
+// Returns whether value is the expected one on every process. Must be
+// called by every process.
+static bool found_everywhere(double value, double expected) {
+  int local = std::abs(value - expected) < 1e-6;
+  int all;
+  MPI_Allreduce(&local, &all, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+  return all;
+}
+
+#endif  // __TESTING_H__
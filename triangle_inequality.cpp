@@ -1,149 +1,168 @@
-#include <list>
-#include <queue>
+#include <algorithm>
 #include <cstdlib>
+#include <limits>
 #include <set>
+#include <vector>
 #include <Eigen/Dense>
-#include "fusion.h"
+#include "cut.h"
 #include "triangle_inequality.h"
 
 
-TriangleInequality::TriangleInequality(int i, 
-                                       int j, 
-                                       int k, 
-                                       int sign_ij, 
-                                       int sign_ik, 
-                                       int sign_jk) {
-  this->i = i;
-  this->j = j;
-  this->k = k;
-  this->sign_ij = sign_ij;
-  this->sign_ik = sign_ik;
-  this->sign_jk = sign_jk;
-}
-
-TriangleInequality::TriangleInequality(const int* buffer) {
-  this->i = buffer[0];
-  this->j = buffer[1];
-  this->k = buffer[2];
-  this->sign_ij = buffer[3];
-  this->sign_ik = buffer[4];
-  this->sign_jk = buffer[5];
-}
-
-TriangleInequality::TriangleInequality(const double* buffer) {
-  this->i = buffer[0];
-  this->j = buffer[1];
-  this->k = buffer[2];
-  this->sign_ij = buffer[3];
-  this->sign_ik = buffer[4];
-  this->sign_jk = buffer[5];
-}
-
-void TriangleInequality::serialize(int* buffer) const {
-  buffer[0] = i;
-  buffer[1] = j;
-  buffer[2] = k;
-  buffer[3] = sign_ij;
-  buffer[4] = sign_ik;
-  buffer[5] = sign_jk;
-}
+// A triangle inequality as found by the separation, with its value
+// sign_ij X_ij + sign_ik X_ik + sign_jk X_jk + 1 and the index of its sign
+// pattern in TRIANGLE_SIGN_PATTERNS. i, j, k index the active variables.
+struct TriangleCandidate {
+  double value;
+  int i;
+  int j;
+  int k;
+  int pattern;
+};
 
-void TriangleInequality::serialize(double* buffer) const {
-  buffer[0] = i + 0.5;
-  buffer[1] = j + 0.5;
-  buffer[2] = k + 0.5;
-  buffer[3] = sign_ij * 1.5;
-  buffer[4] = sign_ik * 1.5;
-  buffer[5] = sign_jk * 1.5;
-}
+static const int TRIANGLE_SIGN_PATTERNS[4][3] = {
+  { +1, +1, +1 },
+  { +1, -1, -1 },
+  { -1, +1, -1 },
+  { -1, -1, +1 }};
 
-double TriangleInequality::eval(const Eigen::MatrixXd& X) const {
-  return sign_ij * X(i, j) + sign_jk * X(j, k) + sign_ik * X(i, k) + 1;
+// Orders candidates from most to least violated, breaking ties by indices so
+// that the chosen set does not depend on the number of threads.
+static bool more_violated(const TriangleCandidate& lhs,
+                          const TriangleCandidate& rhs) {
+  if (lhs.value != rhs.value) {
+    return lhs.value < rhs.value;
+  }
+  if (lhs.i != rhs.i) {
+    return lhs.i < rhs.i;
+  }
+  if (lhs.j != rhs.j) {
+    return lhs.j < rhs.j;
+  }
+  if (lhs.k != rhs.k) {
+    return lhs.k < rhs.k;
+  }
+  return lhs.pattern < rhs.pattern;
 }
 
-void TriangleInequality::add_to_model(mosek::fusion::Model::t model, 
-				      mosek::fusion::Variable::t X) const {
-  mosek::fusion::Expression::t expr_ij = 
-    mosek::fusion::Expr::mul(X->index(i, j), sign_ij);
-  mosek::fusion::Expression::t expr_jk =
-    mosek::fusion::Expr::mul(X->index(j, k), sign_jk);
-  mosek::fusion::Expression::t expr_ik = 
-    mosek::fusion::Expr::mul(X->index(i, k), sign_ik);
-  mosek::fusion::Expression::t expr_lhs = 
-    mosek::fusion::Expr::add(expr_ij, 
-                             mosek::fusion::Expr::add(expr_jk, expr_ik));
-                             
-  model->constraint(expr_lhs, mosek::fusion::Domain::greaterThan(-1.0));
+// Keeps the M most violated of the candidates.
+static void keep_most_violated(std::vector<TriangleCandidate>& candidates,
+                               int M) {
+  if ((int) candidates.size() > M) {
+    std::nth_element(candidates.begin(),
+                     candidates.begin() + M,
+                     candidates.end(),
+                     more_violated);
+    candidates.resize(M);
+  }
 }
 
 void choose_best_ineqs(const Eigen::MatrixXd& X, 
                        const FreezeMap& freezes,
                        const std::set<int>& avoid_ixs,
                        int M, 
-                       std::list<std::shared_ptr<TriangleInequality>>& ineqs) {
+                       CutList& ineqs) {
   int N = X.rows();
 
-  // Defines an ordering in which the _smallest_ triangle inequalities are 
-  // those most violated
-  auto compare = [&X](const std::shared_ptr<TriangleInequality>& lhs,
-		      const std::shared_ptr<TriangleInequality>& rhs) {
-    return lhs->eval(X) < rhs->eval(X);
-  };
-
-  std::priority_queue<
-    std::shared_ptr<TriangleInequality>,
-    std::vector<std::shared_ptr<TriangleInequality>>,
-    decltype(compare)> ineq_queue(compare);
-    
-  int sign_choices[4][3] = {
-    { +1, +1, +1 },
-    { +1, -1, -1 },
-    { -1, +1, -1 },
-    { -1, -1, +1 }};
+  ineqs.clear();
+  if (M <= 0) {
+    return;
+  }
 
+  // Copy the rows and columns of the variables that are not avoided, so that
+  // the innermost loop reads contiguous memory
+  std::vector<int> ixs;
   for (int i = 0; i < N; i++) {
-    if (avoid_ixs.find(i) != avoid_ixs.end()) {
-      continue;
+    if (avoid_ixs.find(i) == avoid_ixs.end()) {
+      ixs.push_back(i);
     }
-    for (int j = i + 1; j < N; j++) {
-      if (avoid_ixs.find(j) != avoid_ixs.end()) {
-        continue;
-      }
-      for (int k = j + 1; k < N; k++) {
-        if (avoid_ixs.find(k) != avoid_ixs.end()) {
-          continue;
+  }
+  int n = ixs.size();
+  Eigen::MatrixXd Xa(n, n);
+  for (int b = 0; b < n; b++) {
+    for (int a = 0; a < n; a++) {
+      Xa(a, b) = X(ixs[a], ixs[b]);
+    }
+  }
+
+  std::vector<TriangleCandidate> best;
+
+#pragma omp parallel if (n >= TRIANGLE_PARALLEL_MIN)
+  {
+    // Up to 2M candidates are buffered per thread before being cut back to
+    // the M most violated, whose least violated value then bounds the values
+    // worth buffering
+    std::vector<TriangleCandidate> local;
+    local.reserve(2 * M);
+    double threshold = std::numeric_limits<double>::infinity();
+    std::vector<double> min_value(n);
+
+#pragma omp for schedule(dynamic)
+    for (int i = 0; i < n; i++) {
+      const double* X_i = Xa.data() + (long) i * n;
+      for (int j = i + 1; j < n; j++) {
+        const double* X_j = Xa.data() + (long) j * n;
+        double x_ij = X_i[j];
+
+        // The least value of the four sign patterns, for all k at once
+        for (int k = j + 1; k < n; k++) {
+          double s = X_i[k] + X_j[k];
+          double d = X_i[k] - X_j[k];
+          min_value[k] = 1.0 + std::min(std::min(x_ij + s, x_ij - s),
+                                        std::min(d - x_ij, -d - x_ij));
         }
-        for (int l = 0; l < 4; l++) {
-          std::shared_ptr<TriangleInequality> 
-            this_ineq(new TriangleInequality(i, j, k, 
-                                             sign_choices[l][0], 
-                                             sign_choices[l][1], 
-                                             sign_choices[1][2]));
-          if (ineq_queue.size() < M) {
-            ineq_queue.push(this_ineq);
-          } else if (this_ineq->eval(X) < ineq_queue.top()->eval(X)) {
-            ineq_queue.pop();
-            ineq_queue.push(this_ineq);
+
+        for (int k = j + 1; k < n; k++) {
+          if (min_value[k] > threshold) {
+            continue;
+          }
+          for (int l = 0; l < 4; l++) {
+            TriangleCandidate candidate;
+            candidate.value = 1.0 +
+              TRIANGLE_SIGN_PATTERNS[l][0] * x_ij +
+              TRIANGLE_SIGN_PATTERNS[l][1] * X_i[k] +
+              TRIANGLE_SIGN_PATTERNS[l][2] * X_j[k];
+            if (candidate.value > threshold) {
+              continue;
+            }
+            candidate.i = i;
+            candidate.j = j;
+            candidate.k = k;
+            candidate.pattern = l;
+            local.push_back(candidate);
+
+            if ((int) local.size() >= 2 * M) {
+              keep_most_violated(local, M);
+              threshold = std::max_element(local.begin(),
+                                           local.end(),
+                                           more_violated)->value;
+            }
           }
         }
       }
     }
-  }
 
-  std::vector<int> keys;
-  keys.reserve(freezes.size());
-  int key_ix = 0;
-  for (FreezeMap::const_iterator it=freezes.begin(); it != freezes.end(); ++it) {
-    keys[key_ix] = it->first;
-    key_ix++;
+    keep_most_violated(local, M);
+#pragma omp critical
+    best.insert(best.end(), local.begin(), local.end());
   }
 
-  ineqs.clear();
-  while (!ineq_queue.empty()) {
-    int i = keys[ineq_queue.top()->get_i()];
-    int j = keys[ineq_queue.top()->get_j()];
-    int k = keys[ineq_queue.top()->get_k()];
-    ineqs.push_back(std::shared_ptr<TriangleInequality>(new TriangleInequality(i, j, k, ineq_queue.top()->get_sign_ij(), ineq_queue.top()->get_sign_ik(), ineq_queue.top()->get_sign_jk())));
-    ineq_queue.pop();
+  keep_most_violated(best, M);
+
+  // Report from least to most violated
+  std::sort(best.begin(), best.end(), more_violated);
+  const int* keys = freezes.get_keys();
+
+  ineqs.reserve(best.size());
+  for (std::vector<TriangleCandidate>::const_reverse_iterator it =
+         best.rbegin();
+       it != best.rend();
+       ++it) {
+    const int* signs = TRIANGLE_SIGN_PATTERNS[it->pattern];
+    ineqs.push_back(Cut::triangle(keys[ixs[it->i]],
+                                  keys[ixs[it->j]],
+                                  keys[ixs[it->k]],
+                                  signs[0],
+                                  signs[1],
+                                  signs[2]));
   }
 }
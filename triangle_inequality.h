@@ -1,58 +1,22 @@
 #ifndef __TRIANGLE_INEQUALITY_H__
 #define __TRIANGLE_INEQUALITY_H__
 
-#include <list>
-#include <cstdlib>
-#include <memory>
 #include <set>
 #include <Eigen/Dense>
-#include "fusion.h"
+#include "cut.h"
 #include "freeze_map.h"
 
+// Separation is split across OpenMP threads from this many variables.
+const int TRIANGLE_PARALLEL_MIN = 32;
 
-class TriangleInequality 
-{
- private:
-  int i;
-  int j;
-  int k;
-  int sign_ij;
-  int sign_ik;
-  int sign_jk;
-
- public:
-  TriangleInequality(int i, 
-                     int j, 
-                     int k, 
-                     int sign_ij, 
-                     int sign_ik, 
-                     int sign_jk);
-
-  TriangleInequality(const int* buffer);
-
-  TriangleInequality(const double* buffer);
-
-  int get_i() { return i; }
-  int get_j() { return j; }
-  int get_k() { return k; }
-  int get_sign_ij() { return sign_ij; }
-  int get_sign_ik() { return sign_ik; }
-  int get_sign_jk() { return sign_jk; }
-
-  void add_to_model(mosek::fusion::Model::t model, 
-                    mosek::fusion::Variable::t X) const;
-
-  double eval(const Eigen::MatrixXd& X) const;
-
-  void serialize(int* buffer) const;
-
-  void serialize(double* buffer) const;
-};
-
+// Chooses the M triangle inequalities most violated by X among the variables
+// not in avoid_ixs, and writes them to ineqs, from least to most violated,
+// with indices translated to the original variables through the keys of
+// freezes. Ties are broken by indices, so the choice is deterministic.
 void choose_best_ineqs(const Eigen::MatrixXd& X, 
                        const FreezeMap& freezes,
                        const std::set<int>& avoid_ixs,
                        int M, 
-                       std::list<std::shared_ptr<TriangleInequality>>& ineqs);
+                       CutList& ineqs);
 
 #endif  // __TRIANGLE_INEQUALITY_H__